@@ -40,7 +40,29 @@ SOURCES += main.cpp \
     summarydialog.cpp \
     settings.cpp \
     myoutputdialog.cpp \
-    licensedialog.cpp
+    licensedialog.cpp \
+    metricsserver.cpp \
+    flowtable.cpp \
+    flowexporter.cpp \
+    ipaddress.cpp \
+    dissectors.cpp \
+    fragmenttable.cpp \
+    filtercache.cpp \
+    packetstore.cpp \
+    packetsmodel.cpp \
+    displayfilter.cpp \
+    packetindex.cpp \
+    topcounter.cpp \
+    hyperloglog.cpp \
+    hostresolver.cpp \
+    namedecoder.cpp \
+    dataexporter.cpp \
+    sessionfile.cpp \
+    checkpoint.cpp \
+    eventsmodel.cpp \
+    eventlog.cpp \
+    portdatabase.cpp \
+    portnumbersmodel.cpp
 HEADERS += mainwindow.h \
     aboutdialog.h \
     devicesdialog.h \
@@ -67,7 +89,29 @@ HEADERS += mainwindow.h \
     summarydialog.h \
     settings.h \
     myoutputdialog.h \
-    licensedialog.h
+    licensedialog.h \
+    metricsserver.h \
+    flowtable.h \
+    flowexporter.h \
+    ipaddress.h \
+    dissectors.h \
+    fragmenttable.h \
+    filtercache.h \
+    packetstore.h \
+    packetsmodel.h \
+    displayfilter.h \
+    packetindex.h \
+    topcounter.h \
+    hyperloglog.h \
+    hostresolver.h \
+    namedecoder.h \
+    dataexporter.h \
+    sessionfile.h \
+    checkpoint.h \
+    eventsmodel.h \
+    eventlog.h \
+    portdatabase.h \
+    portnumbersmodel.h
 FORMS += mainwindow.ui \
     aboutdialog.ui \
     devicesdialog.ui \
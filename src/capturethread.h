@@ -23,6 +23,75 @@
 #include "WpdPack/Include/pcap.h"
 
 #include "protocols.h"
+#include "ipaddress.h"
+#include "dissectors.h"
+#include "fragmenttable.h"
+#include "filtercache.h"
+#include "namedecoder.h"
+
+// layers between Ethernet and the network layer
+enum
+{
+    ENCAP_VLAN = 1,
+    ENCAP_QINQ = 2,
+    ENCAP_MPLS = 4,
+    ENCAP_PPPOE = 8
+};
+
+// layers with a header that is invalid or was not captured
+enum
+{
+    MALFORMED_LINK = 1,
+    MALFORMED_ENCAPSULATION = 2,
+    MALFORMED_NETWORK = 4,
+    MALFORMED_TRANSPORT = 8
+};
+
+// IP fragment state
+enum
+{
+    FRAGMENT_NONE = 0,
+    FRAGMENT_FIRST,         // carries the transport header
+    FRAGMENT_LATER,         // attributed to the ports of the first fragment
+    FRAGMENT_UNMATCHED      // later fragment, first fragment not seen or expired
+};
+
+// packet sampling
+enum
+{
+    SAMPLING_OFF = 0,
+    SAMPLING_COUNT,         // every N-th packet
+    SAMPLING_FLOW           // all packets of 1 in N flows, by a hash of the addresses and ports
+};
+
+// captured packet summary, passed to ReceiverCore and PacketsMainWindow
+struct Packet
+{
+    QString time;
+    quint64 timestamp;  // milliseconds since the epoch
+    quint32 length;
+    bool truncated;     // fewer bytes captured than on the wire (snaplen)
+    QString sMac;
+    QString dMac;
+    quint16 type;       // EtherType of the network layer
+    quint8 protocol;    // ProtocolId
+    quint16 vlan;       // outer VLAN ID, 0 if untagged
+    quint16 innerVlan;  // inner (customer) VLAN ID of a QinQ frame, 0 if none
+    quint8 encapsulation; // ENCAP_* layers peeled off before the network layer
+    quint8 ipVersion;   // 0 if not an IP packet
+    quint8 ipProto;
+    IpAddress sIP;
+    IpAddress dIP;
+    quint32 sPort;      // 65536 if none
+    quint32 dPort;
+    quint8 tcpFlags;
+    quint8 fragment;    // FRAGMENT_* state
+    quint32 fragmentId; // IPv4 or IPv6 fragment identification
+    quint8 malformed;   // MALFORMED_* layers, 0 if the whole frame decoded
+    quint32 weight;     // packets this one stands for, the sampling rate or 1
+    QString info;
+    QList<DiscoveredName> names;    // seen in name service answers, see NameDecoder
+};
 
 class CaptureThread : public QThread
 {
@@ -33,6 +102,10 @@ public:
     explicit CaptureThread(QObject *parent = 0);
     ~CaptureThread();
 
+    void setFragments(quint32 capacity, quint32 timeout);
+    void setSampling(quint8 mode, quint32 rate);
+    void setNameDiscovery(bool enabled);
+
     bool startCapture(pcap_if_t *d, quint8 mode, quint16 bytes, quint16 timeout, const QString &filterCode, qint32 packetsLimit);
     bool stopCapture();
 
@@ -47,6 +120,16 @@ private:
 
     pcap_t *adhandle;
 
+    // first fragments, used only by the thread while capturing
+    FragmentTable fragments;
+    quint32 fragmentsCapacity, fragmentsTimeout;
+
+    // sampling, SAMPLING_* mode, 1 in rate packets or flows
+    quint8 samplingMode;
+    quint32 samplingRate, samplingCounter;
+
+    bool sampled(const Packet &packet);
+
 signals:
     void infoMessage(quint8 type, const QString &title, const QString &message);
 
@@ -55,15 +138,6 @@ signals:
     void threadStarted();
     void threadStopped();
 
-    void receivedPacket(const QString &time,
-                        quint32 length,
-                        const QString &sMac,
-                        const QString &dMac,
-                        quint16 type,
-                        quint32 sIP,
-                        quint32 dIP,
-                        quint32 sPort,
-                        quint32 dPort,
-                        const QString &info);
+    void receivedPacket(const Packet &packet);
 };
 #endif // CAPTURETHREAD_H
@@ -0,0 +1,569 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "checkpoint.h"
+
+#ifdef Q_OS_WIN
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+static const char JOURNAL_MAGIC[8] = { 'L', 'A', 'N', 'A', 'C', 'K', 'P', 'T' };
+static const quint32 JOURNAL_VERSION = 1;
+static const int JOURNAL_HEADER = 12;
+
+// record frame: magic, payload size and checksum
+static const quint32 RECORD_MAGIC = 0x5245434b;
+static const int RECORD_HEADER = 10;
+
+// the smallest row, a bound for the row counts of a record
+static const int ROW_BYTES = 16;
+
+static void resizeHosts(Hosts &hosts, int count)
+{
+    while (hosts.hostIp.count() > count)
+    {
+        hosts.hostIp.removeLast();
+        hosts.hostName.removeLast();
+        hosts.dPort.removeLast();
+        hosts.dApp.removeLast();
+        hosts.upBytes.removeLast();
+        hosts.downBytes.removeLast();
+        hosts.firstVisit.removeLast();
+        hosts.lastVisit.removeLast();
+    }
+
+    while (hosts.hostIp.count() < count)
+    {
+        hosts.hostIp.append(IpAddress());
+        hosts.hostName.append("");
+        hosts.dPort.append("");
+        hosts.dApp.append("");
+        hosts.upBytes.append(0);
+        hosts.downBytes.append(0);
+        hosts.firstVisit.append(0);
+        hosts.lastVisit.append(0);
+    }
+}
+
+static void resizeApps(Apps &apps, QVector<quint64> &seen, int count)
+{
+    while (apps.hostPort.count() > count)
+    {
+        apps.hostPort.removeLast();
+        apps.hostPortName.removeLast();
+        apps.upBytes.removeLast();
+        apps.downBytes.removeLast();
+    }
+
+    while (apps.hostPort.count() < count)
+    {
+        apps.hostPort.append("");
+        apps.hostPortName.append("");
+        apps.upBytes.append(0);
+        apps.downBytes.append(0);
+    }
+
+    seen.resize(count);
+}
+
+//=====================================================================================================================================================================================================
+
+CheckpointRecord::CheckpointRecord(quint8 type, quint64 started, quint64 saved, const quint64 *netPackets, quint64 netUp, quint64 netDown)
+    : out(&payload, QIODevice::WriteOnly)
+{
+    out.setVersion(QDataStream::Qt_4_0);
+
+    out << type << started << saved;
+
+    for (int i = 0; i < 8; ++i)
+        out << netPackets[i];
+
+    out << netUp << netDown;
+}
+
+int CheckpointRecord::addUser(int user, const QString &ip, const QString &name, quint64 timeOn, quint64 up, quint64 down, quint32 peers,
+                              const quint32 *packets, const QByteArray &peersBytes, const Hosts &hosts, const Apps &apps,
+                              const QVector<quint64> &appsSeen, quint64 mark, int from, int maxRows, int *next)
+{
+    int hostCount = hosts.hostIp.count();
+    int rows = 0;
+
+    *next = 0;
+
+    out << (quint8)1 << (qint32)user << ip << name << timeOn << up << down << peers;
+
+    for (int i = 0; i < 24; ++i)
+        out << packets[i];
+
+    out << peersBytes;
+
+    // rows, each by its index, -1 ends them
+    out << (qint32)hostCount;
+    for (int i = from; i < hostCount; ++i)
+    {
+        if (hosts.lastVisit.at(i) < mark)
+            continue;
+
+        if (rows == maxRows)
+        {
+            *next = i;
+            break;
+        }
+
+        out << (qint32)i << hosts.hostIp.at(i).toString() << hosts.hostName.at(i) << hosts.dPort.at(i) << hosts.dApp.at(i)
+            << hosts.upBytes.at(i) << hosts.downBytes.at(i) << hosts.firstVisit.at(i) << hosts.lastVisit.at(i);
+        ++rows;
+    }
+    out << (qint32)-1;
+
+    out << (qint32)apps.hostPort.count();
+    for (int i = qMax(0, from - hostCount); i < apps.hostPort.count() && *next == 0; ++i)
+    {
+        if (appsSeen.at(i) < mark)
+            continue;
+
+        if (rows == maxRows)
+        {
+            *next = hostCount + i;
+            break;
+        }
+
+        out << (qint32)i << apps.hostPort.at(i) << apps.hostPortName.at(i) << apps.upBytes.at(i) << apps.downBytes.at(i) << appsSeen.at(i);
+        ++rows;
+    }
+    out << (qint32)-1;
+
+    return rows;
+}
+
+QByteArray CheckpointRecord::finish()
+{
+    out << (quint8)0;
+
+    QByteArray record;
+    QDataStream frame(&record, QIODevice::WriteOnly);
+
+    frame << RECORD_MAGIC << (quint32)payload.size() << qChecksum(payload.constData(), payload.size());
+    frame.writeRawData(payload.constData(), payload.size());
+
+    return record;
+}
+
+//=====================================================================================================================================================================================================
+
+CheckpointJournal::CheckpointJournal(QObject *parent) : QThread(parent)
+{
+    stopping = false;
+    writing = false;
+    removeOnClose = false;
+
+    validSize = 0;
+    compactSize = 0;
+}
+
+CheckpointJournal::~CheckpointJournal()
+{
+    close(false);
+}
+
+void CheckpointJournal::open(const QString &fileName, qint64 validSize, qint64 compactSize)
+{
+    close(false);
+
+    this->fileName = fileName;
+    this->validSize = validSize;
+    this->compactSize = compactSize;
+
+    queue.clear();
+    stopping = false;
+    writing = false;
+    removeOnClose = false;
+
+    start(QThread::LowPriority);
+}
+
+void CheckpointJournal::append(const QByteArray &record)
+{
+    QMutexLocker locker(&mutex);
+
+    queue.append(record);
+    queued.wakeOne();
+}
+
+void CheckpointJournal::close(bool remove)
+{
+    if (!isRunning())
+        return;
+
+    mutex.lock();
+    stopping = true;
+    removeOnClose = remove;
+    queued.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+bool CheckpointJournal::isBusy()
+{
+    QMutexLocker locker(&mutex);
+
+    return writing || !queue.isEmpty();
+}
+
+void CheckpointJournal::run()
+{
+    QFile file(fileName);
+    bool ok;
+
+    // a journal to go on with loses its torn tail
+    if (validSize > 0)
+        ok = file.open(QIODevice::ReadWrite) && file.resize(validSize) && file.seek(validSize);
+    else
+        ok = file.open(QIODevice::WriteOnly | QIODevice::Truncate) && writeHeader(file);
+
+    if (!ok)
+        // 3 - critical
+        emit infoMessage(3, tr("Checkpoint journal"), tr("Unable to write %1: %2").arg(fileName).arg(file.errorString()));
+
+    qint64 baseSize = 0;
+
+    forever
+    {
+        mutex.lock();
+
+        while (queue.isEmpty() && !stopping)
+            queued.wait(&mutex);
+
+        QList<QByteArray> records = queue;
+        queue.clear();
+        writing = !records.isEmpty();
+        bool stop = stopping;
+
+        mutex.unlock();
+
+        // without a journal the records are dropped, so the queue does not grow
+        for (int i = 0; ok && i < records.count(); ++i)
+        {
+            if (file.write(records.at(i)) != records.at(i).size())
+            {
+                ok = false;
+                emit infoMessage(3, tr("Checkpoint journal"), tr("Unable to write %1: %2").arg(fileName).arg(file.errorString()));
+            }
+        }
+
+        if (ok && !records.isEmpty())
+        {
+            file.flush();
+            sync(file);
+
+            // at least twice the compacted size, so a large base is not rewritten every time
+            if (file.size() > qMax(compactSize, 2 * baseSize))
+                ok = compact(file, &baseSize);
+        }
+
+        mutex.lock();
+        writing = false;
+        mutex.unlock();
+
+        if (stop)
+            break;
+    }
+
+    file.close();
+
+    if (removeOnClose)
+        QFile::remove(fileName);
+}
+
+// the journal replayed into one base record, written aside and renamed over it
+bool CheckpointJournal::compact(QFile &file, qint64 *baseSize)
+{
+    file.close();
+
+    CheckpointData data;
+    qint64 size;
+    int records;
+    QString error;
+
+    if (!recover(fileName, data, &size, &records, &error))
+    {
+        emit infoMessage(3, tr("Checkpoint journal"), error);
+        return false;
+    }
+
+    const SessionData &session = data.session;
+    CheckpointRecord base(CheckpointRecord::BASE, session.started, session.saved, session.netPackets, session.netUp, session.netDown);
+
+    for (int i = 0; i < session.usersList.count(); ++i)
+    {
+        quint32 packets[24];
+        for (int j = 0; j < 24; ++j)
+            packets[j] = session.usersPackets[j / 8][j % 8].at(i);
+
+        base.addUser(i, session.usersList.at(i), session.usersName.at(i), session.usersTimeOn.at(i), session.usersUp.at(i), session.usersDown.at(i),
+                     session.usersPeers.at(i), packets, data.usersPeers.at(i), session.usersHosts.at(i), session.usersApps.at(i), data.usersAppsSeen.at(i), 0);
+    }
+
+    QByteArray record = base.finish();
+    QFile compacted(fileName + ".tmp");
+
+    if (!compacted.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeHeader(compacted) || compacted.write(record) != record.size())
+    {
+        emit infoMessage(3, tr("Checkpoint journal"), tr("Unable to write %1: %2").arg(compacted.fileName()).arg(compacted.errorString()));
+        compacted.close();
+        QFile::remove(compacted.fileName());
+
+        // the old journal is still good
+        return file.open(QIODevice::ReadWrite) && file.resize(size) && file.seek(size);
+    }
+
+    compacted.flush();
+    sync(compacted);
+    compacted.close();
+
+    // the old journal is moved aside first, a rename does not replace a file on Windows;
+    // recover() takes the compacted journal if a crash comes in between
+    QString old = fileName + ".old";
+    QFile::remove(old);
+
+    if (!QFile::rename(fileName, old))
+    {
+        // 2 - warning
+        emit infoMessage(2, tr("Checkpoint journal"), tr("Unable to compact %1, the journal goes on uncompacted").arg(fileName));
+        QFile::remove(compacted.fileName());
+
+        return file.open(QIODevice::ReadWrite) && file.resize(size) && file.seek(size);
+    }
+
+    if (!QFile::rename(compacted.fileName(), fileName))
+    {
+        // the old journal back, the next compaction tries again
+        QFile::rename(old, fileName);
+        QFile::remove(compacted.fileName());
+
+        // 2 - warning
+        emit infoMessage(2, tr("Checkpoint journal"), tr("Unable to compact %1, the journal goes on uncompacted").arg(fileName));
+
+        return file.open(QIODevice::ReadWrite) && file.resize(size) && file.seek(size);
+    }
+
+    QFile::remove(old);
+
+    *baseSize = JOURNAL_HEADER + record.size();
+
+    return file.open(QIODevice::ReadWrite) && file.seek(*baseSize);
+}
+
+bool CheckpointJournal::writeHeader(QFile &file)
+{
+    QByteArray header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    QDataStream out(&header, QIODevice::WriteOnly | QIODevice::Append);
+    out << JOURNAL_VERSION;
+
+    return file.write(header) == header.size();
+}
+
+// written records survive a power loss too
+void CheckpointJournal::sync(QFile &file)
+{
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+}
+
+bool CheckpointJournal::recover(const QString &fileName, CheckpointData &data, qint64 *validSize, int *records, QString *error)
+{
+    // a compaction interrupted between the remove and the rename
+    if (!QFile::exists(fileName) && QFile::exists(fileName + ".tmp"))
+        QFile::rename(fileName + ".tmp", fileName);
+
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = tr("Unable to open %1: %2").arg(fileName).arg(file.errorString());
+        return false;
+    }
+
+    QByteArray journal = file.readAll();
+    file.close();
+
+    const uchar *bytes = (const uchar *)journal.constData();
+
+    if (journal.size() < JOURNAL_HEADER || memcmp(bytes, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0)
+    {
+        *error = tr("%1 is not a checkpoint journal").arg(fileName);
+        return false;
+    }
+
+    if (qFromBigEndian<quint32>(bytes + 8) != JOURNAL_VERSION)
+    {
+        *error = tr("%1 is of an unknown version").arg(fileName);
+        return false;
+    }
+
+    data = CheckpointData();
+    *records = 0;
+
+    // up to the first torn or damaged record, each applied whole or not at all
+    qint64 pos = JOURNAL_HEADER;
+    while (pos + RECORD_HEADER <= journal.size())
+    {
+        quint32 magic = qFromBigEndian<quint32>(bytes + pos);
+        quint32 size = qFromBigEndian<quint32>(bytes + pos + 4);
+        quint16 checksum = qFromBigEndian<quint16>(bytes + pos + 8);
+
+        if (magic != RECORD_MAGIC || size > (quint64)(journal.size() - pos - RECORD_HEADER))
+            break;
+
+        const char *payload = journal.constData() + pos + RECORD_HEADER;
+        if (qChecksum(payload, size) != checksum)
+            break;
+
+        CheckpointData next = data;
+        if (!apply(QByteArray::fromRawData(payload, size), next))
+            break;
+
+        data = next;
+        ++*records;
+        pos+=RECORD_HEADER + size;
+    }
+
+    *validSize = pos;
+
+    return true;
+}
+
+bool CheckpointJournal::apply(const QByteArray &payload, CheckpointData &data)
+{
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_4_0);
+
+    quint8 type = 0;
+    in >> type;
+
+    if (type == CheckpointRecord::BASE)
+        data = CheckpointData();
+    else if (type != CheckpointRecord::DELTA)
+        return false;
+
+    SessionData &session = data.session;
+
+    in >> session.started >> session.saved;
+    for (int i = 0; i < 8; ++i)
+        in >> session.netPackets[i];
+    in >> session.netUp >> session.netDown;
+
+    forever
+    {
+        quint8 more = 0;
+        in >> more;
+
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (!more)
+            break;
+
+        qint32 user;
+        in >> user;
+
+        // users are never removed, a new one comes right after the known ones
+        if (user < 0 || user > session.usersList.count())
+            return false;
+
+        if (user == session.usersList.count())
+        {
+            session.usersList.append("");
+            session.usersName.append("");
+            session.usersTimeOn.append(0);
+            session.usersUp.append(0);
+            session.usersDown.append(0);
+            session.usersPeers.append(0);
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 8; ++j)
+                    session.usersPackets[i][j].append(0);
+            session.usersHosts.append(Hosts());
+            session.usersApps.append(Apps());
+
+            data.usersPeers.append(QByteArray());
+            data.usersAppsSeen.append(QVector<quint64>());
+        }
+
+        in >> session.usersList[user] >> session.usersName[user] >> session.usersTimeOn[user] >> session.usersUp[user] >> session.usersDown[user] >> session.usersPeers[user];
+
+        for (int i = 0; i < 24; ++i)
+            in >> session.usersPackets[i / 8][i % 8][user];
+
+        in >> data.usersPeers[user];
+
+        Hosts &hosts = session.usersHosts[user];
+        qint32 count;
+        in >> count;
+
+        if (in.status() != QDataStream::Ok || count < 0 || count > hosts.hostIp.count() + in.device()->bytesAvailable() / ROW_BYTES)
+            return false;
+
+        resizeHosts(hosts, count);
+
+        forever
+        {
+            qint32 i;
+            in >> i;
+
+            if (in.status() != QDataStream::Ok || i < -1 || i >= count)
+                return false;
+
+            if (i == -1)
+                break;
+
+            QString ip;
+            in >> ip >> hosts.hostName[i] >> hosts.dPort[i] >> hosts.dApp[i] >> hosts.upBytes[i] >> hosts.downBytes[i] >> hosts.firstVisit[i] >> hosts.lastVisit[i];
+            hosts.hostIp[i] = IpAddress::fromString(ip);
+        }
+
+        Apps &apps = session.usersApps[user];
+        QVector<quint64> &seen = data.usersAppsSeen[user];
+        in >> count;
+
+        if (in.status() != QDataStream::Ok || count < 0 || count > apps.hostPort.count() + in.device()->bytesAvailable() / ROW_BYTES)
+            return false;
+
+        resizeApps(apps, seen, count);
+
+        forever
+        {
+            qint32 i;
+            in >> i;
+
+            if (in.status() != QDataStream::Ok || i < -1 || i >= count)
+                return false;
+
+            if (i == -1)
+                break;
+
+            in >> apps.hostPort[i] >> apps.hostPortName[i] >> apps.upBytes[i] >> apps.downBytes[i] >> seen[i];
+        }
+    }
+
+    return in.status() == QDataStream::Ok;
+}
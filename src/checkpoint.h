@@ -0,0 +1,113 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QVector>
+#include <QDataStream>
+#include <QFile>
+
+#include "sessionfile.h"
+
+// state kept in a checkpoint journal, a session and what is needed to go on counting
+struct CheckpointData
+{
+    SessionData session;
+
+    QList<QByteArray> usersPeers;               // HyperLogLog::toBytes()
+    QList< QVector<quint64> > usersAppsSeen;
+};
+
+// one journal record: the network counters, then the users written with only their
+// host and application rows seen at or after a mark; a base record replaces the state,
+// a delta record is applied on top of it
+class CheckpointRecord
+{
+public:
+    enum { BASE = 1, DELTA = 2 };
+
+    CheckpointRecord(quint8 type, quint64 started, quint64 saved, const quint64 *netPackets, quint64 netUp, quint64 netDown);
+
+    // returns the rows written, at most maxRows of them from row from on (the hosts, then
+    // the applications); next is the row to go on from, 0 if all of them were written
+    // packets are the 3 x 8 counters of SessionData::usersPackets
+    int addUser(int user, const QString &ip, const QString &name, quint64 timeOn, quint64 up, quint64 down, quint32 peers,
+                const quint32 *packets, const QByteArray &peersBytes, const Hosts &hosts, const Apps &apps,
+                const QVector<quint64> &appsSeen, quint64 mark, int from, int maxRows, int *next);
+
+    // the framed record
+    QByteArray finish();
+
+private:
+    QByteArray payload;
+    QDataStream out;
+};
+
+// append-only journal of checkpoint records written in its own thread, compacted into a
+// single base record when it grows past the compaction size; a record torn by a crash
+// fails its checksum, so recovery stops at the last complete one
+class CheckpointJournal : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(CheckpointJournal)
+
+public:
+    explicit CheckpointJournal(QObject *parent = 0);
+    ~CheckpointJournal();
+
+    // validSize is from recover() to go on with a journal, 0 starts a new one
+    void open(const QString &fileName, qint64 validSize, qint64 compactSize);
+    void append(const QByteArray &record);
+    // waits for the queued records, the journal is removed after a clean stop
+    void close(bool remove);
+
+    // true while records wait to be written, a checkpoint is then skipped
+    bool isBusy();
+
+    static bool recover(const QString &fileName, CheckpointData &data, qint64 *validSize, int *records, QString *error);
+
+protected:
+    void run();
+
+private:
+    QMutex mutex;
+    QWaitCondition queued;
+    QList<QByteArray> queue;
+    bool stopping;
+    bool writing;
+    bool removeOnClose;
+
+    QString fileName;
+    qint64 validSize;
+    qint64 compactSize;
+
+    bool compact(QFile &file, qint64 *baseSize);
+
+    static bool writeHeader(QFile &file);
+    static void sync(QFile &file);
+    static bool apply(const QByteArray &payload, CheckpointData &data);
+
+signals:
+    void infoMessage(quint8 type, const QString &title, const QString &message);
+};
+
+#endif // CHECKPOINT_H
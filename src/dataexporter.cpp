@@ -0,0 +1,345 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "dataexporter.h"
+
+#include <QDateTime>
+
+// the buffer is written out when it grows past this, progress is reported every PROGRESS_ROWS rows
+static const int BUFFER_SIZE = 1024 * 1024;
+static const int PROGRESS_ROWS = 1024;
+
+DataExporter::DataExporter(QObject *parent)
+    : QThread(parent)
+{
+    abort = 0;
+    rowStart = true;
+    writeError = false;
+    rows = 0;
+    totalRows = 0;
+}
+
+DataExporter::~DataExporter()
+{
+    cancel();
+    wait();
+}
+
+void DataExporter::exportData(const ExportJob &job)
+{
+    if (isRunning())
+        return;
+
+    this->job = job;
+    abort = 0;
+
+    start(QThread::LowPriority);
+}
+
+void DataExporter::cancel()
+{
+    abort = 1;
+}
+
+void DataExporter::run()
+{
+    field = job.field.toUtf8();
+    line = job.line.toUtf8();
+    buffer.reserve(BUFFER_SIZE + 64 * 1024);
+
+    // one row per user, or per row of a user's list
+    int users = job.usersList.count();
+    int applications = 0, hosts = 0;
+
+    for (int i = 0; i < users && i < job.usersApps.count(); ++i)
+        applications+=qMax(1, job.usersApps.at(i).hostPort.count());
+    for (int i = 0; i < users && i < job.usersHosts.count(); ++i)
+        hosts+=qMax(1, job.usersHosts.at(i).hostIp.count());
+
+    rows = 0;
+    totalRows = (job.users + job.packets + job.transfers) * users + (job.applications ? applications : 0) + (job.hosts ? hosts : 0);
+    emit progress(0, totalRows);
+
+    QString summary;
+
+    if (job.users)
+        summary.append(exportUsers());
+    if (job.packets)
+        summary.append(exportPackets());
+    if (job.transfers)
+        summary.append(exportTransfers());
+    if (job.applications)
+        summary.append(exportApplications());
+    if (job.hosts)
+        summary.append(exportHosts());
+
+    buffer.clear();
+    buffer.squeeze();
+
+    // the job keeps copies of the data until the next export otherwise
+    job = ExportJob();
+
+    emit progress(totalRows, totalRows);
+    emit exported(summary);
+}
+
+bool DataExporter::open(const QString &page)
+{
+    file.setFileName(job.folder + "/" + job.prefix + page + ".csv");
+
+    buffer.clear();
+    rowStart = true;
+    writeError = false;
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        // 3 - critical
+        emit infoMessage(3, tr("Exporting data"), tr("Unable to open file: %1").arg(file.fileName()));
+        return false;
+    }
+
+    return true;
+}
+
+// summary line of the page
+QString DataExporter::close(const QString &page)
+{
+    flush();
+    file.close();
+
+    if (abort)
+    {
+        file.remove();
+        return tr("%1 page: <b>CANCELLED</b><br>").arg(page);
+    }
+
+    if (writeError)
+    {
+        // 3 - critical
+        emit infoMessage(3, tr("Exporting data"), tr("Unable to write file %1: %2").arg(file.fileName()).arg(file.errorString()));
+        return tr("%1 page: <b>FAIL</b> (unable to write file)<br>").arg(page);
+    }
+
+    return tr("%1 page: <b>DONE</b><br>").arg(page);
+}
+
+void DataExporter::flush()
+{
+    if (!buffer.isEmpty() && file.write(buffer) != buffer.size())
+        writeError = true;
+
+    buffer.clear();
+}
+
+// quoted, quotes inside doubled
+void DataExporter::text(const QString &value)
+{
+    if (!rowStart)
+        buffer.append(field);
+    rowStart = false;
+
+    QByteArray utf8 = value.toUtf8();
+
+    buffer.append('"');
+    if (utf8.contains('"'))
+        buffer.append(utf8.replace("\"", "\"\""));
+    else
+        buffer.append(utf8);
+    buffer.append('"');
+}
+
+void DataExporter::number(quint64 value)
+{
+    if (!rowStart)
+        buffer.append(field);
+    rowStart = false;
+
+    buffer.append(QByteArray::number(value));
+}
+
+void DataExporter::empty(int count)
+{
+    for (int i = 0; i < count; ++i)
+        text(QString());
+}
+
+void DataExporter::endRow()
+{
+    buffer.append(line);
+    rowStart = true;
+
+    if (buffer.size() >= BUFFER_SIZE)
+        flush();
+
+    if (++rows % PROGRESS_ROWS == 0)
+        emit progress(rows, totalRows);
+}
+
+void DataExporter::headerRow(const QStringList &header)
+{
+    if (!job.header)
+        return;
+
+    for (int i = 0; i < header.count(); ++i)
+        text(header.at(i));
+
+    buffer.append(line);
+    rowStart = true;
+}
+
+QString DataExporter::exportUsers()
+{
+    if (!open("users"))
+        return tr("Users page: <b>FAIL</b> (unable to open file)<br>");
+
+    headerRow(job.usersHeader);
+
+    // IP, name and the time of connection, the other columns are not filled
+    for (int i = 0; i < job.usersList.count() && !abort; ++i)
+    {
+        text(job.usersList.at(i));
+        text(job.usersName.value(i));
+        text(job.usersTimeOn.value(i));
+        empty(job.usersHeader.count() - 3);
+        endRow();
+    }
+
+    return close(tr("Users"));
+}
+
+QString DataExporter::exportPackets()
+{
+    if (!open("packets"))
+        return tr("Packets page: <b>FAIL</b> (unable to open file)<br>");
+
+    headerRow(job.packetsHeader);
+
+    for (int i = 0; i < job.usersList.count() && !abort; ++i)
+    {
+        text(job.usersList.at(i));
+        text(job.usersName.value(i));
+
+        // a user gets counters with the next refresh
+        for (int j = 0; j < 8; ++j)
+        {
+            number(job.usersPackets[EXPORT_IN][j].value(i));
+            number(job.usersPackets[EXPORT_OUT][j].value(i));
+            number(job.usersPackets[EXPORT_ALL][j].value(i));
+        }
+
+        endRow();
+    }
+
+    return close(tr("Packets"));
+}
+
+QString DataExporter::exportTransfers()
+{
+    if (!open("transfers"))
+        return tr("Transfers page: <b>FAIL</b> (unable to open file)<br>");
+
+    headerRow(job.transfersHeader);
+
+    for (int i = 0; i < job.usersList.count() && !abort; ++i)
+    {
+        text(job.usersList.at(i));
+        text(job.usersName.value(i));
+        number(job.usersUp.value(i));
+        number(job.usersDown.value(i));
+        number(job.usersPeers.value(i));
+        endRow();
+    }
+
+    return close(tr("Transfers"));
+}
+
+QString DataExporter::exportApplications()
+{
+    if (!open("applications"))
+        return tr("Applications page: <b>FAIL</b> (unable to open file)<br>");
+
+    headerRow(job.applicationsHeader);
+
+    for (int i = 0; i < job.usersList.count() && i < job.usersApps.count() && !abort; ++i)
+    {
+        const Apps &app = job.usersApps.at(i);
+
+        text(job.usersList.at(i));
+        text(job.usersName.value(i));
+
+        if (app.hostPort.isEmpty())
+        {
+            empty(4);
+            endRow();
+        }
+
+        for (int j = 0; j < app.hostPort.count() && !abort; ++j)
+        {
+            // the user only on the first row
+            if (j > 0)
+                empty(2);
+
+            text(app.hostPort.at(j));
+            text(app.hostPortName.at(j));
+            number(app.upBytes.at(j));
+            number(app.downBytes.at(j));
+            endRow();
+        }
+    }
+
+    return close(tr("Applications"));
+}
+
+QString DataExporter::exportHosts()
+{
+    if (!open("hosts"))
+        return tr("Hosts page: <b>FAIL</b> (unable to open file)<br>");
+
+    headerRow(job.hostsHeader);
+
+    for (int i = 0; i < job.usersList.count() && i < job.usersHosts.count() && !abort; ++i)
+    {
+        const Hosts &host = job.usersHosts.at(i);
+
+        text(job.usersList.at(i));
+        text(job.usersName.value(i));
+
+        if (host.hostIp.isEmpty())
+        {
+            empty(8);
+            endRow();
+        }
+
+        for (int j = 0; j < host.hostIp.count() && !abort; ++j)
+        {
+            if (j > 0)
+                empty(2);
+
+            text(host.hostIp.at(j).toString());
+            text(host.hostName.at(j));
+            text(host.dPort.at(j));
+            text(host.dApp.at(j));
+            number(host.upBytes.at(j));
+            number(host.downBytes.at(j));
+            text(QDateTime::fromTime_t(host.firstVisit.at(j)).toString("yyyy-MM-dd hh:mm:ss"));
+            text(QDateTime::fromTime_t(host.lastVisit.at(j)).toString("yyyy-MM-dd hh:mm:ss"));
+            endRow();
+        }
+    }
+
+    return close(tr("Hosts"));
+}
@@ -0,0 +1,105 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DATAEXPORTER_H
+#define DATAEXPORTER_H
+
+#include <QThread>
+#include <QFile>
+#include <QByteArray>
+#include <QStringList>
+#include <QAtomicInt>
+
+#include "receivercore.h"
+
+// data of an export, copied from MainWindow when it starts; the lists are
+// implicitly shared, so the copy is cheap and the capture goes on meanwhile
+struct ExportJob
+{
+    QString folder;
+    QString prefix;             // date and time, the start of the file names
+    QString field, line;
+    bool header;
+    bool users, packets, transfers, applications, hosts;
+
+    QStringList usersHeader, packetsHeader, transfersHeader, applicationsHeader, hostsHeader;
+
+    QList<QString> usersList, usersName, usersTimeOn;
+    QList<quint32> usersPackets[3][8];  // EXPORT_* by ARP, RARP, ICMP, IGMP, TCP, UDP, other, total
+    QList<quint64> usersUp, usersDown;
+    QList<quint32> usersPeers;
+    QList<Hosts> usersHosts;
+    QList<Apps> usersApps;
+};
+
+// writes the CSV files of an export in its own thread; cells are collected in a
+// buffer written out in large blocks, byte counts are exact integers rather than
+// the rounded strings of the views, progress is reported every block of rows
+// and the export can be cancelled between rows
+class DataExporter : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DataExporter)
+
+public:
+    explicit DataExporter(QObject *parent = 0);
+    ~DataExporter();
+
+    void exportData(const ExportJob &job);
+
+public slots:
+    void cancel();
+
+protected:
+    virtual void run();
+
+private:
+    ExportJob job;
+    QAtomicInt abort;       // set by cancel() from the GUI thread
+
+    QFile file;
+    QByteArray buffer;
+    QByteArray field, line;
+    bool rowStart;
+    bool writeError;
+
+    int rows, totalRows;
+
+    bool open(const QString &page);
+    QString close(const QString &page);
+    void flush();
+
+    void text(const QString &value);
+    void number(quint64 value);
+    void empty(int count);
+    void endRow();
+    void headerRow(const QStringList &header);
+
+    QString exportUsers();
+    QString exportPackets();
+    QString exportTransfers();
+    QString exportApplications();
+    QString exportHosts();
+
+signals:
+    void infoMessage(quint8 type, const QString &title, const QString &message);
+
+    void progress(int value, int maximum);
+    void exported(const QString &summary);
+};
+
+#endif // DATAEXPORTER_H
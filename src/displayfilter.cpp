@@ -0,0 +1,634 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "displayfilter.h"
+
+namespace
+{
+    enum Opcode
+    {
+        OP_TEST = 0,
+        OP_AND,
+        OP_OR,
+        OP_NOT
+    };
+
+    enum Field
+    {
+        FIELD_IP = 0,       // source or destination
+        FIELD_SRC,
+        FIELD_DST,
+        FIELD_USER,
+        FIELD_PORT,         // source or destination
+        FIELD_SPORT,
+        FIELD_DPORT,
+        FIELD_PROTOCOL,     // ProtocolId in a set
+        FIELD_IPPROTO,
+        FIELD_LENGTH,
+        FIELD_FLAGS,
+        FIELD_VLAN
+    };
+
+    enum Compare
+    {
+        CMP_EQ = 0,
+        CMP_LT,
+        CMP_LE,
+        CMP_GT,
+        CMP_GE
+    };
+
+    struct Name
+    {
+        const char *name;
+        quint32 value;
+    };
+
+    // protocol names, sets of ProtocolId bits
+    const Name protocolNames[] =
+    {
+        { "arp", 1<<PROTO_ARP },
+        { "rarp", 1<<PROTO_RARP },
+        { "ip", 1<<PROTO_IPV4 | 1<<PROTO_IPV4_ICMP | 1<<PROTO_IPV4_IGMP | 1<<PROTO_IPV4_TCP | 1<<PROTO_IPV4_UDP },
+        { "ipv4", 1<<PROTO_IPV4 | 1<<PROTO_IPV4_ICMP | 1<<PROTO_IPV4_IGMP | 1<<PROTO_IPV4_TCP | 1<<PROTO_IPV4_UDP },
+        { "ip6", 1<<PROTO_IPV6 | 1<<PROTO_IPV6_ICMP | 1<<PROTO_IPV6_TCP | 1<<PROTO_IPV6_UDP },
+        { "ipv6", 1<<PROTO_IPV6 | 1<<PROTO_IPV6_ICMP | 1<<PROTO_IPV6_TCP | 1<<PROTO_IPV6_UDP },
+        { "icmp", 1<<PROTO_IPV4_ICMP | 1<<PROTO_IPV6_ICMP },
+        { "icmp6", 1<<PROTO_IPV6_ICMP },
+        { "igmp", 1<<PROTO_IPV4_IGMP },
+        { "tcp", 1<<PROTO_IPV4_TCP | 1<<PROTO_IPV6_TCP },
+        { "udp", 1<<PROTO_IPV4_UDP | 1<<PROTO_IPV6_UDP },
+        { "wol", 1<<PROTO_WOL },
+        { "ipx", 1<<PROTO_IPX },
+        { "pppoe", 1<<PROTO_PPPOE_DISCOVERY | 1<<PROTO_PPPOE_SESSION },
+        { "other", 1<<PROTO_OTHER },
+        { 0, 0 }
+    };
+
+    const Name flagNames[] =
+    {
+        { "fin", 0x01 },
+        { "syn", 0x02 },
+        { "rst", 0x04 },
+        { "psh", 0x08 },
+        { "ack", 0x10 },
+        { "urg", 0x20 },
+        { "ece", 0x40 },
+        { "cwr", 0x80 },
+        { 0, 0 }
+    };
+
+    bool findName(const Name *names, const QString &name, quint32 *value)
+    {
+        for (int i = 0; names[i].name; ++i)
+        {
+            if (name == names[i].name)
+            {
+                *value = names[i].value;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool isKeyword(const QString &token)
+    {
+        return token == "and" || token == "or" || token == "not" || token == "&&" || token == "||" || token == "!" || token == ")";
+    }
+
+    // the comparison is chosen once per batch, so every loop is a single vectorizable statement
+    template<class T> void compare(quint8 *m, const T *c, int n, quint8 cmp, quint32 v)
+    {
+        int i;
+
+        switch (cmp)
+        {
+            case CMP_EQ: for (i = 0; i < n; ++i) m[i] = c[i] == v; break;
+            case CMP_LT: for (i = 0; i < n; ++i) m[i] = c[i] < v; break;
+            case CMP_LE: for (i = 0; i < n; ++i) m[i] = c[i] <= v; break;
+            case CMP_GT: for (i = 0; i < n; ++i) m[i] = c[i] > v; break;
+            case CMP_GE: for (i = 0; i < n; ++i) m[i] = c[i] >= v; break;
+        }
+    }
+
+    // ports, 65536 (no port) never matches
+    void comparePort(quint8 *m, const quint32 *c, int n, quint8 cmp, quint32 v)
+    {
+        compare(m, c, n, cmp, v);
+
+        for (int i = 0; i < n; ++i)
+            m[i] &= c[i] < 65536;
+    }
+
+    void compareAddress(quint8 *m, const IpAddress *c, int n, const IpAddress &address, quint32 bits)
+    {
+        int i;
+
+        if (bits == (address.isIPv4() ? 32u : 128u))
+        {
+            for (i = 0; i < n; ++i)
+                m[i] = c[i] == address;
+        }
+        else
+        {
+            for (i = 0; i < n; ++i)
+                m[i] = c[i].samePrefix(address, bits);
+        }
+    }
+}
+
+DisplayFilter::DisplayFilter()
+{
+    depth = 0;
+    next = 0;
+}
+
+void DisplayFilter::clear()
+{
+    text.clear();
+    program.clear();
+    depth = 0;
+}
+
+bool DisplayFilter::compile(const QString &expression, QString *error)
+{
+    clear();
+
+    // tokens: words (names, numbers, addresses), parentheses and operators
+    tokens.clear();
+    next = 0;
+    parseError.clear();
+
+    QString e = expression.toLower();
+    int i = 0;
+
+    while (i < e.length())
+    {
+        QChar c = e.at(i);
+
+        if (c.isSpace())
+        {
+            ++i;
+            continue;
+        }
+
+        if (c == '(' || c == ')')
+        {
+            tokens.append(QString(c));
+            ++i;
+            continue;
+        }
+
+        QString two = e.mid(i, 2);
+        if (two == "==" || two == "!=" || two == "<=" || two == ">=" || two == "&&" || two == "||")
+        {
+            tokens.append(two);
+            i += 2;
+            continue;
+        }
+
+        if (c == '<' || c == '>' || c == '=' || c == '!')
+        {
+            tokens.append(QString(c));
+            ++i;
+            continue;
+        }
+
+        int start = i;
+        while (i < e.length() && !e.at(i).isSpace() && !QString("()<>=!&|").contains(e.at(i)))
+            ++i;
+
+        if (i == start)
+        {
+            if (error)
+                *error = QObject::tr("Unexpected character \"%1\"").arg(c);
+            return false;
+        }
+
+        tokens.append(e.mid(start, i - start));
+    }
+
+    // empty filter shows all packets
+    if (tokens.isEmpty())
+        return true;
+
+    if (!parseOr() || !atEnd())
+    {
+        if (parseError.isEmpty())
+            parseError = QObject::tr("Unexpected \"%1\"").arg(peek());
+
+        if (error)
+            *error = parseError;
+
+        program.clear();
+        return false;
+    }
+
+    // masks on the stack at the same time
+    int top = 0;
+    for (i = 0; i < program.count(); ++i)
+    {
+        if (program.at(i).opcode == OP_TEST)
+            depth = qMax(depth, ++top);
+        else if (program.at(i).opcode != OP_NOT)
+            --top;
+    }
+
+    text = expression;
+    return true;
+}
+
+bool DisplayFilter::parseOr()
+{
+    if (!parseAnd())
+        return false;
+
+    while (peek() == "or" || peek() == "||")
+    {
+        ++next;
+        if (!parseAnd())
+            return false;
+        append(OP_OR);
+    }
+
+    return true;
+}
+
+bool DisplayFilter::parseAnd()
+{
+    if (!parseNot())
+        return false;
+
+    while (peek() == "and" || peek() == "&&")
+    {
+        ++next;
+        if (!parseNot())
+            return false;
+        append(OP_AND);
+    }
+
+    return true;
+}
+
+bool DisplayFilter::parseNot()
+{
+    if (peek() == "not" || peek() == "!")
+    {
+        ++next;
+        if (!parseNot())
+            return false;
+        append(OP_NOT);
+        return true;
+    }
+
+    return parsePrimary();
+}
+
+bool DisplayFilter::parsePrimary()
+{
+    if (peek() == "(")
+    {
+        ++next;
+        if (!parseOr())
+            return false;
+
+        if (peek() != ")")
+        {
+            parseError = QObject::tr("Missing \")\"");
+            return false;
+        }
+
+        ++next;
+        return true;
+    }
+
+    return parseTest();
+}
+
+bool DisplayFilter::parseTest()
+{
+    if (atEnd())
+    {
+        parseError = QObject::tr("Unexpected end of the filter");
+        return false;
+    }
+
+    QString name = tokens.at(next++);
+    quint8 cmp = CMP_EQ;
+    bool negate = false;
+    quint32 value;
+
+    // addresses, "ip" alone is the protocol
+    if ((name == "ip" && !atEnd() && !isKeyword(peek())) || name == "host" || name == "src" || name == "dst" || name == "user")
+    {
+        IpAddress address;
+        quint8 field = name == "src" ? FIELD_SRC : name == "dst" ? FIELD_DST : name == "user" ? FIELD_USER : FIELD_IP;
+
+        if (!parseCompare(&cmp, &negate, false) || !parseAddress(&address, &value))
+            return false;
+
+        append(OP_TEST, field, CMP_EQ, value, address);
+    }
+    // numbers
+    else if (name == "port" || name == "sport" || name == "dport" || name == "length" || name == "len" || name == "vlan")
+    {
+        quint8 field = name == "port" ? FIELD_PORT : name == "sport" ? FIELD_SPORT : name == "dport" ? FIELD_DPORT : name == "vlan" ? FIELD_VLAN : FIELD_LENGTH;
+
+        if (!parseCompare(&cmp, &negate, true) || !parseNumber(&value))
+            return false;
+
+        append(OP_TEST, field, cmp, value);
+    }
+    else if (name == "proto")
+    {
+        if (!parseCompare(&cmp, &negate, false))
+            return false;
+
+        if (!atEnd() && findName(protocolNames, peek(), &value))
+        {
+            ++next;
+            append(OP_TEST, FIELD_PROTOCOL, CMP_EQ, value);
+        }
+        else
+        {
+            if (!parseNumber(&value))
+                return false;
+            append(OP_TEST, FIELD_IPPROTO, CMP_EQ, value);
+        }
+    }
+    else if (name == "flags")
+    {
+        if (!parseCompare(&cmp, &negate, false))
+            return false;
+
+        // all of the listed flags set, for example syn,ack
+        QStringList flags = peek().split(',', QString::SkipEmptyParts);
+        quint32 flag;
+        value = 0;
+
+        for (int i = 0; i < flags.count(); ++i)
+        {
+            if (!findName(flagNames, flags.at(i), &flag))
+            {
+                parseError = QObject::tr("Unknown TCP flag \"%1\"").arg(flags.at(i));
+                return false;
+            }
+            value |= flag;
+        }
+
+        if (!value)
+        {
+            parseError = QObject::tr("TCP flags expected");
+            return false;
+        }
+
+        ++next;
+        append(OP_TEST, FIELD_FLAGS, CMP_EQ, value);
+    }
+    // protocol name alone
+    else if (findName(protocolNames, name, &value))
+    {
+        append(OP_TEST, FIELD_PROTOCOL, CMP_EQ, value);
+    }
+    else
+    {
+        parseError = QObject::tr("Unknown field \"%1\"").arg(name);
+        return false;
+    }
+
+    if (negate)
+        append(OP_NOT);
+
+    return true;
+}
+
+// optional comparison, "!=" is a test followed by a negation
+bool DisplayFilter::parseCompare(quint8 *compare, bool *negate, bool ordered)
+{
+    QString op = peek();
+
+    *compare = CMP_EQ;
+    *negate = false;
+
+    if (op == "==" || op == "=")
+    {
+        ++next;
+        return true;
+    }
+
+    if (op == "!=")
+    {
+        *negate = true;
+        ++next;
+        return true;
+    }
+
+    if (op == "<" || op == "<=" || op == ">" || op == ">=")
+    {
+        if (!ordered)
+        {
+            parseError = QObject::tr("\"%1\" is not allowed here").arg(op);
+            return false;
+        }
+
+        *compare = op == "<" ? CMP_LT : op == "<=" ? CMP_LE : op == ">" ? CMP_GT : CMP_GE;
+        ++next;
+    }
+
+    return true;
+}
+
+bool DisplayFilter::parseNumber(quint32 *value)
+{
+    bool ok = false;
+
+    if (!atEnd())
+        *value = peek().toUInt(&ok, 0);
+
+    if (!ok)
+    {
+        parseError = QObject::tr("Number expected instead of \"%1\"").arg(peek());
+        return false;
+    }
+
+    ++next;
+    return true;
+}
+
+// address with an optional prefix length, 192.168.1.0/24
+bool DisplayFilter::parseAddress(IpAddress *address, quint32 *bits)
+{
+    QString token = peek();
+    QString prefix = token.section('/', 1);
+
+    *address = IpAddress::fromString(token.section('/', 0, 0));
+
+    if (address->isNull())
+    {
+        parseError = QObject::tr("IP address expected instead of \"%1\"").arg(token);
+        return false;
+    }
+
+    quint32 full = address->isIPv4() ? 32 : 128;
+    bool ok = true;
+
+    *bits = prefix.isEmpty() ? full : prefix.toUInt(&ok);
+
+    if (!ok || *bits > full)
+    {
+        parseError = QObject::tr("Invalid prefix length \"%1\"").arg(prefix);
+        return false;
+    }
+
+    ++next;
+    return true;
+}
+
+void DisplayFilter::append(quint8 opcode, quint8 field, quint8 compare, quint32 value, const IpAddress &address)
+{
+    Instruction instruction;
+
+    instruction.opcode = opcode;
+    instruction.field = field;
+    instruction.compare = compare;
+    instruction.value = value;
+    instruction.address = address;
+
+    program.append(instruction);
+}
+
+void DisplayFilter::filter(const PacketStore &store, int begin, int end, QVector<int> &rows) const
+{
+    int i;
+
+    if (program.isEmpty())
+    {
+        for (i = begin; i < end; ++i)
+            rows.append(i);
+        return;
+    }
+
+    // one more mask as the scratch of the tests of either address or port
+    QVector<quint8> masks((depth + 1) * BATCH);
+
+    for (int b = begin; b < end; b += BATCH)
+    {
+        int n = qMin((int)BATCH, end - b);
+        quint8 *top = masks.data();
+
+        for (int p = 0; p < program.count(); ++p)
+        {
+            const Instruction &instruction = program.at(p);
+
+            switch (instruction.opcode)
+            {
+                case OP_TEST:
+                    test(store, instruction, b, n, top, top + BATCH);
+                    top += BATCH;
+                    break;
+                case OP_AND:
+                    top -= BATCH;
+                    for (i = 0; i < n; ++i)
+                        top[i - BATCH] &= top[i];
+                    break;
+                case OP_OR:
+                    top -= BATCH;
+                    for (i = 0; i < n; ++i)
+                        top[i - BATCH] |= top[i];
+                    break;
+                case OP_NOT:
+                    for (i = 0; i < n; ++i)
+                        top[i - BATCH] ^= 1;
+                    break;
+            }
+        }
+
+        const quint8 *m = masks.constData();
+        for (i = 0; i < n; ++i)
+        {
+            if (m[i])
+                rows.append(b + i);
+        }
+    }
+}
+
+void DisplayFilter::test(const PacketStore &store, const Instruction &instruction, int begin, int n, quint8 *m, quint8 *scratch) const
+{
+    quint32 v = instruction.value;
+    quint8 cmp = instruction.compare;
+    int i;
+
+    switch (instruction.field)
+    {
+        case FIELD_IP:
+        {
+            // either address, the destination tested into the scratch mask
+            compareAddress(m, store.sIP.constData() + begin, n, instruction.address, v);
+            compareAddress(scratch, store.dIP.constData() + begin, n, instruction.address, v);
+            for (i = 0; i < n; ++i)
+                m[i] |= scratch[i];
+            break;
+        }
+        case FIELD_SRC:
+            compareAddress(m, store.sIP.constData() + begin, n, instruction.address, v);
+            break;
+        case FIELD_DST:
+            compareAddress(m, store.dIP.constData() + begin, n, instruction.address, v);
+            break;
+        case FIELD_USER:
+            compareAddress(m, store.user.constData() + begin, n, instruction.address, v);
+            break;
+        case FIELD_PORT:
+        {
+            comparePort(m, store.sPort.constData() + begin, n, cmp, v);
+            comparePort(scratch, store.dPort.constData() + begin, n, cmp, v);
+            for (i = 0; i < n; ++i)
+                m[i] |= scratch[i];
+            break;
+        }
+        case FIELD_SPORT:
+            comparePort(m, store.sPort.constData() + begin, n, cmp, v);
+            break;
+        case FIELD_DPORT:
+            comparePort(m, store.dPort.constData() + begin, n, cmp, v);
+            break;
+        case FIELD_PROTOCOL:
+        {
+            const quint8 *c = store.protocol.constData() + begin;
+            for (i = 0; i < n; ++i)
+                m[i] = (v >> c[i]) & 1;
+            break;
+        }
+        case FIELD_IPPROTO:
+            compare(m, store.ipProto.constData() + begin, n, cmp, v);
+            break;
+        case FIELD_LENGTH:
+            compare(m, store.length.constData() + begin, n, cmp, v);
+            break;
+        case FIELD_FLAGS:
+        {
+            const quint8 *c = store.tcpFlags.constData() + begin;
+            for (i = 0; i < n; ++i)
+                m[i] = (c[i] & v) == v;
+            break;
+        }
+        case FIELD_VLAN:
+            compare(m, store.vlan.constData() + begin, n, cmp, v);
+            break;
+    }
+}
@@ -0,0 +1,87 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISPLAYFILTER_H
+#define DISPLAYFILTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "packetstore.h"
+
+// display filter over the stored packets, for example
+//   tcp and port 80 and not ip 192.168.1.10
+//   (udp or flags syn,ack) and length > 1000 and user 192.168.1.0/24
+// compiled to a postfix program of column tests; each test is a plain loop over one
+// column of a batch of rows and the results are combined as byte masks
+class DisplayFilter
+{
+public:
+    DisplayFilter();
+
+    bool compile(const QString &expression, QString *error = 0);
+    void clear();
+
+    bool isEmpty() const { return program.isEmpty(); }
+    const QString &expression() const { return text; }
+
+    // appends the matching rows of [begin, end) to rows
+    void filter(const PacketStore &store, int begin, int end, QVector<int> &rows) const;
+
+private:
+    struct Instruction
+    {
+        quint8 opcode;
+        quint8 field;
+        quint8 compare;
+        quint32 value;      // number, ProtocolId bits, TCP flag bits or prefix length
+        IpAddress address;
+    };
+
+    // rows tested at once, the masks of a batch stay in the cache
+    enum { BATCH = 4096 };
+
+    QString text;
+    QVector<Instruction> program;
+    int depth;              // masks needed by the program
+
+    // parser
+    QStringList tokens;
+    int next;
+    QString parseError;
+
+    bool parseOr();
+    bool parseAnd();
+    bool parseNot();
+    bool parsePrimary();
+    bool parseTest();
+
+    bool parseCompare(quint8 *compare, bool *negate, bool ordered);
+    bool parseNumber(quint32 *value);
+    bool parseAddress(IpAddress *address, quint32 *bits);
+
+    void append(quint8 opcode, quint8 field = 0, quint8 compare = 0, quint32 value = 0, const IpAddress &address = IpAddress());
+
+    bool atEnd() const { return next >= tokens.count(); }
+    QString peek() const { return atEnd() ? QString() : tokens.at(next); }
+
+    void test(const PacketStore &store, const Instruction &instruction, int begin, int n, quint8 *mask, quint8 *scratch) const;
+};
+
+#endif // DISPLAYFILTER_H
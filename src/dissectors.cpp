@@ -0,0 +1,677 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "dissectors.h"
+#include "capturethread.h"
+#include "namedecoder.h"
+
+#include <string.h>
+
+namespace
+{
+    struct EtherTypeEntry
+    {
+        quint8 protocol;
+        Dissector dissector;
+    };
+
+    struct IpProtocolEntry
+    {
+        quint8 protocol[2];     // [0] over IPv4, [1] over IPv6
+        Dissector dissector;
+    };
+
+    // EtherType -> entry, 0 is the unregistered entry
+    quint8 etherTypeIndex[65536];
+    EtherTypeEntry etherTypes[32];
+    int etherTypesCount = 1;
+
+    IpProtocolEntry ipProtocols[256];
+
+    QString names[PROTO_COUNT];
+    quint8 counters[PROTO_COUNT];
+
+    // message names indexed by the type field, built once
+    QString tcpFlagNames[256];
+    QString icmpNames[256];
+    QString icmp6Names[256];
+    QString igmpNames[256];
+    QString pppoeNames[256];
+
+    QString notSupported;
+    QString fragmentName;
+    QString malformedName;
+
+    bool initialized = false;
+    bool nameDiscovery = false;
+
+    void setNames(QString *table, const QString &unknown, const quint8 *types, const char * const *mesg, int count)
+    {
+        for (int i = 0; i < 256; ++i)
+            table[i] = unknown;
+
+        for (int i = 0; i < count; ++i)
+            table[types[i]] = mesg[i];
+    }
+
+    void setMalformed(Packet &packet, quint8 layer)
+    {
+        packet.malformed |= layer;
+        packet.info = malformedName;
+    }
+}
+
+//=====================================================================================================================================================================================================
+// network layer
+
+static void dissectArp(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<arp_header> arpHeader(data, end);
+
+    if (!arpHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    // 1 ARP request
+    // 2 ARP response
+    // 3 RARP request
+    // 4 RARP response
+    // 5 Dynamic RARP request
+    // 6 Dynamic RARP reply
+    // 7 Dynamic RARP error
+    // 8 InARP request
+    // 9 InARP reply
+
+    switch (ntohs(arpHeader->oper))
+    {
+        case 1: packet.info = "ARP request"; break;
+        case 2: packet.info = "ARP response"; break;
+        case 3: packet.info = "RARP request"; break;
+        case 4: packet.info = "RARP response"; break;
+        default: break;
+    }
+
+    quint32 address;
+
+    memcpy(&address, &arpHeader->spa, 4);
+    packet.sIP = IpAddress(address);
+
+    memcpy(&address, &arpHeader->tpa, 4);
+    packet.dIP = IpAddress(address);
+}
+
+static void dissectIPv4(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<ip_header> ipHeader(data, end);
+
+    if (!ipHeader.isValid() || (ipHeader->ver_ihl >> 4) != 4)
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    // Internet Header Length is the length of the internet header in 32
+    // bit words, and thus points to the beginning of the data.
+    // Note that the minimum value for a correct header is 5 (5×32 = 160 bits).
+    // Being a 4-bit value, the maximum length is 15 words (15×32 bits) or 480 bits.
+
+    quint32 ip_hlen = (ipHeader->ver_ihl & 0xf) << 2;
+    quint32 tlen = ntohs(ipHeader->tlen);
+
+    packet.ipVersion = 4;
+    packet.ipProto = ipHeader->proto;
+    packet.sIP = IpAddress(ipHeader->saddr);
+    packet.dIP = IpAddress(ipHeader->daddr);
+
+    // total length 0 is left by TCP segmentation offload on outgoing packets
+    if (ip_hlen < 20 || !captured(data, end, ip_hlen) || (tlen != 0 && tlen < ip_hlen))
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    // Ethernet padding is not part of the datagram
+    if (tlen != 0 && captured(data, end, tlen))
+        end = data + tlen;
+
+    // fragments: more fragments flag (0x2000) or a fragment offset (0x1fff),
+    // only the first fragment carries the upper layer header
+    quint16 flags_fo = ntohs(ipHeader->flags_fo);
+
+    if (flags_fo & 0x3fff)
+    {
+        packet.fragmentId = ntohs(ipHeader->identification);
+
+        if (flags_fo & 0x1fff)
+        {
+            packet.fragment = FRAGMENT_LATER;
+            packet.protocol = ipProtocols[ipHeader->proto].protocol[0];
+            packet.info = fragmentName;
+            return;
+        }
+
+        packet.fragment = FRAGMENT_FIRST;
+    }
+
+    Dissectors::dissectTransport(packet, ipHeader->proto, data + ip_hlen, end);
+}
+
+static void dissectIPv6(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<ip6_header> ip6Header(data, end);
+
+    if (!ip6Header.isValid() || (data[0] >> 4) != 6)
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    packet.ipVersion = 6;
+    packet.sIP = IpAddress(ip6Header->saddr);
+    packet.dIP = IpAddress(ip6Header->daddr);
+
+    // Ethernet padding is not part of the datagram, payload length 0 is a jumbogram
+    quint32 plen = ntohs(ip6Header->plen);
+
+    if (plen != 0 && captured(data, end, IPV6_LENGTH + plen))
+        end = data + IPV6_LENGTH + plen;
+
+    // walk the extension header chain up to the upper layer header
+    quint8 next = ip6Header->next;
+    const quint8 *l4Header = data + IPV6_LENGTH;
+    bool later = false;
+
+    while (next == 0 || next == 43 || next == 60 || next == 44 || next == 51)
+    {
+        HeaderView<ip6_ext_header> extHeader(l4Header, end, 8);
+
+        if (!extHeader.isValid())
+        {
+            packet.ipProto = next;
+            setMalformed(packet, MALFORMED_NETWORK);
+            return;
+        }
+
+        // 0 Hop-by-Hop Options, 43 Routing, 60 Destination Options: length in 8 octets, not including the first 8
+        if (next == 0 || next == 43 || next == 60)
+            l4Header += (extHeader->len + 1) << 3;
+
+        // 44 Fragment: 8 octets, offset (13 bits) + M flag, identification;
+        // only the first fragment carries the upper layer header
+        if (next == 44)
+        {
+            quint16 offset_m = ntohs(*(const quint16*)(l4Header + 2));
+
+            if (offset_m & 0xfff9)
+            {
+                packet.fragmentId = ntohl(*(const quint32*)(l4Header + 4));
+                packet.fragment = FRAGMENT_FIRST;
+                later = (offset_m & 0xfff8) != 0;
+            }
+
+            l4Header += 8;
+        }
+
+        // 51 Authentication Header: length in 4 octets, not including the first 8
+        if (next == 51)
+            l4Header += (extHeader->len + 2) << 2;
+
+        next = extHeader->next;
+
+        if (later)
+            break;
+    }
+
+    packet.ipProto = next;
+
+    if (later)
+    {
+        packet.fragment = FRAGMENT_LATER;
+        packet.protocol = ipProtocols[next].protocol[1];
+        packet.info = fragmentName;
+        return;
+    }
+
+    // extension headers longer than the captured data
+    if (!captured(l4Header, end, 0))
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    Dissectors::dissectTransport(packet, next, l4Header, end);
+}
+
+static void dissectPppoeDiscovery(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    // no PPP protocol field in the discovery stage
+    HeaderView<pppoe_header> pppoeHeader(data, end, PPPOE_LENGTH - 2);
+
+    if (!pppoeHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_NETWORK);
+        return;
+    }
+
+    packet.info = pppoeNames[pppoeHeader->code];
+}
+
+//=====================================================================================================================================================================================================
+// transport layer
+
+static void dissectTcp(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<tcp_header> tcpHeader(data, end);
+
+    // data offset in 32 bit words, at least 5
+    if (!tcpHeader.isValid() || (tcpHeader->offset >> 4) < 5)
+    {
+        setMalformed(packet, MALFORMED_TRANSPORT);
+        return;
+    }
+
+    packet.sPort = ntohs(tcpHeader->sport);
+    packet.dPort = ntohs(tcpHeader->dport);
+    packet.tcpFlags = tcpHeader->flag;
+    packet.info = tcpFlagNames[tcpHeader->flag];
+}
+
+static void dissectUdp(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<udp_header> udpHeader(data, end);
+
+    if (!udpHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_TRANSPORT);
+        return;
+    }
+
+    packet.sPort = ntohs(udpHeader->sport);
+    packet.dPort = ntohs(udpHeader->dport);
+
+    if (nameDiscovery)
+        NameDecoder::decode(packet, data + sizeof(udp_header), end);
+}
+
+static void dissectIcmp(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<icmp_header> icmpHeader(data, end);
+
+    if (!icmpHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_TRANSPORT);
+        return;
+    }
+
+    packet.info = icmpNames[icmpHeader->type];
+}
+
+static void dissectIcmp6(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<icmp_header> icmpHeader(data, end);
+
+    if (!icmpHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_TRANSPORT);
+        return;
+    }
+
+    packet.info = icmp6Names[icmpHeader->type];
+}
+
+static void dissectIgmp(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    HeaderView<igmp_header> igmpHeader(data, end);
+
+    if (!igmpHeader.isValid())
+    {
+        setMalformed(packet, MALFORMED_TRANSPORT);
+        return;
+    }
+
+    packet.info = igmpNames[igmpHeader->type];
+}
+
+//=====================================================================================================================================================================================================
+
+void Dissectors::init()
+{
+    if (initialized)
+        return;
+
+    initialized = true;
+
+    notSupported = "protocol not supported";
+    fragmentName = "fragment";
+    malformedName = "malformed or truncated header";
+
+    // protocol names and counters
+    static const char * const protocolNames[PROTO_COUNT] = { "protocol not supported", "ARP", "RARP",
+                                                             "IPv4", "IPv4 ICMP", "IPv4 IGMP", "IPv4 TCP", "IPv4 UDP",
+                                                             "IPv6", "IPv6 ICMP", "IPv6 TCP", "IPv6 UDP",
+                                                             "WOL", "IPX", "PPPoE Discovery", "PPPoE" };
+
+    static const quint8 protocolCounters[PROTO_COUNT] = { COUNTER_OTHER, COUNTER_ARP, COUNTER_RARP,
+                                                          COUNTER_OTHER, COUNTER_ICMP, COUNTER_IGMP, COUNTER_TCP, COUNTER_UDP,
+                                                          COUNTER_OTHER, COUNTER_ICMP, COUNTER_TCP, COUNTER_UDP,
+                                                          COUNTER_OTHER, COUNTER_OTHER, COUNTER_OTHER, COUNTER_OTHER };
+
+    for (int i = 0; i < PROTO_COUNT; ++i)
+    {
+        names[i] = protocolNames[i];
+        counters[i] = protocolCounters[i];
+    }
+
+    // TCP flags
+    static const char * const tcpFlags[8] = { "FIN ", "SYN ", "RST ", "PSH ", "ACK ", "URG ", "ECE ", "CWR " };
+
+    for (int i = 0; i < 256; ++i)
+        for (int j = 0; j < 8; ++j)
+            if (i & 1<<j)
+                tcpFlagNames[i].append(tcpFlags[j]);
+
+    // ICMP
+    static const quint8 icmpTypes[] = { 0, 3, 4, 5, 6, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18 };
+    static const char * const icmpMesg[] = { "Echo Reply",
+                                             "Destination Unreachable",
+                                             "Source Quench",
+                                             "Redirect Message",
+                                             "Alternate Host Address",
+                                             "Echo Request",
+                                             "Router Advertisement",
+                                             "Router Selection",
+                                             "Time Exceeded",
+                                             "Parameter Problem",
+                                             "Timestamp Request",
+                                             "Timestamp Reply",
+                                             "Information Request",
+                                             "Information Reply",
+                                             "Address Mask Request",
+                                             "Address Mask Reply" };
+    setNames(icmpNames, "unknown ICMP message type", icmpTypes, icmpMesg, sizeof(icmpTypes));
+
+    // ICMPv6
+    static const quint8 icmp6Types[] = { 1, 2, 3, 4, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 143 };
+    static const char * const icmp6Mesg[] = { "Destination Unreachable",
+                                              "Packet Too Big",
+                                              "Time Exceeded",
+                                              "Parameter Problem",
+                                              "Echo Request",
+                                              "Echo Reply",
+                                              "Multicast Listener Query",
+                                              "Multicast Listener Report",
+                                              "Multicast Listener Done",
+                                              "Router Solicitation",
+                                              "Router Advertisement",
+                                              "Neighbor Solicitation",
+                                              "Neighbor Advertisement",
+                                              "Redirect Message",
+                                              "Multicast Listener Report v2" };
+    setNames(icmp6Names, "unknown ICMPv6 message type", icmp6Types, icmp6Mesg, sizeof(icmp6Types));
+
+    // IGMP
+    static const quint8 igmpTypes[] = { 0x11, 0x12, 0x16, 0x17, 0x22, 0x24, 0x25, 0x26 };
+    static const char * const igmpMesg[] = { "Membership Query",
+                                             "IGMPv1 Membership Report",
+                                             "IGMPv2 Membership Report",
+                                             "Leave Group",
+                                             "IGMPv3 Membership Report",
+                                             "Multicast Router Advertisement",
+                                             "Multicast Router Solicitation",
+                                             "Multicast Router Termination" };
+    setNames(igmpNames, "unknown IGMP message type", igmpTypes, igmpMesg, sizeof(igmpTypes));
+
+    // PPPoE discovery
+    static const quint8 pppoeTypes[] = { 0x09, 0x07, 0x19, 0x65, 0xa7 };
+    static const char * const pppoeMesg[] = { "PPPoE Active Discovery Initiation (PADI)",
+                                              "PPPoE Active Discovery Offer (PADO)",
+                                              "PPPoE Active Discovery Request (PADR)",
+                                              "PPPoE Active Discovery Session-confirmation (PADS)",
+                                              "PPPoE Active Discovery Terminate (PADT)" };
+    setNames(pppoeNames, "", pppoeTypes, pppoeMesg, sizeof(pppoeTypes));
+
+    // network layer
+    memset(etherTypeIndex, 0, sizeof(etherTypeIndex));
+    etherTypes[0].protocol = PROTO_OTHER;
+    etherTypes[0].dissector = 0;
+
+    registerEtherType(0x0806, PROTO_ARP, dissectArp);               // Address Resolution Protocol (ARP)
+    registerEtherType(0x8035, PROTO_RARP, dissectArp);              // Reverse Address Resolution Protocol (RARP)
+    registerEtherType(0x0800, PROTO_IPV4, dissectIPv4);             // Internet Protocol, Version 4 (IPv4)
+    registerEtherType(0x86DD, PROTO_IPV6, dissectIPv6);             // Internet Protocol, Version 6 (IPv6)
+    registerEtherType(0x0842, PROTO_WOL, 0);                        // Wake-on-LAN
+    registerEtherType(0x8137, PROTO_IPX, 0);                        // Internetwork Packet Exchange (IPX)
+    registerEtherType(0x8863, PROTO_PPPOE_DISCOVERY, dissectPppoeDiscovery);
+    registerEtherType(0x8864, PROTO_PPPOE_SESSION, 0);              // PPPoE session not carrying IP
+
+    // transport layer
+    for (int i = 0; i < 256; ++i)
+    {
+        ipProtocols[i].protocol[0] = PROTO_IPV4;
+        ipProtocols[i].protocol[1] = PROTO_IPV6;
+        ipProtocols[i].dissector = 0;
+    }
+
+    registerIpProtocol(1, PROTO_IPV4_ICMP, PROTO_IPV6, dissectIcmp);
+    registerIpProtocol(2, PROTO_IPV4_IGMP, PROTO_IPV6, dissectIgmp);
+    registerIpProtocol(6, PROTO_IPV4_TCP, PROTO_IPV6_TCP, dissectTcp);
+    registerIpProtocol(17, PROTO_IPV4_UDP, PROTO_IPV6_UDP, dissectUdp);
+    registerIpProtocol(58, PROTO_IPV4, PROTO_IPV6_ICMP, dissectIcmp6);
+}
+
+void Dissectors::registerEtherType(quint16 etherType, quint8 protocol, Dissector dissector)
+{
+    if (etherTypesCount == (int)(sizeof(etherTypes) / sizeof(etherTypes[0])))
+        return;
+
+    etherTypes[etherTypesCount].protocol = protocol;
+    etherTypes[etherTypesCount].dissector = dissector;
+    etherTypeIndex[etherType] = etherTypesCount++;
+}
+
+void Dissectors::registerIpProtocol(quint8 proto, quint8 ipv4Protocol, quint8 ipv6Protocol, Dissector dissector)
+{
+    ipProtocols[proto].protocol[0] = ipv4Protocol;
+    ipProtocols[proto].protocol[1] = ipv6Protocol;
+    ipProtocols[proto].dissector = dissector;
+}
+
+const QString &Dissectors::name(quint8 protocol)
+{
+    return names[protocol];
+}
+
+quint8 Dissectors::counter(quint8 protocol)
+{
+    return counters[protocol];
+}
+
+void Dissectors::setNameDiscovery(bool enabled)
+{
+    nameDiscovery = enabled;
+}
+
+//=====================================================================================================================================================================================================
+
+void Dissectors::dissect(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    char mac[18];
+
+    packet.ipVersion = 0;
+    packet.ipProto = 0;
+    packet.sIP = IpAddress();
+    packet.dIP = IpAddress();
+    packet.sPort = 65536;
+    packet.dPort = 65536;
+    packet.tcpFlags = 0;
+    packet.fragment = FRAGMENT_NONE;
+    packet.fragmentId = 0;
+    packet.vlan = 0;
+    packet.innerVlan = 0;
+    packet.encapsulation = 0;
+    packet.malformed = 0;
+    packet.info = QString();
+    packet.names.clear();
+
+// ETH
+    HeaderView<eth_header> ethHeader(data, end, ETHERNET_LENGTH);
+
+    if (!ethHeader.isValid())
+    {
+        packet.type = 0;
+        packet.protocol = PROTO_OTHER;
+        packet.sMac = QString();
+        packet.dMac = QString();
+        setMalformed(packet, MALFORMED_LINK);
+        return;
+    }
+
+    sprintf(mac, "%.2X:%.2X:%.2X:%.2X:%.2X:%.2X", ethHeader->smac[0], ethHeader->smac[1], ethHeader->smac[2], ethHeader->smac[3], ethHeader->smac[4], ethHeader->smac[5]);
+    packet.sMac = mac;
+    sprintf(mac, "%.2X:%.2X:%.2X:%.2X:%.2X:%.2X", ethHeader->dmac[0], ethHeader->dmac[1], ethHeader->dmac[2], ethHeader->dmac[3], ethHeader->dmac[4], ethHeader->dmac[5]);
+    packet.dMac = mac;
+
+// VLAN, MPLS, PPPoE
+    // peel the encapsulation layers until the network layer EtherType, a few layers at most
+    quint16 etherType = ntohs(ethHeader->type);
+    const quint8 *l3Header = data + ETHERNET_LENGTH;
+    bool truncated = false;
+
+    for (int layers = 0; layers < 8 && !truncated; ++layers)
+    {
+        // 0x8100 802.1Q, 0x88A8 802.1ad service tag, 0x9100 pre-standard QinQ
+        if (etherType == 0x8100 || etherType == 0x88A8 || etherType == 0x9100)
+        {
+            HeaderView<vlan_header> vlanHeader(l3Header, end);
+
+            if (!vlanHeader.isValid())
+            {
+                truncated = true;
+                break;
+            }
+
+            if (packet.encapsulation & ENCAP_VLAN)
+            {
+                packet.innerVlan = ntohs(vlanHeader->tci) & 0x0fff;
+                packet.encapsulation |= ENCAP_QINQ;
+            }
+            else
+            {
+                packet.vlan = ntohs(vlanHeader->tci) & 0x0fff;
+                packet.encapsulation |= ENCAP_VLAN;
+            }
+
+            etherType = ntohs(vlanHeader->type);
+            l3Header += VLAN_LENGTH;
+            continue;
+        }
+
+        // 0x8847 MPLS unicast, 0x8848 MPLS multicast
+        if (etherType == 0x8847 || etherType == 0x8848)
+        {
+            packet.encapsulation |= ENCAP_MPLS;
+
+            // skip the label stack up to the bottom of stack entry
+            forever
+            {
+                if (!captured(l3Header, end, MPLS_LENGTH))
+                {
+                    truncated = true;
+                    break;
+                }
+
+                l3Header += MPLS_LENGTH;
+
+                if (l3Header[-2] & 1)
+                    break;
+            }
+
+            // no payload type in MPLS, guess it from the IP version
+            if (!truncated && l3Header < end)
+            {
+                if ((*l3Header >> 4) == 4)
+                    etherType = 0x0800;
+                else if ((*l3Header >> 4) == 6)
+                    etherType = 0x86DD;
+            }
+
+            break;
+        }
+
+        // 0x8864 PPPoE session stage
+        if (etherType == 0x8864)
+        {
+            HeaderView<pppoe_header> pppoeHeader(l3Header, end);
+
+            if (!pppoeHeader.isValid())
+            {
+                truncated = true;
+                break;
+            }
+
+            if (ntohs(pppoeHeader->protocol) == 0x0021)
+                etherType = 0x0800;
+            else if (ntohs(pppoeHeader->protocol) == 0x0057)
+                etherType = 0x86DD;
+            else
+                break;
+
+            l3Header += PPPOE_LENGTH;
+            packet.encapsulation |= ENCAP_PPPOE;
+            break;
+        }
+
+        break;
+    }
+
+    if (truncated)
+    {
+        packet.type = etherType;
+        packet.protocol = etherTypes[etherTypeIndex[etherType]].protocol;
+        setMalformed(packet, MALFORMED_ENCAPSULATION);
+        return;
+    }
+
+    dissectNetwork(packet, etherType, l3Header, end);
+}
+
+void Dissectors::dissectNetwork(Packet &packet, quint16 etherType, const quint8 *data, const quint8 *end)
+{
+    const EtherTypeEntry &entry = etherTypes[etherTypeIndex[etherType]];
+
+    packet.type = etherType;
+    packet.protocol = entry.protocol;
+
+    if (entry.dissector)
+        entry.dissector(packet, data, end);
+    else
+        packet.info = notSupported;
+}
+
+void Dissectors::dissectTransport(Packet &packet, quint8 proto, const quint8 *data, const quint8 *end)
+{
+    const IpProtocolEntry &entry = ipProtocols[proto];
+
+    packet.protocol = entry.protocol[packet.ipVersion == 6];
+
+    if (entry.dissector)
+        entry.dissector(packet, data, end);
+    else
+        packet.info = notSupported;
+}
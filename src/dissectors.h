@@ -0,0 +1,112 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISSECTORS_H
+#define DISSECTORS_H
+
+#include <QString>
+
+struct Packet;
+
+// compact protocol ID of a decoded packet
+enum ProtocolId
+{
+    PROTO_OTHER = 0,        // EtherType without a dissector
+    PROTO_ARP,
+    PROTO_RARP,
+    PROTO_IPV4,             // IPv4, upper layer not decoded
+    PROTO_IPV4_ICMP,
+    PROTO_IPV4_IGMP,
+    PROTO_IPV4_TCP,
+    PROTO_IPV4_UDP,
+    PROTO_IPV6,             // IPv6, upper layer not decoded
+    PROTO_IPV6_ICMP,
+    PROTO_IPV6_TCP,
+    PROTO_IPV6_UDP,
+    PROTO_WOL,
+    PROTO_IPX,
+    PROTO_PPPOE_DISCOVERY,
+    PROTO_PPPOE_SESSION,    // PPPoE session without IP
+    PROTO_COUNT
+};
+
+// per protocol counters kept by ReceiverCore
+enum CounterId
+{
+    COUNTER_ARP = 0,
+    COUNTER_RARP,
+    COUNTER_ICMP,
+    COUNTER_IGMP,
+    COUNTER_TCP,
+    COUNTER_UDP,
+    COUNTER_OTHER,
+    COUNTER_COUNT
+};
+
+// true if length bytes from data were captured
+inline bool captured(const quint8 *data, const quint8 *end, quint32 length)
+{
+    return data <= end && (quint32)(end - data) >= length;
+}
+
+// zero-copy view of a protocol header in the captured data: the length is checked
+// once (the whole header by default), then the fields are read in place, in network byte order
+template <class T>
+class HeaderView
+{
+public:
+    HeaderView(const quint8 *data, const quint8 *end, quint32 length = sizeof(T))
+        : header(captured(data, end, length) ? (const T*)data : 0) {}
+
+    bool isValid() const { return header != 0; }
+    const T *operator->() const { return header; }
+
+private:
+    const T *header;
+};
+
+// decodes one layer, data points to its header, end past the captured bytes
+typedef void (*Dissector)(Packet &packet, const quint8 *data, const quint8 *end);
+
+// table driven packet decoder: the EtherType and the IP protocol number index
+// lookup tables of dissectors, so dispatch costs one load instead of a branch cascade;
+// a new protocol is added by one register call in init()
+class Dissectors
+{
+public:
+    // builds the tables, call once before the first dissect() (not thread safe)
+    static void init();
+
+    // decodes a frame starting at the Ethernet header
+    static void dissect(Packet &packet, const quint8 *data, const quint8 *end);
+
+    // network layer, by EtherType
+    static void dissectNetwork(Packet &packet, quint16 etherType, const quint8 *data, const quint8 *end);
+    // transport layer, by IP protocol number
+    static void dissectTransport(Packet &packet, quint8 proto, const quint8 *data, const quint8 *end);
+
+    static void registerEtherType(quint16 etherType, quint8 protocol, Dissector dissector);
+    static void registerIpProtocol(quint8 proto, quint8 ipv4Protocol, quint8 ipv6Protocol, Dissector dissector);
+
+    static const QString &name(quint8 protocol);
+    static quint8 counter(quint8 protocol);
+
+    // names from DNS, mDNS, DHCP and NetBIOS payloads, set before the capture starts
+    static void setNameDiscovery(bool enabled);
+};
+
+#endif // DISSECTORS_H
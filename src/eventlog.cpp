@@ -0,0 +1,150 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "eventlog.h"
+
+EventLog::EventLog(QObject *parent) : QThread(parent)
+{
+    stopping = false;
+    failed = false;
+
+    maxSize = 0;
+    files = 1;
+}
+
+EventLog::~EventLog()
+{
+    close();
+}
+
+void EventLog::open(const QString &fileName, qint64 maxSize, int files)
+{
+    close();
+
+    this->fileName = fileName;
+    this->maxSize = maxSize;
+    this->files = qMax(1, files);
+
+    queue.clear();
+    stopping = false;
+    failed = false;
+
+    start(QThread::LowPriority);
+}
+
+void EventLog::close()
+{
+    if (!isRunning())
+        return;
+
+    mutex.lock();
+    stopping = true;
+    queued.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+bool EventLog::isWritten()
+{
+    QMutexLocker locker(&mutex);
+
+    return !failed;
+}
+
+void EventLog::append(const QString &line)
+{
+    QMutexLocker locker(&mutex);
+
+    if (failed || !isRunning())
+        return;
+
+    queue.append(line);
+    queued.wakeOne();
+}
+
+void EventLog::run()
+{
+    QFile file(fileName);
+    bool ok = file.open(QIODevice::WriteOnly | QIODevice::Append);
+
+    forever
+    {
+        mutex.lock();
+
+        if (!ok)
+        {
+            failed = true;
+            queue.clear();
+        }
+
+        while (queue.isEmpty() && !stopping)
+            queued.wait(&mutex);
+
+        QStringList lines = queue;
+        queue.clear();
+        bool stop = stopping;
+
+        mutex.unlock();
+
+        QByteArray data;
+        for (int i = 0; i < lines.count(); ++i)
+        {
+            data.append(lines.at(i).toUtf8());
+            data.append("\r\n");
+        }
+
+        if (ok && !data.isEmpty())
+        {
+            ok = file.write(data) == data.size();
+            file.flush();
+
+            if (ok && maxSize > 0 && file.size() >= maxSize)
+                ok = rotate(file);
+        }
+
+        if (stop)
+            break;
+    }
+
+    if (!ok)
+    {
+        mutex.lock();
+        failed = true;
+        mutex.unlock();
+    }
+
+    file.close();
+}
+
+bool EventLog::rotate(QFile &file)
+{
+    file.close();
+
+    // a single file starts again empty
+    if (files > 1)
+    {
+        QFile::remove(fileName + "." + QString::number(files - 1));
+
+        for (int i = files - 2; i > 0; --i)
+            QFile::rename(fileName + "." + QString::number(i), fileName + "." + QString::number(i + 1));
+
+        QFile::rename(fileName, fileName + ".1");
+    }
+
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
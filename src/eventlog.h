@@ -0,0 +1,65 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QFile>
+
+// log file of the events, appended in its own thread; past maxSize bytes it is renamed
+// to fileName.1, the older ones move up to fileName.(files - 1) and the oldest is removed
+class EventLog : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(EventLog)
+
+public:
+    explicit EventLog(QObject *parent = 0);
+    ~EventLog();
+
+    void open(const QString &fileName, qint64 maxSize, int files);
+    // waits for the queued lines
+    void close();
+
+    // false once a line could not be written
+    bool isWritten();
+
+public slots:
+    void append(const QString &line);
+
+protected:
+    void run();
+
+private:
+    QMutex mutex;
+    QWaitCondition queued;
+    QStringList queue;
+    bool stopping;
+    bool failed;
+
+    QString fileName;
+    qint64 maxSize;
+    int files;
+
+    bool rotate(QFile &file);
+};
+
+#endif // EVENTLOG_H
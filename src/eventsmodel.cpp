@@ -0,0 +1,234 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "eventsmodel.h"
+
+// seconds an equal event is merged into the row
+static const int MERGE_WINDOW = 60;
+
+// the event with its merged occurrences
+static QString eventText(const Event &event)
+{
+    if (event.count > 1)
+        return EventsModel::tr("%1 (%2 times)").arg(event.event).arg(event.count);
+
+    return event.event;
+}
+
+EventsModel::EventsModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    first = 0;
+    size = 0;
+    nextId = 1;
+    ring.resize(10000);
+
+    maxRate = 0;
+    rateSecond = 0;
+    rateCount = 0;
+    suppressed = 0;
+
+    suppressedTimer = new QTimer(this);
+    suppressedTimer->setSingleShot(true);
+    connect(suppressedTimer, SIGNAL(timeout()), this, SLOT(storeSuppressed()));
+
+    icons[EVENT_INFORMATION] = QIcon(":/images/16_information.png");
+    icons[EVENT_WARNING] = QIcon(":/images/16_warning.png");
+    icons[EVENT_CRITICAL] = QIcon(":/images/16_critical.png");
+}
+
+int EventsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return size;
+}
+
+int EventsModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return 6;
+}
+
+QVariant EventsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    const Event &event = at(index.row());
+
+    // for the type filter
+    if (role == Qt::UserRole && index.column() == 1)
+        return (int)event.type;
+
+    if (role == Qt::DecorationRole && index.column() == 1)
+        return icons[event.type];
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (index.column())
+    {
+        case 0: return event.id;
+        case 1: return typeName(event.type);
+        case 2: return event.time.toString("yyyy-MM-dd");
+        case 3: return event.time.toString("hh:mm:ss");
+        case 4: return eventText(event);
+        case 5: return event.details;
+        default: return QVariant();
+    }
+}
+
+QVariant EventsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section)
+    {
+        case 0: return tr("No.");
+        case 1: return tr("Type");
+        case 2: return tr("Date");
+        case 3: return tr("Time");
+        case 4: return tr("Event");
+        case 5: return tr("Details");
+        default: return QVariant();
+    }
+}
+
+void EventsModel::setLimits(int maxEvents, int maxRate)
+{
+    ring.clear();
+    ring.resize(qMax(1, maxEvents));
+    first = 0;
+    size = 0;
+    recent.clear();
+
+    this->maxRate = maxRate;
+
+    reset();
+}
+
+bool EventsModel::addEvent(quint8 type, const QString &event, const QString &details)
+{
+    QDateTime now = QDateTime::currentDateTime();
+
+    // a repeated event only counts
+    QHash<QString, quint32>::const_iterator it = recent.constFind(key(type, event, details));
+    if (it != recent.constEnd())
+    {
+        int row = it.value() - at(0).id;
+        Event &e = ring[(first + row) % ring.size()];
+
+        if (e.time.secsTo(now) < MERGE_WINDOW)
+        {
+            ++e.count;
+            e.time = now;
+
+            emit dataChanged(index(row, 2), index(row, 4));
+            return false;
+        }
+    }
+
+    uint second = now.toTime_t();
+    if (second != rateSecond)
+    {
+        rateSecond = second;
+        rateCount = 0;
+    }
+
+    if (maxRate > 0 && rateCount >= maxRate)
+    {
+        if (suppressed++ == 0)
+            suppressedTimer->start(1000);
+
+        return false;
+    }
+
+    ++rateCount;
+    store(type, event, details, now);
+
+    return true;
+}
+
+void EventsModel::store(quint8 type, const QString &event, const QString &details, const QDateTime &time)
+{
+    // the oldest row leaves the ring, and the merging if it is still the latest of its kind
+    if (size == ring.size())
+    {
+        const Event &oldest = ring.at(first);
+
+        QHash<QString, quint32>::iterator it = recent.find(key(oldest.type, oldest.event, oldest.details));
+        if (it != recent.end() && it.value() == oldest.id)
+            recent.erase(it);
+
+        beginRemoveRows(QModelIndex(), 0, 0);
+        first = (first + 1) % ring.size();
+        --size;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), size, size);
+
+    Event &e = ring[(first + size) % ring.size()];
+    e.id = nextId++;
+    e.type = type;
+    e.time = time;
+    e.event = event;
+    e.details = details;
+    e.count = 1;
+    ++size;
+
+    endInsertRows();
+
+    recent.insert(key(type, event, details), e.id);
+
+    emit eventStored(toLine(e));
+}
+
+void EventsModel::storeSuppressed()
+{
+    if (suppressed == 0)
+        return;
+
+    store(EVENT_WARNING, tr("Events suppressed"), tr("%1 events over %2 a second were not stored").arg(suppressed).arg(maxRate), QDateTime::currentDateTime());
+    suppressed = 0;
+}
+
+QString EventsModel::toLine(const Event &event)
+{
+    return QString::number(event.id) + " " + typeName(event.type) + " " + event.time.toString("yyyy-MM-dd") + " " + event.time.toString("hh:mm:ss") + " " + eventText(event) + " " + event.details;
+}
+
+QString EventsModel::typeName(quint8 type)
+{
+    switch (type)
+    {
+        case EVENT_INFORMATION: return tr("Information");
+        case EVENT_WARNING: return tr("Warning");
+        case EVENT_CRITICAL: return tr("Critical");
+        default: return QString();
+    }
+}
+
+QString EventsModel::key(quint8 type, const QString &event, const QString &details)
+{
+    return QString::number(type) + QChar(0) + event + QChar(0) + details;
+}
@@ -0,0 +1,95 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EVENTSMODEL_H
+#define EVENTSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QDateTime>
+#include <QIcon>
+#include <QTimer>
+
+enum { EVENT_INFORMATION, EVENT_WARNING, EVENT_CRITICAL };
+
+struct Event
+{
+    quint32 id;
+    quint8 type;
+    QDateTime time;         // of the last occurrence
+    QString event;
+    QString details;
+    quint32 count;          // occurrences merged into the row
+};
+
+// events for EventsViewerMainWindow in a ring of maxEvents rows, oldest first; an event
+// equal to one stored less than a minute ago only counts in that row, and at most
+// maxRate new rows are stored a second, the others are summed up in one row
+class EventsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(EventsModel)
+
+public:
+    explicit EventsModel(QObject *parent = 0);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    void setLimits(int maxEvents, int maxRate);
+
+    // true if a new row was stored
+    bool addEvent(quint8 type, const QString &event, const QString &details);
+
+    int count() const { return size; }
+    const Event &at(int row) const { return ring.at((first + row) % ring.size()); }
+
+    // a row as in the log file
+    static QString toLine(const Event &event);
+    static QString typeName(quint8 type);
+
+private:
+    QVector<Event> ring;
+    int first, size;
+    quint32 nextId;
+
+    // rows by type, event and details, for merging
+    QHash<QString, quint32> recent;
+
+    int maxRate;
+    uint rateSecond;
+    int rateCount;
+    quint32 suppressed;
+    QTimer *suppressedTimer;
+
+    QIcon icons[3];
+
+    void store(quint8 type, const QString &event, const QString &details, const QDateTime &time);
+
+    static QString key(quint8 type, const QString &event, const QString &details);
+
+private slots:
+    void storeSuppressed();
+
+signals:
+    void eventStored(const QString &line);
+};
+
+#endif // EVENTSMODEL_H
@@ -17,48 +17,33 @@
 
 #include "eventsviewermainwindow.h"
 
-class MyTreeWidgetItem : public QTreeWidgetItem
-{
-public:
-    MyTreeWidgetItem(QTreeWidget *parent) : QTreeWidgetItem(parent)
-    {
-    }
-
-    MyTreeWidgetItem(QTreeWidget *parent, const QStringList &strings) : QTreeWidgetItem (parent, strings)
-    {
-    }
-
-private:
-    bool operator< (const QTreeWidgetItem &other) const
-    {
-        int sortCol = treeWidget()->sortColumn();
-        if (sortCol == 0)
-        {
-            int myNumber = text(sortCol).toInt();
-            int otherNumber = other.text(sortCol).toInt();
-            return myNumber < otherNumber;
-        }
-        else
-        {
-            return text(sortCol) < other.text(sortCol);
-        }
-    }
-};
-
 EventsViewerMainWindow::EventsViewerMainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
     ui.setupUi(this);
 
-    ui.treeWidget->resizeColumnToContents(0);
+    model = new EventsModel(this);
+    model->setLimits(Settings::eventsViewerMainWindow.maxEvents, Settings::eventsViewerMainWindow.maxRate);
 
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortByColumn(0, Qt::AscendingOrder);
+    // new rows are put in place, the rows are not sorted again for each event
+    proxy = new QSortFilterProxyModel(this);
+    proxy->setSourceModel(model);
+    proxy->setDynamicSortFilter(true);
+    proxy->setFilterKeyColumn(1);
+    proxy->setFilterRole(Qt::UserRole);
+    ui.treeView->setModel(proxy);
 
-    ui.treeWidget->clear();
-    ui.treeWidget->sortItems(0, Qt::AscendingOrder);
+    ui.treeView->resizeColumnToContents(0);
 
-    eventsList.clear();
+    ui.treeView->setSortingEnabled(true);
+    ui.treeView->sortByColumn(0, Qt::AscendingOrder);
+
+    log = new EventLog(this);
+    if (Settings::eventsViewerMainWindow.createFile)
+    {
+        log->open(Settings::eventsViewerMainWindow.folder + "/lananalyzer.log", (qint64)Settings::eventsViewerMainWindow.logSize * 1024, Settings::eventsViewerMainWindow.logFiles);
+        connect(model, SIGNAL(eventStored(QString)), log, SLOT(append(QString)));
+    }
 
     infoCounter = 0;
     warningCounter = 0;
@@ -70,7 +55,7 @@ EventsViewerMainWindow::EventsViewerMainWindow(QWidget *parent)
 
     restoreWindowState();
 
-    connect(ui.treeWidget, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(onShowContextMenu(QPoint)));
+    connect(ui.treeView, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(onShowContextMenu(QPoint)));
 
     if (Settings::mainWindow.firstRun)
     {
@@ -81,8 +66,10 @@ EventsViewerMainWindow::EventsViewerMainWindow(QWidget *parent)
 
 EventsViewerMainWindow::~EventsViewerMainWindow()
 {
+    log->close();
+
     if (Settings::eventsViewerMainWindow.createFile)
-        if (!saveFile(Settings::eventsViewerMainWindow.folder + "/lananalyzer.log"))
+        if (!log->isWritten())
         {
             QMessageBox::critical(0, tr("Critical"), tr("Unable to write log file."));
         }
@@ -320,96 +307,36 @@ void EventsViewerMainWindow::restoreWindowState()
 
 void EventsViewerMainWindow::onShowContextMenu(const QPoint &pos)
 {
-    QTreeWidgetItem *item = ui.treeWidget->itemAt(pos);
-    if (!item)
+    QModelIndex index = ui.treeView->indexAt(pos);
+    if (!index.isValid())
         return;
 
     QMenu menu(tr("Context menu"), this);
     menu.addAction(tr("Copy"));
 
-    QAction *action = menu.exec(ui.treeWidget->viewport()->mapToGlobal(pos));
+    QAction *action = menu.exec(ui.treeView->viewport()->mapToGlobal(pos));
 
     if (action == 0)
         return;
 
     QClipboard *clipboard = QApplication::clipboard();
 
-    clipboard->setText(item->text(0) + " " + item->text(1) + " " + item->text(2) + " " + item->text(3) + " " + item->text(4) + " " + item->text(5));
+    clipboard->setText(EventsModel::toLine(model->at(proxy->mapToSource(index).row())));
 }
 
-void EventsViewerMainWindow::addEvent(quint8 type, const QString &event, const QString &details)
+bool EventsViewerMainWindow::addEvent(quint8 type, const QString &event, const QString &details)
 {
-    int sortColumn = ui.treeWidget->sortColumn();
-    Qt::SortOrder sortOrder = ui.treeWidget->header()->sortIndicatorOrder();
-    ui.treeWidget->setSortingEnabled(false);
-
-    Event e;
-    int x = eventsList.count()+1;
-
     switch (type)
     {
-        // information
-        case EVENT_INFORMATION:
-                e.id = x;
-                e.type = tr("Information");
-                e.date = QDate::currentDate().toString("yyyy-MM-dd");
-                e.time = QTime::currentTime().toString("hh:mm:ss");
-                e.event = event;
-                e.details = details;
-
-                eventsList.append(e);
-
-                ui.treeWidget->addTopLevelItem(new MyTreeWidgetItem(ui.treeWidget, QStringList() << QString::number(x) << e.type << e.date << e.time << e.event << e.details));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setIcon(1, QIcon(":/images/16_information.png"));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setHidden(!ui.actionInfomation->isChecked());
-
-                infoLabel->setText(QString("Information events: %1").arg(++infoCounter));
-                eventsLabel->setText(QString("Events: %1").arg(infoCounter + warningCounter + criticalCounter));
-                break;
-
-        // warning
-        case EVENT_WARNING:
-                e.id = x;
-                e.type = tr("Warning");
-                e.date = QDate::currentDate().toString("yyyy-MM-dd");
-                e.time = QTime::currentTime().toString("hh:mm:ss");
-                e.event = event;
-                e.details = details;
-
-                eventsList.append(e);
-
-                ui.treeWidget->addTopLevelItem(new MyTreeWidgetItem(ui.treeWidget, QStringList() << QString::number(x) << e.type << e.date << e.time << e.event << e.details));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setIcon(1, QIcon(":/images/16_warning.png"));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setHidden(!ui.actionWarning->isChecked());
-
-                warningLabel->setText(QString("Warning events: %1").arg(++warningCounter));
-                eventsLabel->setText(QString("Events: %1").arg(infoCounter + warningCounter + criticalCounter));
-                break;
-
-        // critical
-        case EVENT_CRITICAL:
-                e.id = x;
-                e.type = tr("Critical");
-                e.date = QDate::currentDate().toString("yyyy-MM-dd");
-                e.time = QTime::currentTime().toString("hh:mm:ss");
-                e.event = event;
-                e.details = details;
-
-                eventsList.append(e);
-
-                ui.treeWidget->addTopLevelItem(new MyTreeWidgetItem(ui.treeWidget, QStringList() << QString::number(x) << e.type << e.date << e.time << e.event << e.details));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setIcon(1, QIcon(":/images/16_critical.png"));
-                ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount()-1)->setHidden(!ui.actionCritical->isChecked());
-
-                criticalLabel->setText(QString("Critical events: %1").arg(++criticalCounter));
-                eventsLabel->setText(QString("Events: %1").arg(infoCounter + warningCounter + criticalCounter));
-                break;
-
-        default: break;
+        case EVENT_INFORMATION: infoLabel->setText(tr("Information events: %1").arg(++infoCounter)); break;
+        case EVENT_WARNING: warningLabel->setText(tr("Warning events: %1").arg(++warningCounter)); break;
+        case EVENT_CRITICAL: criticalLabel->setText(tr("Critical events: %1").arg(++criticalCounter)); break;
+        default: return false;
     }
 
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortItems(sortColumn, sortOrder);
+    eventsLabel->setText(tr("Events: %1").arg(infoCounter + warningCounter + criticalCounter));
+
+    return model->addEvent(type, event, details);
 }
 
 void EventsViewerMainWindow::writeSettings()
@@ -457,15 +384,8 @@ bool EventsViewerMainWindow::saveFile(const QString &fileName)
     QTextStream out(&file);
     out.setCodec("UTF-8");
 
-    for (int i = 0; i < eventsList.count(); ++i)
-    {
-        out << QString::number(eventsList.at(i).id) << " ";
-        out << eventsList.at(i).type << " ";
-        out << eventsList.at(i).date << " ";
-        out << eventsList.at(i).time << " ";
-        out << eventsList.at(i).event << " ";
-        out << eventsList.at(i).details << "\r\n";
-    }
+    for (int i = 0; i < model->count(); ++i)
+        out << EventsModel::toLine(model->at(i)) << "\r\n";
 
     file.close();
 
@@ -509,24 +429,19 @@ void EventsViewerMainWindow::onCriticalTriggered(bool checked)
 
 void EventsViewerMainWindow::updateEventsWidget()
 {
-    int sortColumn = ui.treeWidget->sortColumn();
-    Qt::SortOrder sortOrder = ui.treeWidget->header()->sortIndicatorOrder();
-    ui.treeWidget->setSortingEnabled(false);
+    QStringList types;
 
-    for (int i = 0; i < ui.treeWidget->topLevelItemCount(); ++i)
-    {
-        if (ui.treeWidget->topLevelItem(i)->text(1).contains("Information", Qt::CaseSensitive))
-            ui.treeWidget->topLevelItem(i)->setHidden(!ui.actionInfomation->isChecked());
+    if (ui.actionInfomation->isChecked())
+        types << QString::number(EVENT_INFORMATION);
 
-        if (ui.treeWidget->topLevelItem(i)->text(1).contains("Warning", Qt::CaseSensitive))
-            ui.treeWidget->topLevelItem(i)->setHidden(!ui.actionWarning->isChecked());
+    if (ui.actionWarning->isChecked())
+        types << QString::number(EVENT_WARNING);
 
-        if (ui.treeWidget->topLevelItem(i)->text(1).contains("Critical", Qt::CaseSensitive))
-            ui.treeWidget->topLevelItem(i)->setHidden(!ui.actionCritical->isChecked());
-    }
+    if (ui.actionCritical->isChecked())
+        types << QString::number(EVENT_CRITICAL);
 
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortItems(sortColumn, sortOrder);
+    // the type column filtered by its number
+    proxy->setFilterRegExp(QRegExp("^(" + types.join("|") + ")$"));
 }
 
 void EventsViewerMainWindow::toggleAlwaysOnTop(bool checked)
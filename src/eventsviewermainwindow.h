@@ -31,21 +31,12 @@
 #include <QMessageBox>
 #include <QUrl>
 #include <QClipboard>
+#include <QSortFilterProxyModel>
 
 #include "aboutdialog.h"
 #include "settings.h"
-
-enum { EVENT_INFORMATION, EVENT_WARNING, EVENT_CRITICAL };
-
-struct Event
-{
-    quint32 id;
-    QString type;
-    QString date;
-    QString time;
-    QString event;
-    QString details;
-};
+#include "eventsmodel.h"
+#include "eventlog.h"
 
 class EventsViewerMainWindow : public QMainWindow
 {
@@ -60,7 +51,8 @@ public:
     //const quint8 EVENT_WARNING = 1;
     //const quint8 EVENT_CRITICAL = 2;
 
-    void addEvent(quint8 type, const QString &event, const QString &details);
+    // true if the event got a new row, false if it was merged or over the rate
+    bool addEvent(quint8 type, const QString &event, const QString &details);
     void writeSettings();
 
 protected:
@@ -73,7 +65,10 @@ private:
     QSize oldSize;
     QPoint oldPosition;
 
-    QList<Event> eventsList;
+    // rows sorted and filtered by type in the proxy
+    EventsModel *model;
+    QSortFilterProxyModel *proxy;
+    EventLog *log;
     quint32 infoCounter, warningCounter, criticalCounter;
 
     // menu
@@ -0,0 +1,175 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "filtercache.h"
+
+#include <QTime>
+
+QHash<QString, bpf_program*> FilterCache::programs;
+QList<QString> FilterCache::order;
+
+bpf_program *FilterCache::program(const QString &code, int linkType, int snaplen, quint32 netmask, QString *error)
+{
+    // the generated code depends on the link type, snaplen (accept return) and netmask (ip broadcast)
+    QString key = QString("%1/%2/%3/").arg(linkType).arg(snaplen).arg(netmask) + code;
+
+    QHash<QString, bpf_program*>::const_iterator it = programs.constFind(key);
+    if (it != programs.constEnd())
+        return it.value();
+
+    bpf_program *fcode = compile(code, linkType, snaplen, netmask, error);
+    if (!fcode)
+        return 0;
+
+    if (order.count() >= CAPACITY)
+        release(programs.take(order.takeFirst()));
+
+    programs.insert(key, fcode);
+    order.append(key);
+
+    return fcode;
+}
+
+void FilterCache::clear()
+{
+    foreach (bpf_program *fcode, programs)
+        release(fcode);
+
+    programs.clear();
+    order.clear();
+}
+
+bpf_program *FilterCache::compile(const QString &code, int linkType, int snaplen, quint32 netmask, QString *error)
+{
+    pcap_t *p = pcap_open_dead(linkType, snaplen);
+    if (p == NULL)
+    {
+        if (error)
+            *error = QObject::tr("Unable to open a pcap handle for compiling.");
+        return 0;
+    }
+
+    bpf_program *fcode = new bpf_program;
+
+    if (pcap_compile(p, fcode, code.toLocal8Bit().data(), 1, netmask) < 0)
+    {
+        if (error)
+            *error = QString::fromLocal8Bit(pcap_geterr(p));
+
+        delete fcode;
+        pcap_close(p);
+        return 0;
+    }
+
+    pcap_close(p);
+
+    return fcode;
+}
+
+void FilterCache::release(bpf_program *fcode)
+{
+    pcap_freecode(fcode);
+    delete fcode;
+}
+
+quint32 FilterCache::netmask(pcap_if_t *d)
+{
+    if (d->addresses != NULL && d->addresses->netmask != NULL)
+        return ((struct sockaddr_in *)(d->addresses->netmask))->sin_addr.s_addr;
+
+    return 0xffffff;
+}
+
+//=====================================================================================================================================================================================================
+
+FilterSample::FilterSample()
+{
+    link = DLT_EN10MB;
+}
+
+bool FilterSample::load(const QString &fileName, int limit, QString *error)
+{
+    clear();
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t *p = pcap_open_offline(fileName.toLocal8Bit().data(), errbuf);
+
+    if (p == NULL)
+    {
+        if (error)
+            *error = QString::fromLocal8Bit(errbuf);
+        return false;
+    }
+
+    link = pcap_datalink(p);
+
+    struct pcap_pkthdr *header;
+    const u_char *pkt_data;
+
+    while (headers.count() < limit && pcap_next_ex(p, &header, &pkt_data) == 1)
+    {
+        headers.append(*header);
+        offsets.append(data.size());
+        data.append((const char *)pkt_data, header->caplen);
+    }
+
+    pcap_close(p);
+
+    if (headers.isEmpty())
+    {
+        if (error)
+            *error = QObject::tr("No packets in the file.");
+        return false;
+    }
+
+    return true;
+}
+
+void FilterSample::clear()
+{
+    headers.clear();
+    offsets.clear();
+    data.clear();
+}
+
+qreal FilterSample::nsPerPacket(bpf_program *program, int milliseconds, int *matched) const
+{
+    const u_char *bytes = (const u_char *)data.constData();
+    int n = headers.count(), hits = 0, elapsed;
+    quint64 runs = 0;
+
+    QTime time;
+    time.start();
+
+    // whole passes until the time is long enough for the millisecond clock
+    do
+    {
+        hits = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            if (pcap_offline_filter(program, &headers.at(i), bytes + offsets.at(i)))
+                ++hits;
+        }
+        runs += n;
+    }
+    while ((elapsed = time.elapsed()) < milliseconds);
+
+    if (matched)
+        *matched = hits;
+
+    return elapsed * 1000000.0 / runs;
+}
@@ -0,0 +1,78 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FILTERCACHE_H
+#define FILTERCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+#include "WpdPack/Include/pcap.h"
+
+// compiled BPF programs by expression and compile parameters, shared by FiltersDialog
+// and CaptureThread::startCapture; the cache owns the programs (pcap_freecode on
+// eviction), pcap_setfilter copies them, used from the GUI thread only
+class FilterCache
+{
+public:
+    // 0 if the expression does not compile, the pcap error in *error
+    static bpf_program *program(const QString &code, int linkType, int snaplen, quint32 netmask, QString *error = 0);
+    static void clear();
+
+    // a program outside the cache, for a throwaway use such as the benchmark; the
+    // caller frees it with release()
+    static bpf_program *compile(const QString &code, int linkType, int snaplen, quint32 netmask, QString *error = 0);
+    static void release(bpf_program *fcode);
+
+    // netmask of the first address of the device, a C class network if none
+    static quint32 netmask(pcap_if_t *d);
+
+private:
+    // programs kept, the oldest one is freed first
+    enum { CAPACITY = 64 };
+
+    static QHash<QString, bpf_program*> programs;
+    static QList<QString> order;
+};
+
+// packets of a capture file held in memory, to measure filters with pcap_offline_filter
+class FilterSample
+{
+public:
+    FilterSample();
+
+    bool load(const QString &fileName, int limit, QString *error = 0);
+    void clear();
+
+    int count() const { return headers.count(); }
+    int linkType() const { return link; }
+
+    // average time over at least the given milliseconds, matching packets in *matched
+    qreal nsPerPacket(bpf_program *program, int milliseconds, int *matched = 0) const;
+
+private:
+    QVector<pcap_pkthdr> headers;
+    QVector<int> offsets;
+    QByteArray data;
+    int link;
+};
+
+#endif // FILTERCACHE_H
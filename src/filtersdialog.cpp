@@ -29,6 +29,17 @@ FiltersDialog::FiltersDialog(QWidget *parent, const QString &filterName)
     topOpenIcon = new QIcon(":/images/o_folder_open.png");
 
     fileName = QCoreApplication::applicationDirPath() + "/filters.txt";
+
+    // Ethernet, the capture defaults
+    snaplen = 65535;
+    netmask = 0xffffff;
+}
+
+void FiltersDialog::setCompileOptions(int snaplen, quint32 netmask)
+{
+    // the same as CaptureThread::startCapture, so the compiled programs are reused there
+    this->snaplen = snaplen;
+    this->netmask = netmask;
 }
 
 void FiltersDialog::keyPressEvent(QKeyEvent *event)
@@ -91,6 +102,7 @@ void FiltersDialog::createConnections()
 
     connect(ui.pushButtonShortHelp, SIGNAL(clicked()), this, SLOT(onShowShortHelp()));
     connect(ui.pushButtonExamples, SIGNAL(clicked()), this, SLOT(onLoadExamples()));
+    connect(ui.pushButtonBenchmark, SIGNAL(clicked()), this, SLOT(onBenchmark()));
     connect(ui.pushButtonOK, SIGNAL(clicked()), this, SLOT(onOK()));
     connect(ui.pushButtonCancel, SIGNAL(clicked()), this, SLOT(close()));
 
@@ -190,6 +202,10 @@ void FiltersDialog::readFilters()
         otherFilters.append(filter);
     }
     filtersFile.endArray();
+
+    filtersFile.beginGroup("Benchmark");
+    sampleFile = filtersFile.value("sampleFile").toString();
+    filtersFile.endGroup();
 }
 
 void FiltersDialog::writeFilters()
@@ -250,6 +266,10 @@ void FiltersDialog::writeFilters()
         filtersFile.setValue("filterCode", otherFilters.at(i).filterCode);
     }
     filtersFile.endArray();
+
+    filtersFile.beginGroup("Benchmark");
+    filtersFile.setValue("sampleFile", sampleFile);
+    filtersFile.endGroup();
 }
 
 void FiltersDialog::showFilters()
@@ -297,6 +317,45 @@ void FiltersDialog::showFilters()
         ui.treeWidgetFilters->topLevelItem(4)->addChild(new QTreeWidgetItem((QTreeWidget*)0, QStringList() << otherFilters.at(i).filterName));
         ui.treeWidgetFilters->topLevelItem(4)->child(i)->setIcon(0, *itemIcon);
     }
+
+    showCosts();
+}
+
+// BPF instructions of every filter and the time per packet measured by the last benchmark
+void FiltersDialog::showCosts()
+{
+    QList<Filter> *filters[5] = { &linkFilters, &networkFilters, &transportFilters, &applicationFilters, &otherFilters };
+    QString error;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        QTreeWidgetItem *top = ui.treeWidgetFilters->topLevelItem(i);
+
+        for (int j = 0; j < filters[i]->size() && j < top->childCount(); ++j)
+        {
+            const QString &code = filters[i]->at(j).filterCode;
+            QTreeWidgetItem *item = top->child(j);
+
+            bpf_program *program = FilterCache::program(code, DLT_EN10MB, snaplen, netmask, &error);
+
+            if (program)
+            {
+                item->setText(1, QString::number(program->bf_len));
+                item->setToolTip(1, "");
+            }
+            else
+            {
+                item->setText(1, tr("error"));
+                item->setToolTip(1, error);
+            }
+
+            QHash<QString, qreal>::const_iterator it = benchmarks.constFind(code);
+            item->setText(2, it != benchmarks.constEnd() ? QString::number(it.value(), 'f', 1) : "");
+
+            item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+            item->setTextAlignment(2, Qt::AlignRight | Qt::AlignVCenter);
+        }
+    }
 }
 
 void FiltersDialog::setFilter()
@@ -606,6 +665,7 @@ void FiltersDialog::onUpdate()
 
         end:
         //writeFilters();
+        showCosts();
         return;
     }
 }
@@ -819,6 +879,7 @@ void FiltersDialog::onDelete()
 
         end:
         //writeFilters();
+        showCosts();
         return;
     }
 }
@@ -934,6 +995,66 @@ void FiltersDialog::onOK()
     close();
 }
 
+void FiltersDialog::onBenchmark()
+{
+    QString file = QFileDialog::getOpenFileName(this, tr("Sample capture file"), sampleFile, tr("Capture files (*.pcap *.cap);;All files (*.*)"));
+
+    if (file.isEmpty())
+        return;
+
+    sampleFile = file;
+
+    QString error;
+    FilterSample sample;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    if (!sample.load(sampleFile, 100000, &error))
+    {
+        QApplication::restoreOverrideCursor();
+
+        // 2 - warning
+        emit infoMessage(2, tr("Filter benchmark"), tr("Unable to read the sample capture file: \"%1\"").arg(error));
+        return;
+    }
+
+    QList<Filter> *filters[5] = { &linkFilters, &networkFilters, &transportFilters, &applicationFilters, &otherFilters };
+    int matched;
+
+    benchmarks.clear();
+
+    // compiled for the link type of the file and freed at once, the capture cache is
+    // left to the capture; the dialog is repainted between the filters
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < filters[i]->size(); ++j)
+        {
+            const QString &code = filters[i]->at(j).filterCode;
+
+            if (benchmarks.contains(code))
+                continue;
+
+            bpf_program *program = FilterCache::compile(code, sample.linkType(), snaplen, netmask);
+
+            if (program)
+            {
+                benchmarks.insert(code, sample.nsPerPacket(program, 50, &matched));
+                FilterCache::release(program);
+
+                QTreeWidgetItem *item = ui.treeWidgetFilters->topLevelItem(i)->child(j);
+                if (item)
+                    item->setToolTip(2, tr("%1 of %2 packets matched").arg(matched).arg(sample.count()));
+            }
+
+            QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        }
+    }
+
+    QApplication::restoreOverrideCursor();
+
+    showCosts();
+}
+
 void FiltersDialog::onShowShortHelp()
 {
     QToolTip::showText(mapToGlobal(ui.pushButtonShortHelp->pos()), ui.pushButtonShortHelp->toolTip());
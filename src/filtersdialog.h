@@ -24,8 +24,11 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QToolTip>
+#include <QFileDialog>
+#include <QHash>
 
 #include "editordialog.h"
+#include "filtercache.h"
 
 class FiltersDialog : public QDialog
 {
@@ -35,6 +38,7 @@ class FiltersDialog : public QDialog
 public:
     explicit FiltersDialog(QWidget *parent = 0, const QString &filterName = "");
 
+    void setCompileOptions(int snaplen, quint32 netmask);
     void prepareDialog();
     QString getFilterCode();
     QString getFilterName();
@@ -48,6 +52,12 @@ private:
     QString filterCode, filterName;
     QString fileName;
 
+    // BPF compile parameters and the benchmark, ns per packet by filter code
+    int snaplen;
+    quint32 netmask;
+    QString sampleFile;
+    QHash<QString, qreal> benchmarks;
+
     QIcon *topIcon;
     QIcon *topOpenIcon;
     QIcon *itemIcon;
@@ -63,6 +73,7 @@ private:
     void createConnections();
 
     void showFilters();
+    void showCosts();
     void setFilter();
     void readFilters();
     void writeFilters();
@@ -71,6 +82,7 @@ private:
 private slots:
     void onShowShortHelp();
     void onLoadExamples();
+    void onBenchmark();
     void onOK();
     void onUpdate();
     void onAddNew();
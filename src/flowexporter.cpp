@@ -0,0 +1,336 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "flowexporter.h"
+
+#include <string.h>
+
+// keeps export packets below the Ethernet MTU
+static const int MAX_MESSAGE_SIZE = 1400;
+
+static const quint16 TEMPLATE_IPV4 = 256;
+static const quint16 TEMPLATE_IPV6 = 257;
+
+// { information element / field type, length }, the same numbers in IPFIX and NetFlow v9
+static const quint16 ipv4Fields[2][2] = { {8, 4},        // sourceIPv4Address
+                                          {12, 4}        // destinationIPv4Address
+                                        };
+
+static const quint16 ipv6Fields[2][2] = { {27, 16},      // sourceIPv6Address
+                                          {28, 16}       // destinationIPv6Address
+                                        };
+
+// fields following the addresses
+static const quint16 ipfixFields[9][2] = { {7, 2},       // sourceTransportPort
+                                            {11, 2},     // destinationTransportPort
+                                            {4, 1},      // protocolIdentifier
+                                            {6, 1},      // tcpControlBits
+                                            {2, 8},      // packetDeltaCount
+                                            {1, 8},      // octetDeltaCount
+                                            {152, 8},    // flowStartMilliseconds
+                                            {153, 8},    // flowEndMilliseconds
+                                            {136, 1}     // flowEndReason
+                                          };
+
+static const quint16 netflowFields[8][2] = { {7, 2},     // L4_SRC_PORT
+                                              {11, 2},   // L4_DST_PORT
+                                              {4, 1},    // PROTOCOL
+                                              {6, 1},    // TCP_FLAGS
+                                              {2, 8},    // IN_PKTS
+                                              {1, 8},    // IN_BYTES
+                                              {22, 4},   // FIRST_SWITCHED
+                                              {21, 4}    // LAST_SWITCHED
+                                            };
+
+FlowExporter::FlowExporter(QObject *parent)
+    : QObject(parent)
+{
+    socket = new QUdpSocket(this);
+
+    buffer.fill(0, MAX_MESSAGE_SIZE);
+    data = (uchar *)buffer.data();
+
+    setCollector(IPFIX, "127.0.0.1", 4739, 0, 60);
+    start(0);
+}
+
+FlowExporter::~FlowExporter()
+{
+}
+
+bool FlowExporter::setCollector(quint8 version, const QString &address, quint16 port, quint32 domain, quint32 templateRefresh)
+{
+    this->version = (version == NETFLOW_V9) ? NETFLOW_V9 : IPFIX;
+    this->port = port;
+    this->domain = domain;
+    this->templateRefresh = (quint64)templateRefresh * 1000;
+
+    if (this->version == IPFIX)
+    {
+        fields = ipfixFields;
+        fieldCount = 9;
+    }
+    else
+    {
+        fields = netflowFields;
+        fieldCount = 8;
+    }
+
+    fieldsLength = 0;
+    for (int i = 0; i < fieldCount; ++i)
+        fieldsLength += fields[i][1];
+
+    if (!collector.setAddress(address))
+    {
+        // 2 - warning
+        emit infoMessage(2, tr("Flow exporter"), tr("Invalid collector address: %1").arg(address));
+        return false;
+    }
+
+    return true;
+}
+
+void FlowExporter::start(quint64 now)
+{
+    size = 0;
+    setStart = -1;
+    messageRecords = 0;
+    templateRecords = 0;
+
+    sequence = 0;
+    startTime = now;
+    lastTemplate = 0;
+
+    packetsSent = 0;
+    recordsSent = 0;
+    recordsDropped = 0;
+    sendError = false;
+}
+
+void FlowExporter::exportFlows(const Flow *flows, int count, quint64 now)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (flows[i].packets[0])
+            appendRecord(flows[i], 0, now);
+
+        if (flows[i].packets[1])
+            appendRecord(flows[i], 1, now);
+    }
+}
+
+void FlowExporter::flush(quint64 now)
+{
+    if (messageRecords)
+        send();
+
+    // templates are resent periodically even if there is nothing to export
+    if (lastTemplate + templateRefresh <= now)
+    {
+        beginMessage(now);
+        send();
+    }
+}
+
+void FlowExporter::beginMessage(quint64 now)
+{
+    size = 0;
+    setStart = -1;
+    messageRecords = 0;
+    templateRecords = 0;
+
+    if (version == IPFIX)
+    {
+        put16(IPFIX);
+        put16(0);                           // length, set in send()
+        put32((quint32)(now / 1000));       // export time
+        put32(sequence);                    // data records sent so far
+        put32(domain);                      // observation domain
+    }
+    else
+    {
+        put16(NETFLOW_V9);
+        put16(0);                           // count, set in send()
+        put32((quint32)(now - startTime));  // system uptime
+        put32((quint32)(now / 1000));       // unix seconds
+        put32(sequence);                    // export packets sent so far
+        put32(domain);                      // source id
+    }
+
+    if (lastTemplate == 0 || lastTemplate + templateRefresh <= now)
+    {
+        appendTemplate();
+        lastTemplate = now;
+    }
+}
+
+void FlowExporter::appendTemplate()
+{
+    // template set id: 2 in IPFIX, 0 in NetFlow v9
+    beginSet(version == IPFIX ? 2 : 0);
+
+    for (int family = 0; family < 2; ++family)
+    {
+        const quint16 (*addressFields)[2] = family ? ipv6Fields : ipv4Fields;
+
+        put16(family ? TEMPLATE_IPV6 : TEMPLATE_IPV4);
+        put16(2 + fieldCount);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            put16(addressFields[i][0]);
+            put16(addressFields[i][1]);
+        }
+
+        for (int i = 0; i < fieldCount; ++i)
+        {
+            put16(fields[i][0]);
+            put16(fields[i][1]);
+        }
+
+        ++templateRecords;
+    }
+
+    endSet();
+}
+
+void FlowExporter::beginSet(quint16 id)
+{
+    setStart = size;
+    setId = id;
+
+    put16(id);
+    put16(0);   // length, set in endSet()
+}
+
+void FlowExporter::endSet()
+{
+    if (setStart < 0)
+        return;
+
+    // pad to 32 bits
+    while (size & 3)
+        put8(0);
+
+    qToBigEndian<quint16>(size - setStart, data + setStart + 2);
+
+    setStart = -1;
+}
+
+void FlowExporter::appendRecord(const Flow &flow, int direction, quint64 now)
+{
+    bool ipv6 = flow.loIP.isIPv6();
+    quint16 id = ipv6 ? TEMPLATE_IPV6 : TEMPLATE_IPV4;
+    int recordLength = fieldsLength + (ipv6 ? 32 : 8);
+
+    // no room for the record (set header and padding)? send the message first
+    if (size == 0 || size + recordLength + 3 + ((setStart < 0 || setId != id) ? 4 + 3 : 0) > MAX_MESSAGE_SIZE)
+    {
+        if (size)
+            send();
+
+        beginMessage(now);
+    }
+
+    if (setStart >= 0 && setId != id)
+        endSet();
+
+    if (setStart < 0)
+        beginSet(id);
+
+    // addresses are kept in network byte order
+    const IpAddress &sIP = direction ? flow.hiIP : flow.loIP;
+    const IpAddress &dIP = direction ? flow.loIP : flow.hiIP;
+
+    if (ipv6)
+    {
+        memcpy(data + size, sIP.toIPv6(), 16);
+        size += 16;
+        memcpy(data + size, dIP.toIPv6(), 16);
+        size += 16;
+    }
+    else
+    {
+        quint32 s = sIP.toIPv4(), d = dIP.toIPv4();
+
+        memcpy(data + size, &s, 4);
+        size += 4;
+        memcpy(data + size, &d, 4);
+        size += 4;
+    }
+
+    put16(direction ? flow.hiPort : flow.loPort);
+    put16(direction ? flow.loPort : flow.hiPort);
+    put8(flow.proto);
+    put8(flow.tcpFlags);
+    put64(flow.packets[direction]);
+    put64(flow.bytes[direction]);
+
+    if (version == IPFIX)
+    {
+        put64(flow.first);
+        put64(flow.last);
+        put8(flow.endReason);
+    }
+    else
+    {
+        put32(flow.first > startTime ? (quint32)(flow.first - startTime) : 0);
+        put32(flow.last > startTime ? (quint32)(flow.last - startTime) : 0);
+    }
+
+    ++messageRecords;
+}
+
+void FlowExporter::send()
+{
+    endSet();
+
+    // IPFIX: message length, NetFlow v9: number of records
+    if (version == IPFIX)
+        qToBigEndian<quint16>(size, data + 2);
+    else
+        qToBigEndian<quint16>(messageRecords + templateRecords, data + 2);
+
+    if (socket->writeDatagram((const char *)data, size, collector, port) == size)
+    {
+        ++packetsSent;
+        recordsSent += messageRecords;
+    }
+    else
+    {
+        recordsDropped += messageRecords;
+
+        // report only the first failure
+        if (!sendError)
+        {
+            sendError = true;
+
+            // 2 - warning
+            emit infoMessage(2, tr("Flow exporter"), tr("Unable to send flow records to %1:%2. %3").arg(collector.toString()).arg(port).arg(socket->errorString()));
+        }
+    }
+
+    // the sequence number advances even for lost messages, so the collector sees the gap
+    if (version == IPFIX)
+        sequence += messageRecords;
+    else
+        ++sequence;
+
+    size = 0;
+    messageRecords = 0;
+    templateRecords = 0;
+}
@@ -0,0 +1,99 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOWEXPORTER_H
+#define FLOWEXPORTER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QtEndian>
+
+#include "flowtable.h"
+
+// exports expired flows to a collector over UDP, as IPFIX (RFC 7011) or NetFlow v9 (RFC 3954);
+// every bidirectional flow becomes one record per direction, records are written
+// straight into a preallocated message buffer
+class FlowExporter : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FlowExporter)
+
+public:
+    enum { NETFLOW_V9 = 9, IPFIX = 10 };
+
+    explicit FlowExporter(QObject *parent = 0);
+    ~FlowExporter();
+
+    bool setCollector(quint8 version, const QString &address, quint16 port, quint32 domain, quint32 templateRefresh);
+    void start(quint64 now);
+
+    void exportFlows(const Flow *flows, int count, quint64 now);
+    void flush(quint64 now);
+
+    quint64 exportedPackets() const { return packetsSent; }
+    quint64 exportedRecords() const { return recordsSent; }
+    quint64 droppedRecords() const { return recordsDropped; }
+
+private:
+    QUdpSocket *socket;
+
+    QHostAddress collector;
+    quint16 port;
+
+    quint8 version;
+    quint32 domain;
+    quint64 templateRefresh;
+
+    // message buffer
+    QByteArray buffer;
+    uchar *data;
+    int size;
+    int setStart;
+    quint16 setId;
+    int messageRecords;
+    int templateRecords;
+
+    quint32 sequence;
+    quint64 startTime;
+    quint64 lastTemplate;
+
+    quint64 packetsSent, recordsSent, recordsDropped;
+    bool sendError;
+
+    const quint16 (*fields)[2];
+    int fieldCount;
+    int fieldsLength;
+
+    void beginMessage(quint64 now);
+    void appendTemplate();
+    void beginSet(quint16 id);
+    void endSet();
+    void appendRecord(const Flow &flow, int direction, quint64 now);
+    void send();
+
+    inline void put8(quint8 value) { data[size++] = value; }
+    inline void put16(quint16 value) { qToBigEndian<quint16>(value, data + size); size += 2; }
+    inline void put32(quint32 value) { qToBigEndian<quint32>(value, data + size); size += 4; }
+    inline void put64(quint64 value) { qToBigEndian<quint64>(value, data + size); size += 8; }
+
+signals:
+    void infoMessage(quint8 type, const QString &title, const QString &message);
+};
+
+#endif // FLOWEXPORTER_H
@@ -0,0 +1,254 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "flowtable.h"
+
+#include <string.h>
+
+FlowTable::FlowTable()
+{
+    mask = 0;
+    used = 0;
+    maxUsed = 0;
+    cursor = 0;
+
+    idleTimeout = 15000;
+    activeTimeout = 1800000;
+
+    droppedFlows = 0;
+    expiredFlows = 0;
+}
+
+void FlowTable::allocate(quint32 capacity)
+{
+    quint32 size = 1024;
+    while (size < capacity && size < (quint32)MAX_CAPACITY)
+        size <<= 1;
+
+    if ((quint32)table.size() != size)
+    {
+        table.clear();
+        table.resize(size);
+    }
+
+    mask = size - 1;
+
+    // keep probe sequences short, new flows beyond 3/4 of the table are dropped
+    maxUsed = size - size / 4;
+
+    clear();
+}
+
+void FlowTable::setTimeouts(quint32 idleTimeout, quint32 activeTimeout)
+{
+    this->idleTimeout = (quint64)idleTimeout * 1000;
+    this->activeTimeout = (quint64)activeTimeout * 1000;
+}
+
+void FlowTable::clear()
+{
+    if (!table.isEmpty())
+        memset(table.data(), 0, table.size() * sizeof(Flow));
+
+    used = 0;
+    cursor = 0;
+
+    droppedFlows = 0;
+    expiredFlows = 0;
+}
+
+quint32 FlowTable::hash(const IpAddress &loIP, const IpAddress &hiIP, quint16 loPort, quint16 hiPort, quint8 proto) const
+{
+    // murmur3 finalizer over the key words
+    quint32 h = qHash(loIP) * 0x9e3779b1 ^ qHash(hiIP);
+    h ^= ((quint32)loPort << 16 | hiPort) * 0x85ebca6b;
+    h ^= proto;
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+bool FlowTable::update(const IpAddress &sIP, const IpAddress &dIP, quint16 sPort, quint16 dPort, quint8 proto, quint8 tcpFlags, quint32 length, quint64 time)
+{
+    if (table.isEmpty())
+        return false;
+
+    // canonical order
+    int direction = (sIP < dIP || (sIP == dIP && sPort <= dPort)) ? 0 : 1;
+
+    const IpAddress &loIP = direction ? dIP : sIP;
+    const IpAddress &hiIP = direction ? sIP : dIP;
+    quint16 loPort = direction ? dPort : sPort;
+    quint16 hiPort = direction ? sPort : dPort;
+
+    Flow *t = table.data();
+    quint32 i = hash(loIP, hiIP, loPort, hiPort, proto) & mask;
+
+    forever
+    {
+        Flow &flow = t[i];
+
+        if (!flow.used)
+        {
+            if (used >= maxUsed)
+            {
+                ++droppedFlows;
+                return false;
+            }
+
+            flow.loIP = loIP;
+            flow.hiIP = hiIP;
+            flow.loPort = loPort;
+            flow.hiPort = hiPort;
+            flow.proto = proto;
+            flow.tcpFlags = 0;
+            flow.used = 1;
+            flow.endReason = 0;
+            flow.packets[0] = flow.packets[1] = 0;
+            flow.bytes[0] = flow.bytes[1] = 0;
+            flow.first = time;
+            flow.last = time;
+
+            ++used;
+            break;
+        }
+
+        if (flow.loIP == loIP && flow.hiIP == hiIP && flow.loPort == loPort && flow.hiPort == hiPort && flow.proto == proto)
+            break;
+
+        i = (i + 1) & mask;
+    }
+
+    Flow &flow = t[i];
+
+    ++flow.packets[direction];
+    flow.bytes[direction] += length;
+    flow.tcpFlags |= tcpFlags;
+
+    if (time > flow.last)
+        flow.last = time;
+
+    return true;
+}
+
+// backward shift deletion, keeps the table free of tombstones
+void FlowTable::remove(quint32 i)
+{
+    Flow *t = table.data();
+    quint32 j = i;
+
+    forever
+    {
+        t[i].used = 0;
+
+        forever
+        {
+            j = (j + 1) & mask;
+
+            if (!t[j].used)
+            {
+                --used;
+                return;
+            }
+
+            quint32 k = hash(t[j].loIP, t[j].hiIP, t[j].loPort, t[j].hiPort, t[j].proto) & mask;
+
+            // entry j may move to i only if its home slot k is not cyclically in (i, j]
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                continue;
+
+            break;
+        }
+
+        t[i] = t[j];
+        i = j;
+    }
+}
+
+int FlowTable::expire(quint64 now, quint32 maxScan, Flow *out, int maxOut)
+{
+    if (table.isEmpty())
+        return 0;
+
+    Flow *t = table.data();
+    int n = 0;
+
+    for (quint32 scanned = 0; scanned < maxScan && n < maxOut && used > 0; ++scanned)
+    {
+        Flow &flow = t[cursor];
+
+        if (flow.used)
+        {
+            if (flow.last + idleTimeout <= now)
+            {
+                out[n] = flow;
+                out[n++].endReason = FLOW_END_IDLE;
+                ++expiredFlows;
+
+                // the next entry of the cluster may shift into this slot, look at it again
+                remove(cursor);
+                continue;
+            }
+
+            if (flow.first + activeTimeout <= now)
+            {
+                out[n] = flow;
+                out[n++].endReason = FLOW_END_ACTIVE;
+                ++expiredFlows;
+
+                // long lived flow, report and start counting again
+                flow.packets[0] = flow.packets[1] = 0;
+                flow.bytes[0] = flow.bytes[1] = 0;
+                flow.tcpFlags = 0;
+                flow.first = now;
+            }
+        }
+
+        cursor = (cursor + 1) & mask;
+    }
+
+    return n;
+}
+
+int FlowTable::flush(Flow *out, int maxOut)
+{
+    Flow *t = table.data();
+    int n = 0;
+
+    // the table is emptied, so entries are dropped without shifting
+    for (quint32 scanned = 0; scanned < (quint32)table.size() && n < maxOut && used > 0; ++scanned)
+    {
+        if (t[cursor].used)
+        {
+            out[n] = t[cursor];
+            out[n++].endReason = FLOW_END_FORCED;
+            ++expiredFlows;
+
+            t[cursor].used = 0;
+            --used;
+        }
+
+        cursor = (cursor + 1) & mask;
+    }
+
+    return n;
+}
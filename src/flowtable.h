@@ -0,0 +1,88 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOWTABLE_H
+#define FLOWTABLE_H
+
+#include <QVector>
+
+#include "ipaddress.h"
+
+// expiry reasons (IPFIX flowEndReason)
+enum { FLOW_END_IDLE = 1, FLOW_END_ACTIVE = 2, FLOW_END_FORCED = 4 };
+
+// bidirectional flow, the key is the canonical 5-tuple (lower address first)
+struct Flow
+{
+    IpAddress loIP;
+    IpAddress hiIP;
+    quint16 loPort;
+    quint16 hiPort;
+    quint8 proto;
+    quint8 tcpFlags;        // TCP flags seen in both directions
+    quint8 used;
+    quint8 endReason;
+    quint32 packets[2];     // [0] lo -> hi, [1] hi -> lo
+    quint64 bytes[2];
+    quint64 first;          // milliseconds since the epoch
+    quint64 last;
+};
+
+// preallocated open addressing (linear probing) flow table,
+// memory use is fixed by the capacity and does not grow with traffic
+class FlowTable
+{
+public:
+    FlowTable();
+
+    // capacity is rounded up to a power of two, at most MAX_CAPACITY
+    enum { MAX_CAPACITY = 1 << 24 };
+    void allocate(quint32 capacity);
+    void setTimeouts(quint32 idleTimeout, quint32 activeTimeout);
+    void clear();
+
+    // returns false if the flow is new and the table is full
+    bool update(const IpAddress &sIP, const IpAddress &dIP, quint16 sPort, quint16 dPort, quint8 proto, quint8 tcpFlags, quint32 length, quint64 time);
+
+    // copies up to maxOut expired flows to out, visiting at most maxScan slots;
+    // idle flows are removed, flows over the active timeout are restarted
+    int expire(quint64 now, quint32 maxScan, Flow *out, int maxOut);
+
+    // copies up to maxOut flows to out and removes them, call until it returns 0
+    int flush(Flow *out, int maxOut);
+
+    quint32 capacity() const { return table.size(); }
+    quint32 count() const { return used; }
+    quint64 dropped() const { return droppedFlows; }
+    quint64 expired() const { return expiredFlows; }
+
+private:
+    QVector<Flow> table;
+
+    quint32 mask;
+    quint32 used, maxUsed;
+    quint32 cursor;
+
+    quint64 idleTimeout, activeTimeout;
+
+    quint64 droppedFlows, expiredFlows;
+
+    quint32 hash(const IpAddress &loIP, const IpAddress &hiIP, quint16 loPort, quint16 hiPort, quint8 proto) const;
+    void remove(quint32 i);
+};
+
+#endif // FLOWTABLE_H
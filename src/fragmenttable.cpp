@@ -0,0 +1,146 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fragmenttable.h"
+
+#include <string.h>
+
+FragmentTable::FragmentTable()
+{
+    mask = 0;
+    timeout = 30000;
+
+    evictedEntries = 0;
+}
+
+void FragmentTable::allocate(quint32 capacity)
+{
+    quint32 size = 256;
+    while (size < capacity && size < 0x10000000)
+        size <<= 1;
+
+    if ((quint32)table.size() != size)
+    {
+        table.clear();
+        table.resize(size);
+    }
+
+    mask = size - 1;
+
+    clear();
+}
+
+void FragmentTable::setTimeout(quint32 timeout)
+{
+    this->timeout = (quint64)timeout * 1000;
+}
+
+void FragmentTable::clear()
+{
+    if (!table.isEmpty())
+        memset(table.data(), 0, table.size() * sizeof(Entry));
+
+    evictedEntries = 0;
+}
+
+quint32 FragmentTable::hash(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto) const
+{
+    // murmur3 finalizer over the key words
+    quint32 h = qHash(sIP) * 0x9e3779b1 ^ qHash(dIP);
+    h ^= id * 0x85ebca6b;
+    h ^= proto;
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+void FragmentTable::insert(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto, quint32 sPort, quint32 dPort, quint64 time)
+{
+    if (table.isEmpty())
+        return;
+
+    Entry *t = table.data();
+    quint32 i = hash(sIP, dIP, id, proto);
+    Entry *slot = 0;
+
+    for (int probe = 0; probe < PROBES; ++probe, ++i)
+    {
+        Entry &entry = t[i & mask];
+
+        // the same datagram again (duplicate first fragment)
+        if (entry.used && entry.id == id && entry.proto == proto && entry.sIP == sIP && entry.dIP == dIP)
+        {
+            slot = &entry;
+            break;
+        }
+
+        // free or expired
+        if (!entry.used || time > entry.time + timeout)
+        {
+            if (!slot || slot->used)
+                slot = &entry;
+            continue;
+        }
+
+        // otherwise the oldest one
+        if (!slot || (slot->used && entry.time < slot->time))
+            slot = &entry;
+    }
+
+    if (slot->used && time <= slot->time + timeout && !(slot->id == id && slot->proto == proto && slot->sIP == sIP && slot->dIP == dIP))
+        ++evictedEntries;
+
+    slot->sIP = sIP;
+    slot->dIP = dIP;
+    slot->id = id;
+    slot->sPort = sPort;
+    slot->dPort = dPort;
+    slot->proto = proto;
+    slot->used = 1;
+    slot->time = time;
+}
+
+bool FragmentTable::find(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto, quint64 time, quint32 *sPort, quint32 *dPort) const
+{
+    if (table.isEmpty())
+        return false;
+
+    const Entry *t = table.constData();
+    quint32 i = hash(sIP, dIP, id, proto);
+
+    for (int probe = 0; probe < PROBES; ++probe, ++i)
+    {
+        const Entry &entry = t[i & mask];
+
+        if (entry.used && entry.id == id && entry.proto == proto && entry.sIP == sIP && entry.dIP == dIP)
+        {
+            if (time > entry.time + timeout)
+                return false;
+
+            *sPort = entry.sPort;
+            *dPort = entry.dPort;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FRAGMENTTABLE_H
+#define FRAGMENTTABLE_H
+
+#include <QVector>
+
+#include "ipaddress.h"
+
+// ports of the first fragments of IP datagrams, so the later fragments (no transport
+// header) can be attributed to them; memory is fixed by the capacity, entries expire
+// after the timeout and the oldest entry of a full probe window is evicted
+class FragmentTable
+{
+public:
+    FragmentTable();
+
+    // capacity is rounded up to a power of two
+    void allocate(quint32 capacity);
+    void setTimeout(quint32 timeout);
+    void clear();
+
+    // first fragment of a datagram
+    void insert(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto, quint32 sPort, quint32 dPort, quint64 time);
+
+    // later fragment, returns false if the first fragment is unknown or expired
+    bool find(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto, quint64 time, quint32 *sPort, quint32 *dPort) const;
+
+    quint32 capacity() const { return table.size(); }
+    quint64 evicted() const { return evictedEntries; }
+
+private:
+    struct Entry
+    {
+        IpAddress sIP;
+        IpAddress dIP;
+        quint32 id;
+        quint32 sPort;
+        quint32 dPort;
+        quint8 proto;
+        quint8 used;
+        quint64 time;       // milliseconds since the epoch
+    };
+
+    // slots checked from the hashed one, bounds lookups and inserts
+    enum { PROBES = 8 };
+
+    QVector<Entry> table;
+
+    quint32 mask;
+    quint64 timeout;
+
+    quint64 evictedEntries;
+
+    quint32 hash(const IpAddress &sIP, const IpAddress &dIP, quint32 id, quint8 proto) const;
+};
+
+#endif // FRAGMENTTABLE_H
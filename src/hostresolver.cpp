@@ -0,0 +1,270 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "hostresolver.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <QDateTime>
+
+HostResolver::HostResolver(QObject *parent)
+    : QObject(parent)
+{
+    lookupsEnabled = true;
+    maxRunning = 8;
+    cacheSize = 10000;
+    ttl = 3600;
+    negativeTtl = 300;
+
+    lookupsTotal = 0;
+    failuresTotal = 0;
+    hitsTotal = 0;
+    droppedTotal = 0;
+}
+
+HostResolver::~HostResolver()
+{
+    abort();
+}
+
+void HostResolver::setLimits(bool lookups, int maxRunning, int cacheSize, quint32 ttl, quint32 negativeTtl)
+{
+    this->lookupsEnabled = lookups;
+    this->maxRunning = qMax(1, maxRunning);
+    this->cacheSize = qMax(1, cacheSize);
+    this->ttl = ttl;
+    this->negativeTtl = negativeTtl;
+
+    // the cache may have to shrink
+    while (cache.count() > this->cacheSize)
+    {
+        cache.remove(lru.last());
+        lru.removeLast();
+    }
+}
+
+// hosts(5) format: an address followed by its name and aliases, # starts a comment
+bool HostResolver::loadHostsFile(const QString &fileName, QString *error)
+{
+    hosts.clear();
+
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+
+    while (!in.atEnd())
+    {
+        QString line = in.readLine();
+
+        int comment = line.indexOf('#');
+        if (comment != -1)
+            line.truncate(comment);
+
+        QStringList fields = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if (fields.count() < 2)
+            continue;
+
+        IpAddress ip = IpAddress::fromString(fields.at(0));
+
+        // the first name of an address wins, as in the system resolver
+        if (!ip.isNull() && !hosts.contains(ip))
+            hosts.insert(ip, fields.at(1));
+    }
+
+    file.close();
+
+    return true;
+}
+
+QString HostResolver::name(const IpAddress &ip)
+{
+    QHash<IpAddress, QString>::const_iterator h = hosts.constFind(ip);
+    if (h != hosts.constEnd())
+        return h.value();
+
+    QHash<IpAddress, Entry>::iterator it = cache.find(ip);
+    if (it == cache.end() || it.value().expires < QDateTime::currentDateTime().toTime_t())
+        return QString();
+
+    // most recently used
+    lru.erase(it.value().lru);
+    lru.prepend(ip);
+    it.value().lru = lru.begin();
+
+    return it.value().name;
+}
+
+void HostResolver::lookup(const IpAddress &ip)
+{
+    if (hosts.contains(ip))
+        return;
+
+    if (fresh(ip, QDateTime::currentDateTime().toTime_t(), false))
+    {
+        ++hitsTotal;
+        return;
+    }
+
+    if (!lookupsEnabled || waiting.contains(ip))
+        return;
+
+    // a burst of new addresses must not grow the queue without bound
+    if (queue.count() >= cacheSize)
+    {
+        ++droppedTotal;
+        return;
+    }
+
+    queue.append(ip);
+    waiting.insert(ip);
+
+    startLookups();
+}
+
+bool HostResolver::insertName(const IpAddress &ip, const QString &name, quint32 ttl)
+{
+    if (hosts.contains(ip))
+        return false;
+
+    quint32 now = QDateTime::currentDateTime().toTime_t();
+
+    QHash<IpAddress, Entry>::const_iterator it = cache.constFind(ip);
+    bool changed = it == cache.constEnd() || it.value().expires < now || it.value().name != name;
+
+    // a raw 32 bit record TTL, with the high bit set it is 0 (RFC 2181), at most a week
+    if (ttl >= 0x80000000u)
+        ttl = 0;
+    ttl = qMin(ttl, (quint32)MAX_RECORD_TTL);
+
+    // record TTLs of CDNs are often seconds, the name is still the best one known
+    insert(ip, name, now + qMax(ttl, this->ttl));
+
+    return changed;
+}
+
+void HostResolver::abort()
+{
+    QHash<int, IpAddress>::const_iterator it = runningIds.constBegin();
+    for (; it != runningIds.constEnd(); ++it)
+        QHostInfo::abortHostLookup(it.key());
+
+    runningIds.clear();
+    queue.clear();
+    waiting.clear();
+}
+
+// cached and not expired, with a name only if named
+bool HostResolver::fresh(const IpAddress &ip, quint32 now, bool named) const
+{
+    QHash<IpAddress, Entry>::const_iterator it = cache.constFind(ip);
+
+    return it != cache.constEnd() && it.value().expires >= now && (!named || !it.value().name.isEmpty());
+}
+
+void HostResolver::insert(const IpAddress &ip, const QString &name, quint32 expires)
+{
+    QHash<IpAddress, Entry>::iterator it = cache.find(ip);
+
+    if (it != cache.end())
+    {
+        lru.erase(it.value().lru);
+    }
+    else
+    {
+        if (cache.count() >= cacheSize)
+        {
+            cache.remove(lru.last());
+            lru.removeLast();
+        }
+
+        it = cache.insert(ip, Entry());
+    }
+
+    lru.prepend(ip);
+
+    Entry &entry = it.value();
+    entry.name = name;
+    entry.expires = expires;
+    entry.lru = lru.begin();
+}
+
+void HostResolver::startLookups()
+{
+    quint32 now = QDateTime::currentDateTime().toTime_t();
+
+    while (runningIds.count() < maxRunning && !queue.isEmpty())
+    {
+        IpAddress ip = queue.takeFirst();
+
+        // named from the traffic while waiting
+        if (fresh(ip, now, true))
+        {
+            waiting.remove(ip);
+            continue;
+        }
+
+        int id = QHostInfo::lookupHost(ip.toString(), this, SLOT(lookedUp(QHostInfo)));
+        runningIds.insert(id, ip);
+
+        ++lookupsTotal;
+    }
+}
+
+void HostResolver::lookedUp(const QHostInfo &host)
+{
+    QHash<int, IpAddress>::iterator it = runningIds.find(host.lookupId());
+
+    // aborted
+    if (it == runningIds.end())
+        return;
+
+    IpAddress ip = it.value();
+    runningIds.erase(it);
+    waiting.remove(ip);
+
+    quint32 now = QDateTime::currentDateTime().toTime_t();
+
+    // a name seen in the traffic meanwhile is kept
+    if (fresh(ip, now, true))
+    {
+        startLookups();
+        return;
+    }
+
+    // without a PTR record the address itself comes back as the name
+    QString name;
+    if (host.error() == QHostInfo::NoError && host.hostName() != ip.toString())
+        name = host.hostName();
+    else
+        ++failuresTotal;
+
+    insert(ip, name, now + (name.isEmpty() ? negativeTtl : ttl));
+
+    startLookups();
+
+    if (!name.isEmpty())
+        emit resolved(ip, name);
+}
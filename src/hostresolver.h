@@ -0,0 +1,105 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HOSTRESOLVER_H
+#define HOSTRESOLVER_H
+
+#include <QObject>
+#include <QHostInfo>
+#include <QHash>
+#include <QSet>
+#include <QLinkedList>
+#include <QString>
+
+#include "ipaddress.h"
+
+// reverse DNS lookups of addresses, each address is looked up once however many
+// rows need its name; answers are kept in an LRU cache, failures too for a shorter
+// time, and at most maxRunning lookups run at once while the rest wait in a queue;
+// names from a hosts file are answered without any lookup, names seen in the
+// traffic are cached too and win over the answers
+class HostResolver : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(HostResolver)
+
+public:
+    explicit HostResolver(QObject *parent = 0);
+    ~HostResolver();
+
+    void setLimits(bool lookups, int maxRunning, int cacheSize, quint32 ttl, quint32 negativeTtl);
+    bool loadHostsFile(const QString &fileName, QString *error);
+
+    // the name if known, an empty string otherwise
+    QString name(const IpAddress &ip);
+
+    // resolved() follows unless the address is cached, already on the way or dropped
+    void lookup(const IpAddress &ip);
+
+    // a name seen in the traffic, kept for at least ttl seconds; true if it is new
+    bool insertName(const IpAddress &ip, const QString &name, quint32 ttl);
+
+    // forget the queued and running lookups, the cache is kept
+    void abort();
+
+    int cached() const { return cache.count(); }
+    int running() const { return runningIds.count(); }
+    int queued() const { return queue.count(); }
+
+    quint64 lookups() const { return lookupsTotal; }
+    quint64 failures() const { return failuresTotal; }
+    quint64 hits() const { return hitsTotal; }
+    quint64 dropped() const { return droppedTotal; }
+
+private:
+    // a week, longer TTLs of names seen in the traffic are cut to it
+    enum { MAX_RECORD_TTL = 604800 };
+
+    struct Entry
+    {
+        QString name;       // empty if the lookup failed
+        quint32 expires;    // seconds since the epoch
+        QLinkedList<IpAddress>::iterator lru;
+    };
+
+    QHash<IpAddress, Entry> cache;
+    QLinkedList<IpAddress> lru;     // most recently used first
+    QHash<IpAddress, QString> hosts;
+
+    QList<IpAddress> queue;
+    QSet<IpAddress> waiting;        // queued or running
+    QHash<int, IpAddress> runningIds;
+
+    bool lookupsEnabled;
+    int maxRunning;
+    int cacheSize;
+    quint32 ttl, negativeTtl;
+
+    quint64 lookupsTotal, failuresTotal, hitsTotal, droppedTotal;
+
+    bool fresh(const IpAddress &ip, quint32 now, bool named) const;
+    void insert(const IpAddress &ip, const QString &name, quint32 expires);
+    void startLookups();
+
+private slots:
+    void lookedUp(const QHostInfo &host);
+
+signals:
+    void resolved(const IpAddress &ip, const QString &name);
+};
+
+#endif // HOSTRESOLVER_H
@@ -0,0 +1,251 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "hyperloglog.h"
+
+#include <math.h>
+
+HyperLogLog::HyperLogLog(int precision)
+{
+    setPrecision(precision);
+}
+
+void HyperLogLog::setPrecision(int precision)
+{
+    this->precision = qBound(4, precision, 16);
+    clear();
+}
+
+void HyperLogLog::clear()
+{
+    registers.clear();
+    sparse.clear();
+}
+
+bool HyperLogLog::add(quint64 hash)
+{
+    quint32 index = hash >> (64 - precision);
+
+    // rank of the first 1 bit in the remaining bits
+    quint64 w = hash << precision;
+    quint8 rank = 1;
+    while (rank <= 64 - precision && !(w & Q_UINT64_C(0x8000000000000000)))
+    {
+        w <<= 1;
+        ++rank;
+    }
+
+    return set(index, rank);
+}
+
+bool HyperLogLog::set(quint32 index, quint8 rank)
+{
+    if (!registers.isEmpty())
+    {
+        if (registers.at(index) >= rank)
+            return false;
+
+        registers[index] = rank;
+        return true;
+    }
+
+    // binary search for the index
+    int lo = 0, hi = sparse.count();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if ((sparse.at(mid) >> 8) < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < sparse.count() && (sparse.at(lo) >> 8) == index)
+    {
+        if ((sparse.at(lo) & 0xff) >= rank)
+            return false;
+
+        sparse[lo] = index << 8 | rank;
+        return true;
+    }
+
+    sparse.insert(lo, index << 8 | rank);
+
+    // 4 bytes an entry, dense is smaller past a quarter of the registers
+    if (sparse.count() > (1 << precision) / 4)
+        toDense();
+
+    return true;
+}
+
+void HyperLogLog::toDense()
+{
+    registers.fill(0, 1 << precision);
+
+    for (int i = 0; i < sparse.count(); ++i)
+        registers[sparse.at(i) >> 8] = sparse.at(i) & 0xff;
+
+    sparse.clear();
+    sparse.squeeze();
+}
+
+quint64 HyperLogLog::count() const
+{
+    int m = 1 << precision;
+
+    // few registers set, linear counting is exact enough
+    if (registers.isEmpty())
+    {
+        if (sparse.isEmpty())
+            return 0;
+
+        return (quint64)(m * log((double)m / (m - sparse.count())) + 0.5);
+    }
+
+    double sum = 0.0;
+    int zeros = 0;
+
+    for (int i = 0; i < m; ++i)
+    {
+        sum+=1.0 / (Q_UINT64_C(1) << registers.at(i));
+
+        if (registers.at(i) == 0)
+            ++zeros;
+    }
+
+    double alpha;
+    switch (m)
+    {
+    case 16: alpha = 0.673; break;
+    case 32: alpha = 0.697; break;
+    case 64: alpha = 0.709; break;
+    default: alpha = 0.7213 / (1.0 + 1.079 / m);
+    }
+
+    double estimate = alpha * m * m / sum;
+
+    if (estimate <= 2.5 * m && zeros != 0)
+        estimate = m * log((double)m / zeros);
+
+    return (quint64)(estimate + 0.5);
+}
+
+int HyperLogLog::memory() const
+{
+    return registers.isEmpty() ? sparse.count() * 4 : registers.count();
+}
+
+// precision, 1 if dense, then the registers or the little endian sparse entries
+QByteArray HyperLogLog::toBytes() const
+{
+    QByteArray bytes;
+
+    bytes.append((char)precision);
+    bytes.append((char)(registers.isEmpty() ? 0 : 1));
+
+    if (!registers.isEmpty())
+        bytes.append((const char *)registers.constData(), registers.count());
+    else
+    {
+        for (int i = 0; i < sparse.count(); ++i)
+        {
+            uchar entry[4];
+            qToLittleEndian(sparse.at(i), entry);
+            bytes.append((const char *)entry, 4);
+        }
+    }
+
+    return bytes;
+}
+
+bool HyperLogLog::fromBytes(const QByteArray &bytes)
+{
+    clear();
+
+    if (bytes.size() < 2 || (quint8)bytes.at(0) != precision)
+        return false;
+
+    const uchar *data = (const uchar *)bytes.constData() + 2;
+    int size = bytes.size() - 2;
+    quint32 m = 1 << precision;
+    quint8 maxRank = 64 - precision + 1;
+
+    if (bytes.at(1) == 1)
+    {
+        if (size != (int)m)
+            return false;
+
+        for (quint32 i = 0; i < m; ++i)
+        {
+            if (data[i] > maxRank)
+            {
+                clear();
+                return false;
+            }
+
+            if (data[i])
+                set(i, data[i]);
+        }
+
+        return true;
+    }
+
+    if (bytes.at(1) != 0 || size % 4)
+        return false;
+
+    for (int i = 0; i < size; i+=4)
+    {
+        quint32 entry = qFromLittleEndian<quint32>(data + i);
+        quint32 index = entry >> 8;
+        quint8 rank = entry & 0xff;
+
+        if (index >= m || rank == 0 || rank > maxRank)
+        {
+            clear();
+            return false;
+        }
+
+        set(index, rank);
+    }
+
+    return true;
+}
+
+// 64 bit mix of the address words (MurmurHash3 finalizer)
+quint64 HyperLogLog::hash(const IpAddress &ip)
+{
+    quint64 h;
+
+    if (ip.isIPv4())
+        h = ip.toIPv4();
+    else
+    {
+        const quint8 *b = ip.toIPv6();
+        h = 0;
+        for (int i = 0; i < 16; ++i)
+            h = h * 131 + b[i];
+    }
+
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+
+    return h;
+}
@@ -0,0 +1,61 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <QVector>
+#include <QByteArray>
+
+#include "ipaddress.h"
+
+// distinct count estimate in 2^precision registers (1.04 / sqrt(2^precision) standard error);
+// small sets are kept as a sorted list of register updates and take only a few bytes
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(int precision = 12);
+
+    void setPrecision(int precision);
+    void clear();
+
+    // returns true if the estimate may have changed
+    bool add(quint64 hash);
+    bool add(const IpAddress &ip) { return add(hash(ip)); }
+
+    quint64 count() const;
+
+    // bytes used by the registers
+    int memory() const;
+
+    // the registers to be kept and loaded back, fromBytes() is false if they are
+    // damaged or of another precision and leaves the estimate empty
+    QByteArray toBytes() const;
+    bool fromBytes(const QByteArray &bytes);
+
+    static quint64 hash(const IpAddress &ip);
+
+private:
+    QVector<quint8> registers;  // empty while sparse
+    QVector<quint32> sparse;    // index << 8 | rank, sorted by index
+    quint8 precision;
+
+    bool set(quint32 index, quint8 rank);
+    void toDense();
+};
+
+#endif // HYPERLOGLOG_H
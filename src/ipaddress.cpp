@@ -0,0 +1,147 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ipaddress.h"
+
+IpAddress::IpAddress(const QHostAddress &address)
+{
+    words[0] = words[1] = words[2] = words[3] = 0;
+
+    switch (address.protocol())
+    {
+        case QAbstractSocket::IPv4Protocol:
+            family = 4;
+            words[0] = qToBigEndian<quint32>(address.toIPv4Address());
+            break;
+
+        case QAbstractSocket::IPv6Protocol:
+            family = 6;
+            memcpy(words, address.toIPv6Address().c, 16);
+            break;
+
+        default:
+            family = 0;
+            break;
+    }
+}
+
+IpAddress IpAddress::fromString(const QString &address)
+{
+    return IpAddress(QHostAddress(address));
+}
+
+QString IpAddress::toString() const
+{
+    const quint8 *b = (const quint8 *)words;
+
+    if (family == 4)
+        return QString("%1.%2.%3.%4").arg(b[0]).arg(b[1]).arg(b[2]).arg(b[3]);
+
+    if (family != 6)
+        return QString();
+
+    // RFC 5952: lower case, no leading zeros, longest run of zero groups compressed
+    quint16 groups[8];
+    for (int i = 0; i < 8; ++i)
+        groups[i] = (b[2 * i] << 8) | b[2 * i + 1];
+
+    int bestStart = -1, bestLength = 1;
+    for (int i = 0; i < 8; ++i)
+    {
+        int j = i;
+        while (j < 8 && groups[j] == 0)
+            ++j;
+
+        if (j - i > bestLength)
+        {
+            bestStart = i;
+            bestLength = j - i;
+        }
+
+        if (j > i)
+            i = j;
+    }
+
+    QString result;
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i == bestStart)
+        {
+            result.append("::");
+            i += bestLength - 1;
+            continue;
+        }
+
+        if (!result.isEmpty() && !result.endsWith(':'))
+            result.append(':');
+
+        result.append(QString::number(groups[i], 16));
+    }
+
+    return result;
+}
+
+bool IpAddress::isMulticast() const
+{
+    const quint8 *b = (const quint8 *)words;
+
+    // 224.0.0.0 ... 239.255.255.255, RFC3171
+    if (family == 4)
+        return b[0] >= 224 && b[0] <= 239;
+
+    // ff00::/8
+    if (family == 6)
+        return b[0] == 0xff;
+
+    return false;
+}
+
+bool IpAddress::isLinkLocal() const
+{
+    const quint8 *b = (const quint8 *)words;
+
+    // 169.254.0.0/16
+    if (family == 4)
+        return b[0] == 169 && b[1] == 254;
+
+    // fe80::/10
+    if (family == 6)
+        return b[0] == 0xfe && (b[1] & 0xc0) == 0x80;
+
+    return false;
+}
+
+bool IpAddress::samePrefix(const IpAddress &other, int bits) const
+{
+    if (family != other.family)
+        return false;
+
+    const quint8 *a = (const quint8 *)words;
+    const quint8 *b = (const quint8 *)other.words;
+
+    int bytes = bits / 8;
+    if (memcmp(a, b, bytes) != 0)
+        return false;
+
+    if (bits % 8)
+    {
+        quint8 mask = 0xff << (8 - bits % 8);
+        return (a[bytes] & mask) == (b[bytes] & mask);
+    }
+
+    return true;
+}
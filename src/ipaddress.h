@@ -0,0 +1,100 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include <QString>
+#include <QHostAddress>
+#include <QHash>
+#include <QtEndian>
+
+#include <string.h>
+
+// IPv4 or IPv6 address, stored in network byte order;
+// IPv4 uses only the first word, so compare and hash stay single word operations
+class IpAddress
+{
+public:
+    IpAddress() : family(0) { words[0] = words[1] = words[2] = words[3] = 0; }
+    explicit IpAddress(quint32 ipv4) : family(4) { words[0] = ipv4; words[1] = words[2] = words[3] = 0; }
+    explicit IpAddress(const quint8 *ipv6) : family(6) { memcpy(words, ipv6, 16); }
+    explicit IpAddress(const QHostAddress &address);
+
+    static IpAddress fromString(const QString &address);
+
+    quint8 version() const { return family; }
+    bool isNull() const { return family == 0; }
+    bool isIPv4() const { return family == 4; }
+    bool isIPv6() const { return family == 6; }
+
+    quint32 toIPv4() const { return words[0]; }
+    const quint8 *toIPv6() const { return (const quint8 *)words; }
+
+    QString toString() const;
+
+    bool isMulticast() const;
+    bool isLinkLocal() const;
+    bool samePrefix(const IpAddress &other, int bits) const;
+
+    bool operator==(const IpAddress &other) const
+    {
+        if (family == 4)
+            return other.family == 4 && words[0] == other.words[0];
+
+        return family == other.family && words[0] == other.words[0] && words[1] == other.words[1] && words[2] == other.words[2] && words[3] == other.words[3];
+    }
+
+    bool operator!=(const IpAddress &other) const { return !operator==(other); }
+
+    // any consistent order, IPv4 before IPv6
+    bool operator<(const IpAddress &other) const
+    {
+        if (family != other.family)
+            return family < other.family;
+
+        if (family == 4)
+            return words[0] < other.words[0];
+
+        return memcmp(words, other.words, 16) < 0;
+    }
+
+    friend uint qHash(const IpAddress &address);
+
+private:
+    quint32 words[4];
+    quint8 family;
+};
+
+inline uint qHash(const IpAddress &address)
+{
+    quint32 h = address.words[0];
+
+    if (address.family == 6)
+        h ^= address.words[1] * 0x9e3779b1 ^ address.words[2] * 0x85ebca6b ^ address.words[3] * 0xc2b2ae35;
+
+    // murmur3 finalizer
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+#endif // IPADDRESS_H
@@ -22,6 +22,10 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
+    // cold start, without the device selection which may wait for the user
+    QTime startupTime;
+    startupTime.start();
+
     settings = new Settings();
     settings->read();
 
@@ -37,6 +41,11 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui.setupUi(this);
 
+    device = 0;
+    deviceNetMask = 0xffffff;
+    deviceIP = 0;
+    topActiveDlg = 0;
+
     eventsViewerMainWindow = new EventsViewerMainWindow();
 
     switch (settings->getError())
@@ -66,6 +75,11 @@ MainWindow::MainWindow(QWidget *parent)
     qRegisterMetaType<quint64List>("QList<quint64>");
     qRegisterMetaType<qrealList>("QList<qreal>");
 
+    qRegisterMetaType<Packet>("Packet");
+    qRegisterMetaType<IpAddress>("IpAddress");
+
+    qRegisterMetaType<topEntryList>("QList<TopEntry>");
+
     createMenu();
     createToolbars();
     createStatusBar();
@@ -80,6 +94,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     clearVariables();
 
+    int startupElapsed = startupTime.elapsed();
+
     setDevice();
     setFilter();
 
@@ -94,7 +110,7 @@ MainWindow::MainWindow(QWidget *parent)
         settings->mainWindow.firstRun = false;
     }
 
-    eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("LANAnalyzer started"), "");
+    eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("LANAnalyzer started"), tr("Started in %1 ms").arg(startupElapsed));
 
     if (settings->mainWindow.minimizeToTrayOnStart)
         QTimer::singleShot(100, this, SLOT(minimizeToTray()));
@@ -108,6 +124,7 @@ MainWindow::~MainWindow()
     writeSettings(true);
 
     delete captureThread;
+    FilterCache::clear();
 
     if (receiverThread->isRunning())
         receiverThread->quit();
@@ -209,6 +226,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
     // Ctrl + Alt + D
     if ((modifiers & Qt::ControlModifier) && (modifiers & Qt::AltModifier) && (event->key() == Qt::Key_D))
     {
+        createMyOutputDlg();
         myOutputDlg->show();
         myOutputDlg->raise();
         myOutputDlg->activateWindow();
@@ -243,6 +261,8 @@ bool MainWindow::setLanguage(QString file)
 void MainWindow::createMenu()
 {
     // file
+    connect(ui.actionOpenSession, SIGNAL(triggered()), this, SLOT(onOpenSession()));
+    connect(ui.actionSaveSession, SIGNAL(triggered()), this, SLOT(onSaveSession()));
     connect(ui.actionExportData, SIGNAL(triggered()), this, SLOT(onExportData()));
     connect(ui.actionClose, SIGNAL(triggered()), this, SLOT(close()));
     connect(ui.actionQuit, SIGNAL(triggered()), qApp, SLOT(quit()));
@@ -543,6 +563,8 @@ void MainWindow::createStatusBar()
     ui.statusbar->addPermanentWidget(infoLabel = new QLabel(this), 1);
     ui.statusbar->addPermanentWidget(deviceLabel = new QLabel(this), 1);
     ui.statusbar->addPermanentWidget(filterLabel = new QLabel(this), 1);
+    ui.statusbar->addPermanentWidget(samplingLabel = new QLabel(this));
+    ui.statusbar->addPermanentWidget(memoryLabel = new QLabel(this));
     ui.statusbar->addPermanentWidget(clockLabel = new QLabel(this));
 }
 
@@ -668,6 +690,9 @@ void MainWindow::createConnections()
 
     connect(ui.treeWidgetApp, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(onApplicationsContextMenu(QPoint)));
     connect(ui.treeWidgetHosts, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(onHostsContextMenu(QPoint)));
+
+    ui.treeWidgetTransfer->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui.treeWidgetTransfer, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(onUsersContextMenu(QPoint)));
 }
 
 //=====================================================================================================================================================================================================
@@ -720,10 +745,14 @@ void MainWindow::createObjects()
     connect(captureThread, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)));
     connect(captureThread, SIGNAL(breakThread()), this, SLOT(stopCapture()));
 
-    packetsMainWindow = new PacketsMainWindow(0, captureThread);
+    // read on the first lookup, shared with the receiver core and reloaded when the file changes
+    portDatabase = new PortDatabase(this, QCoreApplication::applicationDirPath() + "/ports.txt");
+    connect(portDatabase, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)), Qt::QueuedConnection);
+    connect(portDatabase, SIGNAL(logMessage(quint8,QString,QString)), this, SLOT(logMessage(quint8,QString,QString)), Qt::QueuedConnection);
 
     receiverThread = new QThread(this);
     receiverCore = new ReceiverCore(0, captureThread);
+    receiverCore->setPortDatabase(portDatabase);
     receiverCore->moveToThread(receiverThread);
 
     connect(receiverCore, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)), Qt::QueuedConnection);
@@ -733,6 +762,8 @@ void MainWindow::createObjects()
 
     connect(receiverCore, SIGNAL(signalUsersTransfer(QList<quint64>,QList<quint64>)), this, SLOT(usersTransfer(QList<quint64>,QList<quint64>)), Qt::QueuedConnection);
     connect(receiverCore, SIGNAL(signalUsersSpeed(QList<qreal>,QList<qreal>)), this, SLOT(usersSpeed(QList<qreal>,QList<qreal>)), Qt::QueuedConnection);
+    connect(receiverCore, SIGNAL(signalUsersPeers(QList<quint32>)), this, SLOT(usersPeers(QList<quint32>)), Qt::QueuedConnection);
+    connect(receiverCore, SIGNAL(signalMemory(quint64,quint64,quint64,quint64)), this, SLOT(memoryUsed(quint64,quint64,quint64,quint64)), Qt::QueuedConnection);
 
     connect(receiverCore, SIGNAL(signalNetTransfer(quint64,quint64)), this, SLOT(netTransfer(quint64,quint64)), Qt::QueuedConnection);
 
@@ -747,15 +778,59 @@ void MainWindow::createObjects()
     connect(receiverCore, SIGNAL(signalUsersApps(QList<Apps>)), this, SLOT(updateUsersApps(QList<Apps>)), Qt::QueuedConnection);
     connect(receiverCore, SIGNAL(signalUsersHosts(QList<Hosts>)), this, SLOT(updateUsersHosts(QList<Hosts>)), Qt::QueuedConnection);
 
-    myOutputDlg = new MyOutputDialog(this, receiverCore);
+    connect(this, SIGNAL(requestTopActive(quint8,quint8,bool,int)), receiverCore, SLOT(setTopActive(quint8,quint8,bool,int)), Qt::QueuedConnection);
+    connect(this, SIGNAL(requestSaveSession(QString)), receiverCore, SLOT(saveSession(QString)), Qt::QueuedConnection);
+    connect(receiverCore, SIGNAL(signalTopActive(quint8,quint8,bool,quint64,QList<TopEntry>)), this, SLOT(topActive(quint8,quint8,bool,quint64,QList<TopEntry>)), Qt::QueuedConnection);
+
+    // views are built on first show, see create*Dlg()
+    myOutputDlg = 0;
+    netPacketsDlg = 0;
+    netTransferDlg = 0;
+    netPacketsGraphDlg = 0;
+    netTransferGraphDlg = 0;
+    userTransfersGraphDlg = 0;
+    packetsMainWindow = 0;
+
+    dataExporter = new DataExporter(this);
+    exportProgressDlg = 0;
+    connect(dataExporter, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)), Qt::QueuedConnection);
+    connect(dataExporter, SIGNAL(progress(int,int)), this, SLOT(exportProgress(int,int)), Qt::QueuedConnection);
+    connect(dataExporter, SIGNAL(exported(QString)), this, SLOT(dataExported(QString)), Qt::QueuedConnection);
+
+    metricsServer = new MetricsServer(this);
+    connect(metricsServer, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)));
+    connect(receiverCore, SIGNAL(signalMetrics(QByteArray)), metricsServer, SLOT(setExposition(QByteArray)), Qt::QueuedConnection);
+
+    receiverCore->setMetrics(settings->metrics.enabled, settings->metrics.maxUsers, settings->metrics.maxHosts);
+    captureThread->setFragments(settings->captureThread.fragmentsCapacity, settings->captureThread.fragmentsTimeout);
+    captureThread->setSampling(settings->sampling.mode, settings->sampling.rate);
+    captureThread->setNameDiscovery(settings->resolver.passive);
+    receiverCore->setSampling(settings->sampling.mode, settings->sampling.rate);
+    receiverCore->setTopCapacity(settings->topActive.capacity);
+    receiverCore->setHosts(settings->hosts.lowMemory, settings->hosts.maxHosts, settings->hosts.precision);
+    receiverCore->setMemoryBudget((quint64)settings->memory.budget * 1024 * 1024);
+    receiverCore->setResolver(settings->resolver.lookups, settings->resolver.maxRunning, settings->resolver.cacheSize, settings->resolver.ttl, settings->resolver.negativeTtl, settings->resolver.hostsFile);
+    receiverCore->setFlows(settings->flows.capacity, settings->flows.idleTimeout, settings->flows.activeTimeout);
+    receiverCore->setFlowExport(settings->flowExport.enabled, settings->flowExport.version, settings->flowExport.collector, settings->flowExport.port, settings->flowExport.domain, settings->flowExport.templateRefresh);
+    receiverCore->setCheckpoint(settings->checkpoint.enabled, settings->checkpoint.interval, settings->checkpoint.maxRows, (qint64)settings->checkpoint.compactSize * 1024 * 1024, settings->checkpoint.fileName);
+
+    // counters are scaled estimates while sampling
+    if (settings->sampling.mode != SAMPLING_OFF && settings->sampling.rate > 1)
+    {
+        QString sampling = settings->sampling.mode == SAMPLING_FLOW ? tr("Sampling 1/%1 flows (estimated)") : tr("Sampling 1/%1 packets (estimated)");
+        samplingLabel->setText(sampling.arg(settings->sampling.rate));
+        eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("Sampling enabled"), tr("Statistics are estimated from 1 in %1 %2").arg(settings->sampling.rate).arg(settings->sampling.mode == SAMPLING_FLOW ? tr("flows") : tr("packets")));
+    }
+    else
+    {
+        samplingLabel->hide();
+    }
 
-    netPacketsDlg = new NetPacketsDialog(this, receiverCore);
-    netTransferDlg = new NetTransferDialog(this, receiverCore);
-    netTransferDlg->setScale(settings->netTransferDialog.up, settings->netTransferDialog.down);
+    if (settings->hosts.lowMemory)
+        eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("Low memory mode"), tr("Only the first %1 hosts of a user are listed, all hosts are counted").arg(settings->hosts.maxHosts));
 
-    netPacketsGraphDlg = new NetPacketsGraphDialog(0, receiverCore);
-    netTransferGraphDlg = new NetTransferGraphDialog(0,receiverCore);
-    userTransfersGraphDlg = new UserTransfersGraphDialog(0, receiverCore);
+    if (settings->metrics.enabled && metricsServer->start(settings->metrics.address, settings->metrics.port))
+        eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("Metrics server started"), tr("Listening on %1:%2").arg(settings->metrics.address).arg(settings->metrics.port));
 
     ui.treeWidgetPackets->setHeaderHidden(false);
     ui.treeWidgetTransfer->setHeaderHidden(false);
@@ -772,6 +847,74 @@ void MainWindow::createObjects()
 
 //=====================================================================================================================================================================================================
 
+// attached to the receiver core when created, they show the data from then on
+
+void MainWindow::createMyOutputDlg()
+{
+    if (!myOutputDlg)
+        myOutputDlg = new MyOutputDialog(this, receiverCore);
+}
+
+void MainWindow::createNetPacketsDlg()
+{
+    if (!netPacketsDlg)
+        netPacketsDlg = new NetPacketsDialog(this, receiverCore);
+}
+
+void MainWindow::createNetTransferDlg()
+{
+    if (netTransferDlg)
+        return;
+
+    netTransferDlg = new NetTransferDialog(this, receiverCore);
+    netTransferDlg->setScale(settings->netTransferDialog.up, settings->netTransferDialog.down);
+}
+
+void MainWindow::createNetPacketsGraphDlg()
+{
+    if (netPacketsGraphDlg)
+        return;
+
+    netPacketsGraphDlg = new NetPacketsGraphDialog(0, receiverCore);
+    if (capturing)
+        netPacketsGraphDlg->startGraph();
+}
+
+void MainWindow::createNetTransferGraphDlg()
+{
+    if (netTransferGraphDlg)
+        return;
+
+    netTransferGraphDlg = new NetTransferGraphDialog(0, receiverCore);
+    if (capturing)
+        netTransferGraphDlg->startGraph();
+}
+
+void MainWindow::createUserTransfersGraphDlg()
+{
+    if (userTransfersGraphDlg)
+        return;
+
+    userTransfersGraphDlg = new UserTransfersGraphDialog(0, receiverCore);
+    if (capturing)
+        userTransfersGraphDlg->startGraph();
+
+    // the users known so far, the next ones come through newUser()
+    for (int i = 0; i < usersList.count(); ++i)
+        userTransfersGraphDlg->newUser(usersList.at(i), usersTimeOn.at(i));
+}
+
+void MainWindow::createPacketsMainWindow()
+{
+    if (packetsMainWindow)
+        return;
+
+    packetsMainWindow = new PacketsMainWindow(0, captureThread);
+    packetsMainWindow->setData(deviceNetMask, deviceIP, deviceIPv6);
+}
+
+//=====================================================================================================================================================================================================
+
 void MainWindow::clearVariables()
 {
     ui.treeWidgetUsers->clear();
@@ -784,6 +927,12 @@ void MainWindow::clearVariables()
 
     usersList.clear();
     usersName.clear();
+    usersTimeOn.clear();
+
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 8; ++j)
+            usersPackets[i][j].clear();
+    usersPeersCount.clear();
 
     usersUp.clear();
     usersDown.clear();
@@ -792,6 +941,8 @@ void MainWindow::clearVariables()
 
     usersHosts.clear();
     usersApps.clear();
+    hostsViewFolds = 0;
+    appsViewFolds = 0;
 
     netUpTotal = 0;
     netDownTotal = 0;
@@ -813,10 +964,12 @@ void MainWindow::setDevice()
             settings->mainWindow.deviceName = device->name;
 
             quint32 netMask = 0xffffff, pcIP = 0;
+            QList<IpAddress> localIPv6;
+            bool ipv4 = false;
             pcap_addr_t *a;
             for (a = device->addresses; a; a = a->next)
             {
-                if (a->addr->sa_family == AF_INET)
+                if (a->addr->sa_family == AF_INET && !ipv4)
                 {
                     if (a->addr)
                         pcIP = ((struct sockaddr_in *)a->addr)->sin_addr.s_addr;
@@ -825,10 +978,20 @@ void MainWindow::setDevice()
 
                     netMask = ((struct sockaddr_in *)a->netmask)->sin_addr.s_addr;
 
-                    break;
+                    ipv4 = true;
+                }
+                else if (a->addr->sa_family == AF_INET6)
+                {
+                    localIPv6.append(IpAddress((const quint8 *)&((struct sockaddr_in6 *)a->addr)->sin6_addr));
                 }
             }
-            receiverCore->setData(netMask, pcIP);
+            receiverCore->setData(netMask, pcIP, localIPv6);
+
+            deviceNetMask = netMask;
+            deviceIP = pcIP;
+            deviceIPv6 = localIPv6;
+            if (packetsMainWindow)
+                packetsMainWindow->setData(netMask, pcIP, localIPv6);
 
             ui.actionStartNow->setEnabled(true);
             startNowAct->setEnabled(true);
@@ -871,10 +1034,12 @@ void MainWindow::showSelectDeviceDlg()
                 settings->mainWindow.deviceName = device->name;
 
                 quint32 netMask = 0xffffff, pcIP = 0;
+                QList<IpAddress> localIPv6;
+                bool ipv4 = false;
                 pcap_addr_t *a;
                 for (a = device->addresses; a; a = a->next)
                 {
-                    if (a->addr->sa_family == AF_INET)
+                    if (a->addr->sa_family == AF_INET && !ipv4)
                     {
                         if (a->addr)
                             pcIP = ((struct sockaddr_in *)a->addr)->sin_addr.s_addr;
@@ -883,10 +1048,20 @@ void MainWindow::showSelectDeviceDlg()
 
                         netMask = ((struct sockaddr_in *)a->netmask)->sin_addr.s_addr;
 
-                        break;
+                        ipv4 = true;
+                    }
+                    else if (a->addr->sa_family == AF_INET6)
+                    {
+                        localIPv6.append(IpAddress((const quint8 *)&((struct sockaddr_in6 *)a->addr)->sin6_addr));
                     }
                 }
-                receiverCore->setData(netMask, pcIP);
+                receiverCore->setData(netMask, pcIP, localIPv6);
+
+                deviceNetMask = netMask;
+                deviceIP = pcIP;
+                deviceIPv6 = localIPv6;
+                if (packetsMainWindow)
+                    packetsMainWindow->setData(netMask, pcIP, localIPv6);
 
                 ui.actionStartNow->setEnabled(true);
                 startNowAct->setEnabled(true);
@@ -926,6 +1101,8 @@ void MainWindow::showSelectFilterDlg()
 
     connect(&dlg, SIGNAL(infoMessage(quint8,QString,QString)), this, SLOT(infoMessage(quint8,QString,QString)));
 
+    // compiled as at the capture start, so the programs are reused there
+    dlg.setCompileOptions(settings->captureThread.bytes, device ? FilterCache::netmask(device) : 0xffffff);
     dlg.prepareDialog();
 
     if (dlg.exec())
@@ -1047,18 +1224,25 @@ void MainWindow::startCapture()
 
     if (captureThread->startCapture(device, settings->captureThread.mode, settings->captureThread.bytes, settings->captureThread.timeout, settings->mainWindow.filterCode, packetsLimit))
     {
-        myOutputDlg->clear();
+        // only the dialogs shown so far
+        if (myOutputDlg)
+            myOutputDlg->clear();
 
-        netPacketsGraphDlg->startGraph();
-        netTransferGraphDlg->startGraph();
-        userTransfersGraphDlg->startGraph();
+        if (netPacketsGraphDlg)
+            netPacketsGraphDlg->startGraph();
+        if (netTransferGraphDlg)
+            netTransferGraphDlg->startGraph();
+        if (userTransfersGraphDlg)
+            userTransfersGraphDlg->startGraph();
 
         clearVariables();
 
-        packetsMainWindow->clearTree();
+        if (packetsMainWindow)
+            packetsMainWindow->clearTree();
 
         // reset scale and data
-        netTransferDlg->setScale(settings->netTransferDialog.up, settings->netTransferDialog.down);
+        if (netTransferDlg)
+            netTransferDlg->setScale(settings->netTransferDialog.up, settings->netTransferDialog.down);
 
         trayIconMovie->start();
         trayIcon->setToolTip(tr("LANAnalyzer\nCapturing packets..."));
@@ -1078,6 +1262,8 @@ void MainWindow::startCapture()
         ui.actionStopCountdown->setDisabled(true);
         stopCountdownAct->setDisabled(true);
 
+        ui.actionSaveSession->setEnabled(true);
+
         capturing = true;
 
         if (captureData.durationChoice == 3)
@@ -1136,9 +1322,12 @@ void MainWindow::stopCapture()
 {
     if (captureThread->stopCapture())
     {
-        netPacketsGraphDlg->stopGraph();
-        netTransferGraphDlg->stopGraph();
-        userTransfersGraphDlg->stopGraph();
+        if (netPacketsGraphDlg)
+            netPacketsGraphDlg->stopGraph();
+        if (netTransferGraphDlg)
+            netTransferGraphDlg->stopGraph();
+        if (userTransfersGraphDlg)
+            userTransfersGraphDlg->stopGraph();
 
         trayIconMovie->stop();
         trayIcon->setIcon(QIcon(":/images/lananalyzer.png"));
@@ -1191,6 +1380,7 @@ void MainWindow::newUser(const QString &user, const QString &timeOn)
 {
     usersList.append(user);
     usersName.append("");
+    usersTimeOn.append(timeOn);
 
     Hosts host;
     usersHosts.append(host);
@@ -1198,6 +1388,9 @@ void MainWindow::newUser(const QString &user, const QString &timeOn)
     Apps app;
     usersApps.append(app);
 
+    if (userTransfersGraphDlg)
+        userTransfersGraphDlg->newUser(user, timeOn);
+
     ui.treeWidgetUsers->addTopLevelItem(new QTreeWidgetItem(QStringList() << user << "" << timeOn));
     ui.treeWidgetUsers->topLevelItem(ui.treeWidgetUsers->topLevelItemCount()-1)->setIcon(0, QIcon(":/images/o_user.png"));
 
@@ -1253,11 +1446,32 @@ void MainWindow::usersSpeed(QList<qreal> usersUpSpeed, QList<qreal> usersDownSpe
 {
     for (int i = 0; i < ui.treeWidgetTransfer->topLevelItemCount(); ++i)
     {
-        ui.treeWidgetTransfer->topLevelItem(i)->setText(4, QString("%1 KB/s").arg(usersUpSpeed.at(i), 0, 'f', 2));
-        ui.treeWidgetTransfer->topLevelItem(i)->setText(5, QString("%1 KB/s").arg(usersDownSpeed.at(i), 0, 'f', 2));
+        ui.treeWidgetTransfer->topLevelItem(i)->setText(5, QString("%1 KB/s").arg(usersUpSpeed.at(i), 0, 'f', 2));
+        ui.treeWidgetTransfer->topLevelItem(i)->setText(6, QString("%1 KB/s").arg(usersDownSpeed.at(i), 0, 'f', 2));
     }
 }
 
+void MainWindow::memoryUsed(quint64 hosts, quint64 apps, quint64 estimators, quint64 budget)
+{
+    quint64 used = hosts + apps + estimators;
+
+    if (budget)
+        memoryLabel->setText(tr("Memory: %1 / %2").arg(bytesToStr(used)).arg(bytesToStr(budget)));
+    else
+        memoryLabel->setText(tr("Memory: %1").arg(bytesToStr(used)));
+
+    memoryLabel->setToolTip(tr("Hosts: %1\nApplications: %2\nHost counters: %3").arg(bytesToStr(hosts)).arg(bytesToStr(apps)).arg(bytesToStr(estimators)));
+}
+
+// estimated distinct remote hosts
+void MainWindow::usersPeers(QList<quint32> usersPeers)
+{
+    usersPeersCount = usersPeers;
+
+    for (int i = 0; i < ui.treeWidgetTransfer->topLevelItemCount() && i < usersPeers.count(); ++i)
+        ui.treeWidgetTransfer->topLevelItem(i)->setText(4, usersPeers.at(i) < 100 ? QString::number(usersPeers.at(i)) : QString("~%1").arg(usersPeers.at(i)));
+}
+
 void MainWindow::netTransfer(quint64 up, quint64 down)
 {
     netUpTotal = up;
@@ -1266,6 +1480,15 @@ void MainWindow::netTransfer(quint64 up, quint64 down)
 
 void MainWindow::netAllPackets(QList<quint32> userArp, QList<quint32> userRarp, QList<quint32> userIcmp, QList<quint32> userIgmp, QList<quint32> userTcp, QList<quint32> userUdp, QList<quint32> userOther, QList<quint32> userTotal)
 {
+    usersPackets[EXPORT_ALL][0] = userArp;
+    usersPackets[EXPORT_ALL][1] = userRarp;
+    usersPackets[EXPORT_ALL][2] = userIcmp;
+    usersPackets[EXPORT_ALL][3] = userIgmp;
+    usersPackets[EXPORT_ALL][4] = userTcp;
+    usersPackets[EXPORT_ALL][5] = userUdp;
+    usersPackets[EXPORT_ALL][6] = userOther;
+    usersPackets[EXPORT_ALL][7] = userTotal;
+
     for (int i = 0; i < userTotal.count(); ++i)
     {
         ui.treeWidgetPackets->topLevelItem(i)->setText(4, QString::number(userArp.at(i)));
@@ -1281,6 +1504,15 @@ void MainWindow::netAllPackets(QList<quint32> userArp, QList<quint32> userRarp,
 
 void MainWindow::netInPackets(QList<quint32> userArpIn, QList<quint32> userRarpIn, QList<quint32> userIcmpIn, QList<quint32> userIgmpIn, QList<quint32> userTcpIn, QList<quint32> userUdpIn, QList<quint32> userOtherIn, QList<quint32> userTotalIn)
 {
+    usersPackets[EXPORT_IN][0] = userArpIn;
+    usersPackets[EXPORT_IN][1] = userRarpIn;
+    usersPackets[EXPORT_IN][2] = userIcmpIn;
+    usersPackets[EXPORT_IN][3] = userIgmpIn;
+    usersPackets[EXPORT_IN][4] = userTcpIn;
+    usersPackets[EXPORT_IN][5] = userUdpIn;
+    usersPackets[EXPORT_IN][6] = userOtherIn;
+    usersPackets[EXPORT_IN][7] = userTotalIn;
+
     for (int i = 0; i < userTotalIn.count(); ++i)
     {
         ui.treeWidgetPackets->topLevelItem(i)->setText(2, QString::number(userArpIn.at(i)));
@@ -1296,6 +1528,15 @@ void MainWindow::netInPackets(QList<quint32> userArpIn, QList<quint32> userRarpI
 
 void MainWindow::netOutPackets(QList<quint32> userArpOut, QList<quint32> userRarpOut, QList<quint32> userIcmpOut, QList<quint32> userIgmpOut, QList<quint32> userTcpOut, QList<quint32> userUdpOut, QList<quint32> userOtherOut, QList<quint32> userTotalOut)
 {
+    usersPackets[EXPORT_OUT][0] = userArpOut;
+    usersPackets[EXPORT_OUT][1] = userRarpOut;
+    usersPackets[EXPORT_OUT][2] = userIcmpOut;
+    usersPackets[EXPORT_OUT][3] = userIgmpOut;
+    usersPackets[EXPORT_OUT][4] = userTcpOut;
+    usersPackets[EXPORT_OUT][5] = userUdpOut;
+    usersPackets[EXPORT_OUT][6] = userOtherOut;
+    usersPackets[EXPORT_OUT][7] = userTotalOut;
+
     for (int i = 0; i < userTotalOut.count(); ++i)
     {
         ui.treeWidgetPackets->topLevelItem(i)->setText(3, QString::number(userArpOut.at(i)));
@@ -1317,6 +1558,13 @@ void MainWindow::newUserApp(quint16 user, Apps app)
     {
         int i = app.hostPort.count() - 1;
 
+        // rows were evicted since the view was filled
+        if (app.folds != appsViewFolds || ui.treeWidgetApp->topLevelItemCount() != i)
+        {
+            onUsersAppsChanged();
+            return;
+        }
+
         ui.treeWidgetApp->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetApp, QStringList() << app.hostPort.at(i) << app.hostPortName.at(i) << bytesToStr(app.upBytes.at(i)) << bytesToStr(app.downBytes.at(i))));
     }
 }
@@ -1328,26 +1576,35 @@ void MainWindow::newUserHost(quint16 user, Hosts host)
     if (ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem()) == user)
     {
         int i = host.hostIp.count() - 1;
-        addr.S_un.S_addr = host.hostIp.at(i);
 
-        ui.treeWidgetHosts->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetHosts, QStringList() << inet_ntoa(addr) << host.hostName.at(i) << host.dPort.at(i) << host.dApp.at(i) << bytesToStr(host.upBytes.at(i)) << bytesToStr(host.downBytes.at(i)) << host.firstVisit.at(i) << host.lastVisit.at(i)));
+        // rows were evicted since the view was filled
+        if (host.folds != hostsViewFolds || ui.treeWidgetHosts->topLevelItemCount() != i)
+        {
+            onUsersHostsChanged();
+            return;
+        }
+
+        ui.treeWidgetHosts->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetHosts, QStringList() << host.hostIp.at(i).toString() << host.hostName.at(i) << host.dPort.at(i) << host.dApp.at(i) << bytesToStr(host.upBytes.at(i)) << bytesToStr(host.downBytes.at(i)) << timeToStr(host.firstVisit.at(i)) << timeToStr(host.lastVisit.at(i))));
     }
 }
 
+// the other users' rows get the name with the next usersHosts update
 void MainWindow::newHostName(const QString &hostAddress, const QString &hostName)
 {
-    for (int i = 0; i < usersHosts.count(); ++i)
-        for (int j = 0; j < usersHosts.at(i).hostIp.count(); ++j)
-            {
-                addr.S_un.S_addr = usersHosts.at(i).hostIp.at(j);
-                if (inet_ntoa(addr) == hostAddress)
-                    usersHosts[i].hostName[j] = hostName;
-            }
-
     int user = ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem());
+    if (user < 0)
+        return;
+
+    for (int i = 0; i < ui.treeWidgetHosts->topLevelItemCount() && i < usersHosts.at(user).hostName.count(); ++i)
+    {
+        QTreeWidgetItem *item = ui.treeWidgetHosts->topLevelItem(i);
 
-    for (int i = 0; i < ui.treeWidgetHosts->topLevelItemCount(); ++i)
-        ui.treeWidgetHosts->topLevelItem(i)->setText(1, usersHosts.at(user).hostName.at(i));
+        if (item->text(0) == hostAddress)
+        {
+            usersHosts[user].hostName[i] = hostName;
+            item->setText(1, hostName);
+        }
+    }
 }
 
 void MainWindow::updateUsersApps(QList<Apps> usersApps)
@@ -1356,7 +1613,10 @@ void MainWindow::updateUsersApps(QList<Apps> usersApps)
 
     int user = ui.treeWidgetUsersApp->indexOfTopLevelItem(ui.treeWidgetUsersApp->currentItem());
 
-    if (user > -1)
+    // rows were evicted and moved, or the view missed new ones, it is filled again
+    if (user > -1 && (usersApps.at(user).folds != appsViewFolds || ui.treeWidgetApp->topLevelItemCount() != usersApps.at(user).hostPort.count()))
+        onUsersAppsChanged();
+    else if (user > -1)
     {
         for (int i = 0; i < ui.treeWidgetApp->topLevelItemCount(); ++i)
         {
@@ -1364,6 +1624,9 @@ void MainWindow::updateUsersApps(QList<Apps> usersApps)
             ui.treeWidgetApp->topLevelItem(i)->setText(3, bytesToStr(usersApps.at(user).downBytes.at(i)));
         }
     }
+
+    if (topActiveDlg && topActiveKind != TOP_HOSTS)
+        updateTopActiveDlg();
 }
 
 void MainWindow::updateUsersHosts(QList<Hosts> usersHosts)
@@ -1372,19 +1635,42 @@ void MainWindow::updateUsersHosts(QList<Hosts> usersHosts)
 
     int user = ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem());
 
-    if (user > -1)
+    // rows were evicted and moved, or the view missed new ones, it is filled again
+    if (user > -1 && (usersHosts.at(user).folds != hostsViewFolds || ui.treeWidgetHosts->topLevelItemCount() != usersHosts.at(user).hostIp.count()))
+        onUsersHostsChanged();
+    else if (user > -1)
     {
         for (int i = 0; i < ui.treeWidgetHosts->topLevelItemCount(); ++i)
         {
             ui.treeWidgetHosts->topLevelItem(i)->setText(4, bytesToStr(usersHosts.at(user).upBytes.at(i)));
             ui.treeWidgetHosts->topLevelItem(i)->setText(5, bytesToStr(usersHosts.at(user).downBytes.at(i)));
-            ui.treeWidgetHosts->topLevelItem(i)->setText(7, usersHosts.at(user).lastVisit.at(i));
+            ui.treeWidgetHosts->topLevelItem(i)->setText(7, timeToStr(usersHosts.at(user).lastVisit.at(i)));
         }
     }
+
+    if (topActiveDlg && topActiveKind == TOP_HOSTS)
+        updateTopActiveDlg();
 }
 
 //=====================================================================================================================================================================================================
 
+// seconds since the epoch, in local time
+QString MainWindow::timeToStr(quint64 seconds)
+{
+    return QDateTime::fromTime_t((uint)seconds).toString("yyyy-MM-dd hh:mm:ss");
+}
+
+// texts of the first columns of the header
+QStringList MainWindow::headerLabels(QTreeWidget *treeWidget, int columns)
+{
+    QStringList labels;
+
+    for (int i = 0; i < columns; ++i)
+        labels << treeWidget->headerItem()->text(i);
+
+    return labels;
+}
+
 QString MainWindow::bytesToStr(quint64 bytes)
 {
     if (bytes < 1024) return QString("%1 B").arg(bytes);
@@ -1434,11 +1720,15 @@ void MainWindow::writeSettings(bool writeFile)
     settings->mainWindow.splitterHosts = ui.splitterHosts->saveState();
 
     eventsViewerMainWindow->writeSettings();
-    packetsMainWindow->writeSettings();
+    if (packetsMainWindow)
+        packetsMainWindow->writeSettings();
 
-    netTransferGraphDlg->writeSettings();
-    netPacketsGraphDlg->writeSettings();
-    userTransfersGraphDlg->writeSettings();
+    if (netTransferGraphDlg)
+        netTransferGraphDlg->writeSettings();
+    if (netPacketsGraphDlg)
+        netPacketsGraphDlg->writeSettings();
+    if (userTransfersGraphDlg)
+        userTransfersGraphDlg->writeSettings();
 
     if (writeFile)
     {
@@ -1459,28 +1749,36 @@ void MainWindow::writeSettings(bool writeFile)
 
 void MainWindow::infoMessage(quint8 type, const QString &title, const QString &message)
 {
+    // repeated messages are only counted by the events viewer, without a message box
     if (type == 1)
     {
-        QMessageBox::information(this, tr("Information"), title + ":\n" + message);
-        eventsViewerMainWindow->addEvent(EVENT_INFORMATION, title, message);
+        if (eventsViewerMainWindow->addEvent(EVENT_INFORMATION, title, message))
+            QMessageBox::information(this, tr("Information"), title + ":\n" + message);
         return;
     }
 
     if (type == 2)
     {
-        QMessageBox::warning(this, tr("Warning"), title + ":\n" + message);
-        eventsViewerMainWindow->addEvent(EVENT_WARNING, title, message);
+        if (eventsViewerMainWindow->addEvent(EVENT_WARNING, title, message))
+            QMessageBox::warning(this, tr("Warning"), title + ":\n" + message);
         return;
     }
 
     if (type == 3)
     {
-        QMessageBox::critical(this, tr("Critical"), title + ":\n" + message);
-        eventsViewerMainWindow->addEvent(EVENT_CRITICAL, title, message);
+        if (eventsViewerMainWindow->addEvent(EVENT_CRITICAL, title, message))
+            QMessageBox::critical(this, tr("Critical"), title + ":\n" + message);
         return;
     }
 }
 
+// the same types as infoMessage(), only added to the events viewer
+void MainWindow::logMessage(quint8 type, const QString &title, const QString &message)
+{
+    if (type >= 1 && type <= 3)
+        eventsViewerMainWindow->addEvent(type - 1, title, message);
+}
+
 //=====================================================================================================================================================================================================
 
 void MainWindow::onUsersAppsChanged()
@@ -1490,6 +1788,7 @@ void MainWindow::onUsersAppsChanged()
     if (user >= 0)
     {
         ui.treeWidgetApp->clear();
+        appsViewFolds = usersApps.at(user).folds;
 
         for (int i = 0; i < usersApps.at(user).hostPort.count(); ++i)
         {
@@ -1505,11 +1804,11 @@ void MainWindow::onUsersHostsChanged()
     if (user >= 0)
     {
         ui.treeWidgetHosts->clear();
+        hostsViewFolds = usersHosts.at(user).folds;
 
         for (int i = 0; i < usersHosts.at(user).hostIp.count(); ++i)
         {
-            addr.S_un.S_addr = usersHosts.at(user).hostIp.at(i);
-            ui.treeWidgetHosts->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetHosts, QStringList() << inet_ntoa(addr) << usersHosts.at(user).hostName.at(i) << usersHosts.at(user).dPort.at(i) << usersHosts.at(user).dApp.at(i) << bytesToStr(usersHosts.at(user).upBytes.at(i)) << bytesToStr(usersHosts.at(user).downBytes.at(i)) << usersHosts.at(user).firstVisit.at(i) << usersHosts.at(user).lastVisit.at(i)));
+            ui.treeWidgetHosts->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetHosts, QStringList() << usersHosts.at(user).hostIp.at(i).toString() << usersHosts.at(user).hostName.at(i) << usersHosts.at(user).dPort.at(i) << usersHosts.at(user).dApp.at(i) << bytesToStr(usersHosts.at(user).upBytes.at(i)) << bytesToStr(usersHosts.at(user).downBytes.at(i)) << timeToStr(usersHosts.at(user).firstVisit.at(i)) << timeToStr(usersHosts.at(user).lastVisit.at(i))));
         }
     }
 }
@@ -1526,11 +1825,23 @@ void MainWindow::onApplicationsContextMenu(const QPoint &pos)
     QMenu menu(tr("Context menu"), this);
     menu.addAction(upAct);
     menu.addAction(downAct);
+    menu.addSeparator();
+    QAction *packetsAct = menu.addAction(QIcon(":/images/16_packet.png"), tr("Packets of the user on selected port"));
+
+    // the other ports row stands for many ports
+    bool port;
+    item->text(0).toUInt(&port);
+    packetsAct->setEnabled(port);
 
     connect(upAct, SIGNAL(triggered()), this, SLOT(showTopAppUsersUpDlg()));
     connect(downAct, SIGNAL(triggered()), this, SLOT(showTopAppUsersDownDlg()));
 
-    menu.exec(ui.treeWidgetApp->viewport()->mapToGlobal(pos));
+    if (menu.exec(ui.treeWidgetApp->viewport()->mapToGlobal(pos)) == packetsAct && ui.treeWidgetUsersApp->currentItem())
+    {
+        createPacketsMainWindow();
+        packetsMainWindow->showPackets(IpAddress::fromString(ui.treeWidgetUsersApp->currentItem()->text(0)), IpAddress(), item->text(0).toUInt());
+        showPacketsMainWindow();
+    }
 }
 
 void MainWindow::onHostsContextMenu(const QPoint &pos)
@@ -1540,14 +1851,43 @@ void MainWindow::onHostsContextMenu(const QPoint &pos)
         return;
 
     QMenu menu(tr("Context menu"), this);
-    menu.addAction(QIcon(":/images/o_globe.png"), tr("Open this host with web browser"));
+    QAction *browserAct = menu.addAction(QIcon(":/images/o_globe.png"), tr("Open this host with web browser"));
+    QAction *packetsAct = menu.addAction(QIcon(":/images/16_packet.png"), tr("Packets between the user and this host"));
+
+    // the other hosts row stands for many hosts
+    packetsAct->setDisabled(IpAddress::fromString(item->text(0)).isNull());
 
     QAction *action = menu.exec(ui.treeWidgetHosts->viewport()->mapToGlobal(pos));
 
     if (action == 0)
         return;
 
-    QDesktopServices::openUrl(QUrl("http://" + item->text(0), QUrl::TolerantMode));
+    if (action == browserAct)
+        QDesktopServices::openUrl(QUrl("http://" + item->text(0), QUrl::TolerantMode));
+
+    if (action == packetsAct && ui.treeWidgetUsersHosts->currentItem())
+    {
+        createPacketsMainWindow();
+        packetsMainWindow->showPackets(IpAddress::fromString(ui.treeWidgetUsersHosts->currentItem()->text(0)), IpAddress::fromString(item->text(0)));
+        showPacketsMainWindow();
+    }
+}
+
+void MainWindow::onUsersContextMenu(const QPoint &pos)
+{
+    QTreeWidgetItem *item = ui.treeWidgetTransfer->itemAt(pos);
+    if (!item)
+        return;
+
+    QMenu menu(tr("Context menu"), this);
+    menu.addAction(QIcon(":/images/16_packet.png"), tr("Packets of this user"));
+
+    if (menu.exec(ui.treeWidgetTransfer->viewport()->mapToGlobal(pos)) == 0)
+        return;
+
+    createPacketsMainWindow();
+    packetsMainWindow->showPackets(IpAddress::fromString(item->text(0)));
+    showPacketsMainWindow();
 }
 
 //=====================================================================================================================================================================================================
@@ -1574,108 +1914,17 @@ void MainWindow::toggleTotal(bool checked)
 
 void MainWindow::showTopActiveUpDlg()
 {
-    bool ok;
-    int max;
-    ui.treeWidgetTransfer->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetTransfer->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active users"), tr("Users:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    disconnect(receiverCore, SIGNAL(signalUsersTransfer(QList<quint64>,QList<quint64>)), this, SLOT(usersTransfer(QList<quint64>,QList<quint64>)));
-    disconnect(receiverCore, SIGNAL(signalNetTransfer(quint64,quint64)), this, SLOT(netTransfer(quint64,quint64)));
-
-    quint64 maxValue;
-    QList<qint32> topUsersList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topUsersList.append(-1);
-
-    // find top users
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetTransfer->topLevelItemCount(); ++j)
-        {
-            if (usersUp.at(j) >= maxValue)
-            {
-                if (!topUsersList.contains(j))
-                {
-                    maxValue = usersUp.at(j);
-                    topUsersList[i] = j;
-                }
-            }
-        }
-    }
-
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_up.png"));
-    dlg.setWindowTitle(tr("Top %1 active users [uploaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total uploaded on network"), bytesToStr(netUpTotal));
-
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(0) + " " + ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(1)), ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(2), usersUp.at(topUsersList.at(i)), netUpTotal);
-    }
-
-    dlg.exec();
-
-    connect(receiverCore, SIGNAL(signalUsersTransfer(QList<quint64>,QList<quint64>)), this, SLOT(usersTransfer(QList<quint64>,QList<quint64>)));
-    connect(receiverCore, SIGNAL(signalNetTransfer(quint64,quint64)), this, SLOT(netTransfer(quint64,quint64)));
+    showTopActiveDlg(TOP_USERS, TOP_UP, -1, QString());
 }
 
 void MainWindow::showTopActiveDownDlg()
 {
-    bool ok;
-    int max;
-    ui.treeWidgetTransfer->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetTransfer->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active users"), tr("Users:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    disconnect(receiverCore, SIGNAL(signalUsersTransfer(QList<quint64>,QList<quint64>)), this, SLOT(usersTransfer(QList<quint64>,QList<quint64>)));
-    disconnect(receiverCore, SIGNAL(signalNetTransfer(quint64,quint64)), this, SLOT(netTransfer(quint64,quint64)));
-
-    quint64 maxValue;
-    QList<qint32> topUsersList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topUsersList.append(-1);
-
-    // find top users
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetTransfer->topLevelItemCount(); ++j)
-        {
-            if (usersDown.at(j) >= maxValue)
-            {
-                if (!topUsersList.contains(j))
-                {
-                    maxValue = usersDown.at(j);
-                    topUsersList[i] = j;
-                }
-            }
-        }
-    }
-
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_down.png"));
-    dlg.setWindowTitle(tr("Top %1 active users [downloaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total downloaded on network"), bytesToStr(netDownTotal));
-
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(0) + " " + ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(1)), ui.treeWidgetTransfer->topLevelItem(topUsersList.at(i))->text(3), usersDown.at(topUsersList.at(i)), netDownTotal);
-    }
-
-    dlg.exec();
-
-    connect(receiverCore, SIGNAL(signalUsersTransfer(QList<quint64>,QList<quint64>)), this, SLOT(usersTransfer(QList<quint64>,QList<quint64>)));
-    connect(receiverCore, SIGNAL(signalNetTransfer(quint64,quint64)), this, SLOT(netTransfer(quint64,quint64)));
+    showTopActiveDlg(TOP_USERS, TOP_DOWN, -1, QString());
 }
 
 void MainWindow::showUsersTransferGraphDlg()
 {
+    createUserTransfersGraphDlg();
     userTransfersGraphDlg->showNormal();
     userTransfersGraphDlg->raise();
     userTransfersGraphDlg->activateWindow();
@@ -1683,356 +1932,245 @@ void MainWindow::showUsersTransferGraphDlg()
 
 //=====================================================================================================================================================================================================
 
+// applications of the selected user, of all users if none is selected
 void MainWindow::showTopAppUpDlg()
 {
-    bool ok;
-    int max;
-    ui.treeWidgetApp->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetApp->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active applications"), tr("Applications:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    quint64 maxValue;
-    QList<qint32> topAppList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topAppList.append(-1);
+    showTopActiveDlg(TOP_APPS, TOP_UP, ui.treeWidgetUsersApp->indexOfTopLevelItem(ui.treeWidgetUsersApp->currentItem()), QString());
+}
 
-    quint16 user = ui.treeWidgetUsersApp->indexOfTopLevelItem(ui.treeWidgetUsersApp->currentItem());
+void MainWindow::showTopAppDownDlg()
+{
+    showTopActiveDlg(TOP_APPS, TOP_DOWN, ui.treeWidgetUsersApp->indexOfTopLevelItem(ui.treeWidgetUsersApp->currentItem()), QString());
+}
 
-    quint64 appUpTotal = 0;
+void MainWindow::showTopAppUsersUpDlg()
+{
+    QTreeWidgetItem *item = ui.treeWidgetApp->currentItem();
+    if (!item) return;
 
-    // find top applications
-    for (int i = 0; i < ui.treeWidgetApp->topLevelItemCount(); ++i)
-    {
-        appUpTotal+=usersApps.at(user).upBytes.at(i);
-    }
+    showTopActiveDlg(TOP_USERS, TOP_UP, -1, item->text(0));
+}
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetApp->topLevelItemCount(); ++j)
-        {
-            if (usersApps.at(user).upBytes.at(j) >= maxValue)
-            {
-                if (!topAppList.contains(j))
-                {
-                    maxValue = usersApps.at(user).upBytes.at(j);
-                    topAppList[i] = j;
-                }
-            }
-        }
-    }
+void MainWindow::showTopAppUsersDownDlg()
+{
+    QTreeWidgetItem *item = ui.treeWidgetApp->currentItem();
+    if (!item) return;
 
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_up.png"));
-    dlg.setWindowTitle(tr("Top %1 active applications [uploaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total uploaded by user applications"), bytesToStr(appUpTotal));
+    showTopActiveDlg(TOP_USERS, TOP_DOWN, -1, item->text(0));
+}
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(1) + " [" + ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(0) + "]"), ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(2), usersApps.at(user).upBytes.at(topAppList.at(i)), appUpTotal);
-    }
+//=====================================================================================================================================================================================================
 
-    dlg.exec();
+// hosts of the selected user, of all users if none is selected
+void MainWindow::showTopActiveHostsUpDlg()
+{
+    showTopActiveDlg(TOP_HOSTS, TOP_UP, ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem()), QString());
 }
 
-void MainWindow::showTopAppDownDlg()
+void MainWindow::showTopActiveHostsDownDlg()
 {
-    bool ok;
-    int max;
-    ui.treeWidgetApp->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetApp->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active applications"), tr("Applications:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
+    showTopActiveDlg(TOP_HOSTS, TOP_DOWN, ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem()), QString());
+}
 
-    quint64 maxValue;
-    QList<qint32> topAppList;
+// the dialog is kept up to date while open: the top of all users comes from the
+// ReceiverCore heavy hitters, the top of one user or one port is selected here
+void MainWindow::showTopActiveDlg(quint8 kind, quint8 direction, int user, const QString &port)
+{
+    if (ui.treeWidgetTransfer->topLevelItemCount() == 0)
+        return;
 
-    for (int i = 0; i < maxTop; ++i)
-        topAppList.append(-1);
+    TopActiveDialog dlg(this);
+    dlg.setWindowIcon(QIcon(direction == TOP_UP ? ":/images/o_bars_up.png" : ":/images/o_bars_down.png"));
 
-    quint16 user = ui.treeWidgetUsersApp->indexOfTopLevelItem(ui.treeWidgetUsersApp->currentItem());
+    topActiveDlg = &dlg;
+    topActiveKind = kind;
+    topActiveDirection = direction;
+    topActiveUser = user;
+    topActivePort = port;
+    topActiveCount = 10;
+    topActiveWindow = false;
 
-    quint64 appDownTotal = 0;
+    // only the heavy hitters keep the last minute
+    bool all = (user == -1 && port.isEmpty());
 
-    // find top applications
-    for (int i = 0; i < ui.treeWidgetApp->topLevelItemCount(); ++i)
-    {
-        appDownTotal+=usersApps.at(user).downBytes.at(i);
-    }
+    dlg.setLive(topActiveCount, settings->topActive.capacity, all);
+    connect(&dlg, SIGNAL(changed(int,bool)), this, SLOT(onTopActiveChanged(int,bool)));
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetApp->topLevelItemCount(); ++j)
-        {
-            if (usersApps.at(user).downBytes.at(j) >= maxValue)
-            {
-                if (!topAppList.contains(j))
-                {
-                    maxValue = usersApps.at(user).downBytes.at(j);
-                    topAppList[i] = j;
-                }
-            }
-        }
-    }
+    updateTopActiveDlg();
 
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_down.png"));
-    dlg.setWindowTitle(tr("Top %1 active applications [downloaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total downloaded by user applications"), bytesToStr(appDownTotal));
+    dlg.exec();
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(1) + " [" + ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(0) + "]"), ui.treeWidgetApp->topLevelItem(topAppList.at(i))->text(3), usersApps.at(user).downBytes.at(topAppList.at(i)), appDownTotal);
-    }
+    topActiveDlg = 0;
 
-    dlg.exec();
+    if (all)
+        emit requestTopActive(kind, direction, false, 0);
 }
 
-void MainWindow::showTopAppUsersUpDlg()
+void MainWindow::onTopActiveChanged(int count, bool window)
 {
-    QTreeWidgetItem *item = ui.treeWidgetApp->currentItem();
-    if (!item) return;
-
-    bool ok;
-    int max;
-    ui.treeWidgetUsersApp->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetUsersApp->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active users"), tr("Users:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    quint64 maxValue;
-    QList<qint32> topUsersList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topUsersList.append(-1);
+    topActiveCount = count;
+    topActiveWindow = window;
 
-    QString port = item->text(0);
+    updateTopActiveDlg();
+}
 
-    quint64 appUpTotal = 0;
+void MainWindow::updateTopActiveDlg()
+{
+    if (!topActiveDlg)
+        return;
 
-    // find top users
-    for (int i = 0; i < ui.treeWidgetUsersApp->topLevelItemCount(); ++i)
+    // sent now and on every refresh to topActive()
+    if (topActiveUser == -1 && topActivePort.isEmpty())
     {
-        for (int j = 0; j < usersApps.at(i).hostPort.count(); ++j)
-            if (usersApps.at(i).hostPort.at(j) == port)
-                appUpTotal+=usersApps.at(i).upBytes.at(j);
+        emit requestTopActive(topActiveKind, topActiveDirection, topActiveWindow, topActiveCount);
+        return;
     }
 
-    for (int i = 0; i < maxTop; ++i)
+    bool up = (topActiveDirection == TOP_UP);
+    quint64 total = 0;
+    QVector<TopItem> items;
+
+    TopItem item;
+    item.error = 0;
+
+    if (topActiveKind == TOP_USERS)
     {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetUsersApp->topLevelItemCount(); ++j)
+        // users on the port
+        for (int i = 0; i < usersApps.count(); ++i)
         {
-            for (int k = 0; k < usersApps.at(j).hostPort.count(); ++k)
-                if (usersApps.at(j).hostPort.at(k) == port)
-                    if (usersApps.at(j).upBytes.at(k) >= maxValue)
-                    {
-                        if (!topUsersList.contains(j))
-                        {
-                            maxValue = usersApps.at(j).upBytes.at(k);
-                            topUsersList[i] = j;
-                        }
-                    }
+            int j = usersApps.at(i).hostPort.indexOf(topActivePort);
+            if (j == -1)
+                continue;
+
+            item.key = i;
+            item.count = up ? usersApps.at(i).upBytes.at(j) : usersApps.at(i).downBytes.at(j);
+            items.append(item);
+            total+=item.count;
         }
     }
-
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_up.png"));
-    dlg.setWindowTitle(tr("Top active users on port %1 [uploaded]").arg(port));
-    dlg.setFirstItem(tr("Total uploaded by users on port %1").arg(port), bytesToStr(appUpTotal));
-
-    for (int i = 0; i < maxTop; ++i)
+    else if (topActiveKind == TOP_APPS && topActiveUser < usersApps.count())
     {
-        // if user don't use the application
-        if (topUsersList.at(i) == -1)
-            continue;
+        const Apps &apps = usersApps.at(topActiveUser);
 
-        for (int j = 0; j < usersApps.at(topUsersList.at(i)).hostPort.count(); ++j)
-            if (usersApps.at(topUsersList.at(i)).hostPort.at(j) == port)
-                dlg.insertItem(i, (ui.treeWidgetUsersApp->topLevelItem(topUsersList.at(i))->text(0) + " " + ui.treeWidgetUsersApp->topLevelItem(topUsersList.at(i))->text(1)), bytesToStr(usersApps.at(topUsersList.at(i)).upBytes.at(j)), usersApps.at(topUsersList.at(i)).upBytes.at(j), appUpTotal);
+        for (int i = 0; i < apps.hostPort.count(); ++i)
+        {
+            item.key = i;
+            item.count = up ? apps.upBytes.at(i) : apps.downBytes.at(i);
+            items.append(item);
+            total+=item.count;
+        }
     }
-
-    dlg.exec();
-}
-
-void MainWindow::showTopAppUsersDownDlg()
-{
-    QTreeWidgetItem *item = ui.treeWidgetApp->currentItem();
-    if (!item) return;
-
-    bool ok;
-    int max;
-    ui.treeWidgetUsersApp->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetUsersApp->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active users"), tr("Users:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    quint64 maxValue;
-    QList<qint32> topUsersList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topUsersList.append(-1);
-
-    QString port = item->text(0);
-
-    quint64 appDownTotal = 0;
-
-    // find top users
-    for (int i = 0; i < ui.treeWidgetUsersApp->topLevelItemCount(); ++i)
+    else if (topActiveKind == TOP_HOSTS && topActiveUser < usersHosts.count())
     {
-        for (int j = 0; j < usersApps.at(i).hostPort.count(); ++j)
-            if (usersApps.at(i).hostPort.at(j) == port)
-                appDownTotal+=usersApps.at(i).downBytes.at(j);
-    }
+        const Hosts &hosts = usersHosts.at(topActiveUser);
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetUsersApp->topLevelItemCount(); ++j)
+        for (int i = 0; i < hosts.hostIp.count(); ++i)
         {
-            for (int k = 0; k < usersApps.at(j).hostPort.count(); ++k)
-                if (usersApps.at(j).hostPort.at(k) == port)
-                    if (usersApps.at(j).downBytes.at(k) >= maxValue)
-                    {
-                        if (!topUsersList.contains(j))
-                        {
-                            maxValue = usersApps.at(j).downBytes.at(k);
-                            topUsersList[i] = j;
-                        }
-                    }
+            item.key = i;
+            item.count = up ? hosts.upBytes.at(i) : hosts.downBytes.at(i);
+            items.append(item);
+            total+=item.count;
         }
     }
 
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_down.png"));
-    dlg.setWindowTitle(tr("Top active users on port %1 [downloaded]").arg(port));
-    dlg.setFirstItem(tr("Total downloaded by users on port %1").arg(port), bytesToStr(appDownTotal));
+    QList<TopItem> top = TopCounter::select(items, topActiveCount);
+    QList<TopEntry> entries;
 
-    for (int i = 0; i < maxTop; ++i)
+    for (int i = 0; i < top.count(); ++i)
     {
-        // if user don't use the application
-        if (topUsersList.at(i) == -1)
-            continue;
+        TopEntry entry;
+        entry.key = top.at(i).key;
+        entry.bytes = top.at(i).count;
+        entry.error = 0;
+
+        if (topActiveKind == TOP_APPS)
+        {
+            const Apps &apps = usersApps.at(topActiveUser);
+            entry.name = apps.hostPort.at(entry.key).isEmpty() ? apps.hostPortName.at(entry.key) : apps.hostPortName.at(entry.key) + " [" + apps.hostPort.at(entry.key) + "]";
+        }
+        else if (topActiveKind == TOP_HOSTS)
+        {
+            const Hosts &hosts = usersHosts.at(topActiveUser);
+            entry.name = hosts.hostIp.at(entry.key).isNull() ? hosts.hostName.at(entry.key) : hosts.hostName.at(entry.key) + " [" + hosts.hostIp.at(entry.key).toString() + "]";
+        }
 
-        for (int j = 0; j < usersApps.at(topUsersList.at(i)).hostPort.count(); ++j)
-            if (usersApps.at(topUsersList.at(i)).hostPort.at(j) == port)
-                dlg.insertItem(i, (ui.treeWidgetUsersApp->topLevelItem(topUsersList.at(i))->text(0) + " " + ui.treeWidgetUsersApp->topLevelItem(topUsersList.at(i))->text(1)), bytesToStr(usersApps.at(topUsersList.at(i)).downBytes.at(j)), usersApps.at(topUsersList.at(i)).downBytes.at(j), appDownTotal);
+        entries.append(entry);
     }
 
-    dlg.exec();
+    fillTopActiveDlg(total, entries);
 }
 
-//=====================================================================================================================================================================================================
-
-void MainWindow::showTopActiveHostsUpDlg()
+void MainWindow::topActive(quint8 kind, quint8 direction, bool window, quint64 total, QList<TopEntry> top)
 {
-    bool ok;
-    int max;
-    ui.treeWidgetHosts->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetHosts->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active hosts"), tr("Hosts:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
-
-    quint64 maxValue;
-    QList<qint32> topHostsList;
-
-    for (int i = 0; i < maxTop; ++i)
-        topHostsList.append(-1);
+    // answers to an earlier request are dropped
+    if (!topActiveDlg || topActiveUser != -1 || !topActivePort.isEmpty())
+        return;
 
-    quint16 user = ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem());
+    if (kind != topActiveKind || direction != topActiveDirection || window != topActiveWindow)
+        return;
 
-    quint64 hostsUpTotal = 0;
+    fillTopActiveDlg(total, top);
+}
 
-    // find top hosts
-    for (int i = 0; i < ui.treeWidgetHosts->topLevelItemCount(); ++i)
-    {
-        hostsUpTotal+=usersHosts.at(user).upBytes.at(i);
-    }
+void MainWindow::fillTopActiveDlg(quint64 total, const QList<TopEntry> &top)
+{
+    bool up = (topActiveDirection == TOP_UP);
+    QString title, first;
 
-    for (int i = 0; i < maxTop; ++i)
+    switch (topActiveKind)
     {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetHosts->topLevelItemCount(); ++j)
+    case TOP_USERS:
+        if (topActivePort.isEmpty())
         {
-            if (usersHosts.at(user).upBytes.at(j) >= maxValue)
-            {
-                if (!topHostsList.contains(j))
-                {
-                    maxValue = usersHosts.at(user).upBytes.at(j);
-                    topHostsList[i] = j;
-                }
-            }
+            title = up ? tr("Top %1 active users [uploaded]") : tr("Top %1 active users [downloaded]");
+            first = up ? tr("Total uploaded on network") : tr("Total downloaded on network");
         }
+        else
+        {
+            title = up ? tr("Top active users on port %1 [uploaded]") : tr("Top active users on port %1 [downloaded]");
+            first = up ? tr("Total uploaded by users on port %1") : tr("Total downloaded by users on port %1");
+            first = first.arg(topActivePort);
+        }
+        break;
+    case TOP_APPS:
+        title = up ? tr("Top %1 active applications [uploaded]") : tr("Top %1 active applications [downloaded]");
+        if (topActiveUser == -1)
+            first = up ? tr("Total uploaded by applications") : tr("Total downloaded by applications");
+        else
+            first = up ? tr("Total uploaded by user applications") : tr("Total downloaded by user applications");
+        break;
+    case TOP_HOSTS:
+        title = up ? tr("Top %1 active hosts [uploaded]") : tr("Top %1 active hosts [downloaded]");
+        first = up ? tr("Total uploaded to hosts") : tr("Total downloaded from hosts");
+        break;
     }
 
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_up.png"));
-    dlg.setWindowTitle(tr("Top %1 active hosts [uploaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total uploaded to hosts"), bytesToStr(hostsUpTotal));
-
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(1) + " [" + ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(0) + "]"), ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(4), usersHosts.at(user).upBytes.at(topHostsList.at(i)), hostsUpTotal);
-    }
-
-    dlg.exec();
-}
-
-void MainWindow::showTopActiveHostsDownDlg()
-{
-    bool ok;
-    int max;
-    ui.treeWidgetHosts->topLevelItemCount() > 25 ? max = 25 : max = ui.treeWidgetHosts->topLevelItemCount();
-    if (max == 0) return;
-    int maxTop = QInputDialog::getInteger(this, tr("Select number of top active hosts"), tr("Hosts:"), 10, 1, max, 1, &ok);
-    if (!ok) return;
+    title = topActivePort.isEmpty() ? title.arg(top.count()) : title.arg(topActivePort);
 
-    quint64 maxValue;
-    QList<qint32> topHostsList;
+    if (topActiveWindow)
+        title+=tr(" - last minute");
 
-    for (int i = 0; i < maxTop; ++i)
-        topHostsList.append(-1);
+    topActiveDlg->setWindowTitle(title);
+    topActiveDlg->setFirstItem(first, bytesToStr(total));
+    topActiveDlg->clearItems();
 
-    quint16 user = ui.treeWidgetUsersHosts->indexOfTopLevelItem(ui.treeWidgetUsersHosts->currentItem());
-
-    quint64 hostsDownTotal = 0;
-
-    // find top hosts
-    for (int i = 0; i < ui.treeWidgetHosts->topLevelItemCount(); ++i)
+    for (int i = 0; i < top.count(); ++i)
     {
-        hostsDownTotal+=usersHosts.at(user).downBytes.at(i);
-    }
+        const TopEntry &entry = top.at(i);
+        QString name = entry.name;
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        maxValue = 0;
-        for (int j = 0; j < ui.treeWidgetHosts->topLevelItemCount(); ++j)
+        if (topActiveKind == TOP_USERS)
         {
-            if (usersHosts.at(user).downBytes.at(j) >= maxValue)
-            {
-                if (!topHostsList.contains(j))
-                {
-                    maxValue = usersHosts.at(user).downBytes.at(j);
-                    topHostsList[i] = j;
-                }
-            }
+            QTreeWidgetItem *item = ui.treeWidgetTransfer->topLevelItem(entry.key);
+            if (item)
+                name = item->text(0) + " " + item->text(1);
         }
-    }
 
-    TopActiveDialog dlg(this);
-    dlg.setWindowIcon(QIcon(":/images/o_bars_down.png"));
-    dlg.setWindowTitle(tr("Top %1 active hosts [downloaded]").arg(maxTop));
-    dlg.setFirstItem(tr("Total downloaded from hosts"), bytesToStr(hostsDownTotal));
+        // an estimate, the count of a replaced key is included
+        QString bytes = entry.error ? "~" + bytesToStr(entry.bytes) : bytesToStr(entry.bytes);
 
-    for (int i = 0; i < maxTop; ++i)
-    {
-        dlg.insertItem(i, (ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(1) + " [" + ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(0) + "]"), ui.treeWidgetHosts->topLevelItem(topHostsList.at(i))->text(5), usersHosts.at(user).downBytes.at(topHostsList.at(i)), hostsDownTotal);
+        topActiveDlg->insertItem(i, name, bytes, entry.bytes, total);
     }
-
-    dlg.exec();
 }
 
 void MainWindow::onHostsOpen()
@@ -2048,417 +2186,192 @@ void MainWindow::onHostsOpen()
 
 void MainWindow::onExportData()
 {
+    // one export at a time
+    if (dataExporter->isRunning())
+        return;
+
     ExportDataDialog dlg(this);
 
     if (dlg.exec())
     {
-        QString dateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh.mm.ss_");
-        QString folder = settings->exportDataDialog.folder;
+        ExportJob job;
+
+        job.folder = settings->exportDataDialog.folder;
+        job.prefix = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh.mm.ss_");
 
-        QString field;
         if (settings->exportDataDialog.fields == 0)
-            field = ",";
+            job.field = ",";
         else
-            field = ";";
+            job.field = ";";
 
-        QString line;
         switch (settings->exportDataDialog.lines)
         {
-            case 0: line = "\r\n"; break;
-            case 1: line = "\r"; break;
-            case 2: line = "\n"; break;
-            default: line = "\r\n"; break;
+            case 0: job.line = "\r\n"; break;
+            case 1: job.line = "\r"; break;
+            case 2: job.line = "\n"; break;
+            default: job.line = "\r\n"; break;
         }
 
-        bool insertHeader = settings->exportDataDialog.header;
-        QString summaryString;
-
-        if (settings->exportDataDialog.users)
-        {
-            QString fileName = folder+"/"+dateTime+"users.csv";
+        job.header = settings->exportDataDialog.header;
+        job.users = settings->exportDataDialog.users;
+        job.packets = settings->exportDataDialog.packets;
+        job.transfers = settings->exportDataDialog.transfers;
+        job.applications = settings->exportDataDialog.applications;
+        job.hosts = settings->exportDataDialog.hosts;
 
-            if (fileName.isEmpty())
-            {
-                summaryString.append(tr("Users page: <b>FAIL</b> (empty file name)<br>"));
-                goto endUsers;
-            }
+        job.usersHeader = headerLabels(ui.treeWidgetUsers, ui.treeWidgetUsers->columnCount());
+        job.packetsHeader = headerLabels(ui.treeWidgetPackets, ui.treeWidgetPackets->columnCount());
+        // without the speed columns
+        job.transfersHeader = headerLabels(ui.treeWidgetTransfer, ui.treeWidgetTransfer->columnCount()-2);
+        job.applicationsHeader = headerLabels(ui.treeWidgetUsers, 2) + headerLabels(ui.treeWidgetApp, ui.treeWidgetApp->columnCount());
+        job.hostsHeader = headerLabels(ui.treeWidgetUsers, 2) + headerLabels(ui.treeWidgetHosts, ui.treeWidgetHosts->columnCount());
 
-            QFile file(fileName);
+        job.usersList = usersList;
+        job.usersName = usersName;
+        job.usersTimeOn = usersTimeOn;
 
-            if (!file.open(QIODevice::WriteOnly))
-            {
-                eventsViewerMainWindow->addEvent(EVENT_CRITICAL, tr("Exporting data"), tr("Unable to open user file: %1").arg(fileName));
-                summaryString.append(tr("Users page: <b>FAIL</b> (unable to open file)<br>"));
-                goto endUsers;
-            }
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 8; ++j)
+                job.usersPackets[i][j] = usersPackets[i][j];
 
-            QTextStream out(&file);
-            out.setCodec("UTF-8");
+        job.usersUp = usersUp;
+        job.usersDown = usersDown;
+        job.usersPeers = usersPeersCount;
+        job.usersHosts = usersHosts;
+        job.usersApps = usersApps;
 
-            int columns = ui.treeWidgetUsers->columnCount();
+        exportFolder = job.folder;
 
-            int i = 0;
+        exportProgressDlg = new QProgressDialog(tr("Exporting data..."), tr("Cancel"), 0, 0, this);
+        exportProgressDlg->setWindowTitle(tr("Exporting data"));
+        exportProgressDlg->setMinimumDuration(500);
+        connect(exportProgressDlg, SIGNAL(canceled()), dataExporter, SLOT(cancel()));
 
-            if (insertHeader)
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetUsers->headerItem()->text(i) << "\"";
-
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-
-            for (int j = 0; j < ui.treeWidgetUsers->topLevelItemCount(); ++j)
-            {
-                i = 0;
-
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetUsers->topLevelItem(j)->text(i) << "\"";
-
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-            }
-
-            file.close();
-
-            summaryString.append(tr("Users page: <b>DONE</b><br>"));
-        }
-
-        endUsers:
-
-        if (settings->exportDataDialog.packets)
-        {
-            QString fileName = folder+"/"+dateTime+"packets.csv";
-
-            if (fileName.isEmpty())
-            {
-                summaryString.append(tr("Packets page: <b>FAIL</b> (empty file name)<br>"));
-                goto endPackets;
-            }
-
-            QFile file(fileName);
-
-            if (!file.open(QIODevice::WriteOnly))
-            {
-                eventsViewerMainWindow->addEvent(EVENT_CRITICAL, tr("Exporting data"), tr("Unable to open user file: %1").arg(fileName));
-                summaryString.append(tr("Packets page: <b>FAIL</b> (unable to open file)<br>"));
-                goto endPackets;
-            }
-
-            QTextStream out(&file);
-            out.setCodec("UTF-8");
-
-            int columns = ui.treeWidgetPackets->columnCount();
-
-            int i = 0;
-
-            if (insertHeader)
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetPackets->headerItem()->text(i) << "\"";
-
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-
-            for (int j = 0; j < ui.treeWidgetPackets->topLevelItemCount(); ++j)
-            {
-                i = 0;
-
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetPackets->topLevelItem(j)->text(i) << "\"";
+        exportDataAct->setEnabled(false);
+        ui.actionExportData->setEnabled(false);
 
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-            }
-
-            file.close();
-
-            summaryString.append(tr("Packets page: <b>DONE</b><br>"));
-        }
-
-        endPackets:
-
-        if (settings->exportDataDialog.transfers)
-        {
-            QString fileName = folder+"/"+dateTime+"transfers.csv";
-
-            if (fileName.isEmpty())
-            {
-                summaryString.append(tr("Transfers page: <b>FAIL</b> (empty file name)<br>"));
-                goto endTransfer;
-            }
-
-            QFile file(fileName);
-
-            if (!file.open(QIODevice::WriteOnly))
-            {
-                eventsViewerMainWindow->addEvent(EVENT_CRITICAL, tr("Exporting data"), tr("Unable to open user file: %1").arg(fileName));
-                summaryString.append(tr("Transfers page: <b>FAIL</b> (unable to open file)<br>"));
-                goto endTransfer;
-            }
-
-            QTextStream out(&file);
-            out.setCodec("UTF-8");
-
-            int columns = ui.treeWidgetTransfer->columnCount()-2;
-
-            int i = 0;
-
-            if (insertHeader)
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetTransfer->headerItem()->text(i) << "\"";
-
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-
-            for (int j = 0; j < ui.treeWidgetTransfer->topLevelItemCount(); ++j)
-            {
-                i = 0;
+        dataExporter->exportData(job);
+    }
+}
 
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetTransfer->topLevelItem(j)->text(i) << "\"";
+void MainWindow::exportProgress(int value, int maximum)
+{
+    if (!exportProgressDlg || exportProgressDlg->wasCanceled())
+        return;
 
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-            }
+    exportProgressDlg->setMaximum(maximum);
+    exportProgressDlg->setValue(value);
+}
 
-            file.close();
+void MainWindow::dataExported(const QString &summary)
+{
+    delete exportProgressDlg;
+    exportProgressDlg = 0;
 
-            summaryString.append(tr("Transfers page: <b>DONE</b><br>"));
-        }
+    exportDataAct->setEnabled(true);
+    ui.actionExportData->setEnabled(true);
 
-        endTransfer:
+    if (settings->exportDataDialog.summary)
+    {
+        SummaryDialog sDlg(this, summary);
 
-        if (settings->exportDataDialog.applications)
+        if (sDlg.exec())
         {
-            QString fileName = folder+"/"+dateTime+"applications.csv";
-
-            if (fileName.isEmpty())
-            {
-                summaryString.append(tr("Applications page: <b>FAIL</b> (empty file name)<br>"));
-                goto endApplications;
-            }
-
-            QFile file(fileName);
-
-            if (!file.open(QIODevice::WriteOnly))
-            {
-                eventsViewerMainWindow->addEvent(EVENT_CRITICAL, tr("Exporting data"), tr("Unable to open user file: %1").arg(fileName));
-                summaryString.append(tr("Applications page: <b>FAIL</b> (unable to open file)<br>"));
-                goto endApplications;
-            }
-
-            QTextStream out(&file);
-            out.setCodec("UTF-8");
-
-            int i;
-            int columns;
-
-            if (insertHeader)
-            {
-                i = 0;
-                columns = ui.treeWidgetUsersApp->columnCount();
-
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetUsersApp->headerItem()->text(i) << "\"" << field;
-
-                    ++i;
-                }
-
-                i = 0;
-                columns = ui.treeWidgetApp->columnCount();
-
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetApp->headerItem()->text(i) << "\"";
-
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-            }
-
-            for (int j = 0; j < ui.treeWidgetUsersApp->topLevelItemCount(); ++j)
-            {
-                i = 0;
-
-                int x = usersApps.at(j).hostPort.count();
-
-                if (x == 0)
-                {
-                    out << "\"" << ui.treeWidgetUsersApp->topLevelItem(j)->text(0) << "\"" << field << "\"" << ui.treeWidgetUsersApp->topLevelItem(j)->text(1) << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << line;
-                }
-
-                while (i < x)
-                {
-                    if (i == 0)
-                        out << "\"" << ui.treeWidgetUsersApp->topLevelItem(j)->text(0) << "\"" << field << "\"" << ui.treeWidgetUsersApp->topLevelItem(j)->text(1) << "\"" << field;
-                    else
-                        out << "\"" << "" << "\"" << field << "\"" << "" << "\"" << field;
-
-                    out << "\"" << usersApps.at(j).hostPort.at(i) << "\"" << field;
-                    out << "\"" << usersApps.at(j).hostPortName.at(i) << "\"" << field;
-                    out << "\"" << bytesToStr(usersApps.at(j).upBytes.at(i)) << "\"" << field;
-                    out << "\"" << bytesToStr(usersApps.at(j).downBytes.at(i)) << "\"" << line;
-
-                    ++i;
-                }
-            }
-
-            file.close();
-
-            summaryString.append(tr("Applications page: <b>DONE</b><br>"));
+            if (!sDlg.showAgain())
+                settings->exportDataDialog.summary = false;
         }
+    }
 
-        endApplications:
+    if (settings->exportDataDialog.openAfter)
+        QDesktopServices::openUrl(QUrl::fromLocalFile(exportFolder));
+}
 
-        if (settings->exportDataDialog.hosts)
-        {
-            QString fileName = folder+"/"+dateTime+"hosts.csv";
+// the session is written by the receiver core, packets wait in its queue meanwhile
+void MainWindow::onSaveSession()
+{
+    if (sessionFolder.isEmpty())
+        sessionFolder = settings->exportDataDialog.folder;
 
-            if (fileName.isEmpty())
-            {
-                summaryString.append(tr("Hosts page: <b>FAIL</b> (empty file name)<br>"));
-                goto endHosts;
-            }
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save LANAnalyzer session"), sessionFolder + "/" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh.mm.ss") + ".lans", tr("Session files (*.lans);;All files (*.*)"));
 
-            QFile file(fileName);
+    if (fileName.isEmpty())
+        return;
 
-            if (!file.open(QIODevice::WriteOnly))
-            {
-                eventsViewerMainWindow->addEvent(EVENT_CRITICAL, tr("Exporting data"), tr("Unable to open user file: %1").arg(fileName));
-                summaryString.append(tr("Hosts page: <b>FAIL</b> (unable to open file)<br>"));
-                goto endHosts;
-            }
+    sessionFolder = QFileInfo(fileName).absolutePath();
 
-            QTextStream out(&file);
-            out.setCodec("UTF-8");
+    emit requestSaveSession(fileName);
+}
 
-            int i;
-            int columns;
+// a saved session is shown through the same slots the receiver core feeds while capturing
+void MainWindow::onOpenSession()
+{
+    if (capturing)
+    {
+        infoMessage(2, tr("Warning"), tr("Stop the capture before opening a session."));
+        return;
+    }
 
-            if (insertHeader)
-            {
-                i = 0;
-                columns = ui.treeWidgetUsersHosts->columnCount();
+    if (sessionFolder.isEmpty())
+        sessionFolder = settings->exportDataDialog.folder;
 
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetUsersHosts->headerItem()->text(i) << "\"" << field;
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open LANAnalyzer session"), sessionFolder, tr("Session files (*.lans);;All files (*.*)"));
 
-                    ++i;
-                }
+    if (fileName.isEmpty())
+        return;
 
-                i = 0;
-                columns = ui.treeWidgetHosts->columnCount();
+    sessionFolder = QFileInfo(fileName).absolutePath();
 
-                while (i < columns)
-                {
-                    out << "\"" << ui.treeWidgetHosts->headerItem()->text(i) << "\"";
+    SessionData data;
+    QString error;
 
-                    if (++i < columns)
-                        out << field;
-                    else
-                        out << line;
-                }
-            }
+    if (!SessionFile::load(fileName, data, &error))
+    {
+        infoMessage(3, tr("Critical"), error);
+        return;
+    }
 
-            for (int j = 0; j < ui.treeWidgetUsersHosts->topLevelItemCount(); ++j)
-            {
-                i = 0;
+    clearVariables();
 
-                int x = usersHosts.at(j).dPort.count();
+    // users of the session are added again by newUser()
+    if (userTransfersGraphDlg)
+        userTransfersGraphDlg->clearData();
 
-                if (x == 0)
-                {
-                    out << "\"" << ui.treeWidgetUsersHosts->topLevelItem(j)->text(0) << "\"" << field << "\"" << ui.treeWidgetUsersHosts->topLevelItem(j)->text(1) << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << field;
-                    out << "\"" << "" << "\"" << line;
-                }
+    for (int i = 0; i < data.usersList.count(); ++i)
+    {
+        newUser(data.usersList.at(i), timeToStr(data.usersTimeOn.at(i)));
 
-                while (i < x)
-                {
-                    if (i == 0)
-                        out << "\"" << ui.treeWidgetUsersHosts->topLevelItem(j)->text(0) << "\"" << field << "\"" << ui.treeWidgetUsersHosts->topLevelItem(j)->text(1) << "\"" << field;
-                    else
-                        out << "\"" << "" << "\"" << field << "\"" << "" << "\"" << field;
-
-                    addr.S_un.S_addr = usersHosts.at(j).hostIp.at(i);
-                    QString user = inet_ntoa(addr);
-                    out << "\"" << user << "\"" << field;
-                    out << "\"" << usersHosts.at(j).hostName.at(i) << "\"" << field;
-                    out << "\"" << usersHosts.at(j).dPort.at(i) << "\"" << field;
-                    out << "\"" << usersHosts.at(j).dApp.at(i) << "\"" << field;
-                    out << "\"" << bytesToStr(usersHosts.at(j).upBytes.at(i)) << "\"" << field;
-                    out << "\"" << bytesToStr(usersHosts.at(j).downBytes.at(i)) << "\"" << field;
-                    out << "\"" << usersHosts.at(j).firstVisit.at(i) << "\"" << field;
-                    out << "\"" << usersHosts.at(j).lastVisit.at(i) << "\"" << line;
-
-                    ++i;
-                }
-            }
+        if (!data.usersName.at(i).isEmpty())
+            newUserName(data.usersList.at(i), data.usersName.at(i));
+    }
 
-            file.close();
+    usersTransfer(data.usersUp, data.usersDown);
+    usersPeers(data.usersPeers);
 
-            summaryString.append(tr("Hosts page: <b>DONE</b><br>"));
-        }
+    QList<quint32> (&all)[8] = data.usersPackets[EXPORT_ALL];
+    QList<quint32> (&in)[8] = data.usersPackets[EXPORT_IN];
+    QList<quint32> (&out)[8] = data.usersPackets[EXPORT_OUT];
+    netAllPackets(all[0], all[1], all[2], all[3], all[4], all[5], all[6], all[7]);
+    netInPackets(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7]);
+    netOutPackets(out[0], out[1], out[2], out[3], out[4], out[5], out[6], out[7]);
 
-        endHosts:
+    updateUsersApps(data.usersApps);
+    updateUsersHosts(data.usersHosts);
 
-        if (settings->exportDataDialog.summary)
-        {
-            SummaryDialog sDlg(this, summaryString);
+    netTransfer(data.netUp, data.netDown);
+    createNetPacketsDlg();
+    netPacketsDlg->setNetPackets(data.netPackets[0], data.netPackets[1], data.netPackets[2], data.netPackets[3], data.netPackets[4], data.netPackets[5], data.netPackets[6], data.netPackets[7]);
 
-            if (sDlg.exec())
-            {
-                if (!sDlg.showAgain())
-                    settings->exportDataDialog.summary = false;
-            }
-        }
+    // the receiver core still holds the last capture, it is not the session shown
+    ui.actionSaveSession->setDisabled(true);
 
-        if (settings->exportDataDialog.openAfter)
-            QDesktopServices::openUrl(QUrl::fromLocalFile(folder));
-    }
+    infoLabel->setText(tr("Session %1").arg(QFileInfo(fileName).fileName()));
+    eventsViewerMainWindow->addEvent(EVENT_INFORMATION, tr("Session opened"), tr("%1, captured %2 - %3").arg(fileName).arg(timeToStr(data.started)).arg(timeToStr(data.saved)));
 }
 
 //=====================================================================================================================================================================================================
 void MainWindow::showNetPacketsDlg()
 {
+    createNetPacketsDlg();
     netPacketsDlg->show();
     netPacketsDlg->raise();
     netPacketsDlg->activateWindow();
@@ -2466,6 +2379,7 @@ void MainWindow::showNetPacketsDlg()
 
 void MainWindow::showNetPacketsGraphDlg()
 {
+    createNetPacketsGraphDlg();
     netPacketsGraphDlg->showNormal();
     netPacketsGraphDlg->raise();
     netPacketsGraphDlg->activateWindow();
@@ -2473,6 +2387,7 @@ void MainWindow::showNetPacketsGraphDlg()
 
 void MainWindow::showNetTransferDlg()
 {
+    createNetTransferDlg();
     netTransferDlg->show();
     netTransferDlg->raise();
     netTransferDlg->activateWindow();
@@ -2480,6 +2395,7 @@ void MainWindow::showNetTransferDlg()
 
 void MainWindow::showNetTransferGraphDlg()
 {
+    createNetTransferGraphDlg();
     netTransferGraphDlg->showNormal();
     netTransferGraphDlg->raise();
     netTransferGraphDlg->activateWindow();
@@ -2487,6 +2403,8 @@ void MainWindow::showNetTransferGraphDlg()
 
 void MainWindow::showPacketsMainWindow()
 {
+    createPacketsMainWindow();
+
     if (packetsMainWindow->isMinimized())
         packetsMainWindow->setWindowState(packetsMainWindow->windowState() ^ Qt::WindowMinimized);
 
@@ -2509,12 +2427,12 @@ void MainWindow::showEventsViewerMainWindow()
 
 void MainWindow::showPortNumbersDlg()
 {
-    PortNumbersDialog dlg(this);
+    PortNumbersDialog dlg(this, portDatabase);
 
     dlg.exec();
 
     if (capturing && dlg.isModified())
-        QMessageBox::information(this, tr("Information"), tr("The changes take effect next time you start capture."));
+        QMessageBox::information(this, tr("Information"), tr("The changes take effect for the applications seen from now on."));
 }
 
 //=====================================================================================================================================================================================================
@@ -2550,7 +2468,7 @@ void MainWindow::showSettingsDlg()
 
     dlg.exec();
 
-    if (up != settings->netTransferDialog.up || down != settings->netTransferDialog.down)
+    if (netTransferDlg && (up != settings->netTransferDialog.up || down != settings->netTransferDialog.down))
     {
         netTransferDlg->setScale(settings->netTransferDialog.up, settings->netTransferDialog.down);
     }
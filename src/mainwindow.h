@@ -43,6 +43,9 @@
 #include "exportdatadialog.h"
 #include "summarydialog.h"
 #include "myoutputdialog.h"
+#include "metricsserver.h"
+#include "dataexporter.h"
+#include "sessionfile.h"
 
 //#include "WpdPack/Include/pcap.h"
 //#include "WpdPack/Include/remote-ext.h"
@@ -84,13 +87,13 @@ private:
 
     // WinPcap's device
     pcap_if_t *device;
-
-    // winsock2.h
-    struct in_addr addr;
+    quint32 deviceNetMask, deviceIP;
+    QList<IpAddress> deviceIPv6;
 
     // users IPs & names
     QList<QString> usersList;
     QList<QString> usersName;
+    QList<QString> usersTimeOn;
 
     // users data
     QList<quint64> usersUp, usersDown,
@@ -100,15 +103,30 @@ private:
     QList<Hosts> usersHosts;
     QList<Apps> usersApps;
 
+    // folds of the user shown in the hosts and applications views when they were filled
+    quint32 hostsViewFolds, appsViewFolds;
+
+    // raw counters of the pages, for the export
+    QList<quint32> usersPackets[3][8];
+    QList<quint32> usersPeersCount;
+
     // network data
     quint64 netUpTotal, netDownTotal;
     quint64 netUpTotalPrev, netDownTotalPrev;
 
+    // open Top-N dialog, user or port limit it to one user or one port
+    TopActiveDialog *topActiveDlg;
+    quint8 topActiveKind, topActiveDirection;
+    int topActiveUser;
+    QString topActivePort;
+    int topActiveCount;
+    bool topActiveWindow;
+
     // threads
     CaptureThread *captureThread;
     QThread *receiverThread;
 
-    // objects
+    // objects, the dialogs are created when first shown
     Settings *settings;
     MyOutputDialog *myOutputDlg;
     EventsViewerMainWindow *eventsViewerMainWindow;
@@ -119,6 +137,12 @@ private:
     NetPacketsGraphDialog *netPacketsGraphDlg;
     NetTransferGraphDialog *netTransferGraphDlg;
     UserTransfersGraphDialog *userTransfersGraphDlg;
+    MetricsServer *metricsServer;
+    PortDatabase *portDatabase;
+    DataExporter *dataExporter;
+    QProgressDialog *exportProgressDlg;
+    QString exportFolder;
+    QString sessionFolder;
 
     // timers
     QTimer *clockTimer;
@@ -127,6 +151,8 @@ private:
     // status bar
     QLabel *deviceLabel;
     QLabel *filterLabel;
+    QLabel *samplingLabel;
+    QLabel *memoryLabel;
     QLabel *infoLabel;
     QLabel *clockLabel;
 
@@ -186,6 +212,14 @@ private:
     void createObjects();
     void clearVariables();
 
+    void createMyOutputDlg();
+    void createNetPacketsDlg();
+    void createNetTransferDlg();
+    void createNetPacketsGraphDlg();
+    void createNetTransferGraphDlg();
+    void createUserTransfersGraphDlg();
+    void createPacketsMainWindow();
+
     void setDevice();
     void setFilter();
 
@@ -196,11 +230,21 @@ private:
     void writeSettings(bool writeFile);
 
     QString bytesToStr(quint64 bytes);
+    QString timeToStr(quint64 seconds);
+    QStringList headerLabels(QTreeWidget *treeWidget, int columns);
+
+    void showTopActiveDlg(quint8 kind, quint8 direction, int user, const QString &port);
+    void updateTopActiveDlg();
+    void fillTopActiveDlg(quint64 total, const QList<TopEntry> &top);
 
 private slots:
     // menu
     // file
     void onExportData();
+    void exportProgress(int value, int maximum);
+    void dataExported(const QString &summary);
+    void onOpenSession();
+    void onSaveSession();
 
     // capture
     void startCapture();
@@ -258,6 +302,8 @@ private slots:
     void showTopActiveHostsDownDlg();
     void onHostsOpen();
 
+    void onTopActiveChanged(int count, bool window);
+
     //
     void onUsersHostsChanged();
     void onUsersAppsChanged();
@@ -265,6 +311,7 @@ private slots:
     // context menu
     void onApplicationsContextMenu(const QPoint &pos);
     void onHostsContextMenu(const QPoint &pos);
+    void onUsersContextMenu(const QPoint &pos);
 
     // timers update
     void updateClockTimer();
@@ -277,6 +324,7 @@ private slots:
     //
     void setMyWindowOpacity(int value);
     void infoMessage(quint8 type, const QString &title, const QString &message);
+    void logMessage(quint8 type, const QString &title, const QString &message);
 
     // from receiverCore
     void newUser(const QString &user, const QString &timeOn);
@@ -284,6 +332,8 @@ private slots:
 
     void usersTransfer(QList<quint64> usersUp, QList<quint64> usersDown);
     void usersSpeed(QList<qreal> usersUpSpeed, QList<qreal> usersDownSpeed);
+    void usersPeers(QList<quint32> usersPeers);
+    void memoryUsed(quint64 hosts, quint64 apps, quint64 estimators, quint64 budget);
 
     void netTransfer(quint64 up, quint64 down);
 
@@ -297,6 +347,12 @@ private slots:
 
     void updateUsersApps(QList<Apps> usersApps);
     void updateUsersHosts(QList<Hosts> usersHosts);
+
+    void topActive(quint8 kind, quint8 direction, bool window, quint64 total, QList<TopEntry> top);
+
+signals:
+    void requestTopActive(quint8 kind, quint8 direction, bool window, int size);
+    void requestSaveSession(const QString &fileName);
 };
 
 #endif // MAINWINDOW_H
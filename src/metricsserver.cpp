@@ -0,0 +1,154 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "metricsserver.h"
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    server = new QTcpServer(this);
+    connect(server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+
+    connections = 0;
+
+    notFound = "HTTP/1.0 404 Not Found\r\n"
+               "Content-Type: text/plain\r\n"
+               "Content-Length: 10\r\n"
+               "Connection: close\r\n"
+               "\r\n"
+               "Not Found\n";
+
+    setExposition(QByteArray());
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(const QString &address, quint16 port)
+{
+    stop();
+
+    QHostAddress hostAddress(address);
+    if (hostAddress.isNull())
+        hostAddress = QHostAddress::LocalHost;
+
+    if (!server->listen(hostAddress, port))
+    {
+        // 2 - warning
+        emit infoMessage(2, tr("Metrics server"), tr("Unable to listen on %1:%2. %3").arg(hostAddress.toString()).arg(port).arg(server->errorString()));
+        return false;
+    }
+
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (server->isListening())
+        server->close();
+}
+
+void MetricsServer::setExposition(const QByteArray &exposition)
+{
+    // build the whole response once, scrapes just write it out
+    response.clear();
+    response.reserve(exposition.size() + 128);
+    response.append("HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                    "Content-Length: ");
+    response.append(QByteArray::number(exposition.size()));
+    response.append("\r\nConnection: close\r\n\r\n");
+    response.append(exposition);
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (server->hasPendingConnections())
+    {
+        QTcpSocket *socket = server->nextPendingConnection();
+
+        if (connections >= MAX_CONNECTIONS)
+        {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        ++connections;
+        connect(socket, SIGNAL(destroyed()), this, SLOT(onSocketDestroyed()));
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+
+        // also covers a client that does not read the response
+        QTimer *idleTimer = new QTimer(socket);
+        idleTimer->setSingleShot(true);
+        connect(idleTimer, SIGNAL(timeout()), this, SLOT(onIdleTimeout()));
+        idleTimer->start(IDLE_TIMEOUT);
+    }
+}
+
+void MetricsServer::onIdleTimeout()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender()->parent());
+    if (!socket)
+        return;
+
+    socket->abort();
+    socket->deleteLater();
+}
+
+void MetricsServer::onSocketDestroyed()
+{
+    --connections;
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket)
+        return;
+
+    // wait for the request line, headers are ignored
+    if (!socket->canReadLine())
+    {
+        // nobody sends a 4 KB request line to a metrics endpoint
+        if (socket->bytesAvailable() > 4096)
+            socket->abort();
+        return;
+    }
+
+    QByteArray requestLine = socket->readLine(4096);
+    socket->readAll();
+
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+    QList<QByteArray> request = requestLine.simplified().split(' ');
+
+    if (request.count() >= 2 && request.at(0) == "GET" && (request.at(1) == "/metrics" || request.at(1) == "/"))
+    {
+        socket->write(response);
+    }
+    else
+    {
+        socket->write(notFound);
+    }
+
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,68 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QTimer>
+
+// minimal HTTP endpoint serving ReceiverCore counters in Prometheus/OpenMetrics text format;
+// the exposition is rendered once per refresh tick, a scrape only writes the cached response
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(MetricsServer)
+
+public:
+    explicit MetricsServer(QObject *parent = 0);
+    ~MetricsServer();
+
+    bool start(const QString &address, quint16 port);
+    void stop();
+
+    bool isListening() const { return server->isListening(); }
+
+private:
+    // a scrape is one short request, idle or half-open clients are dropped
+    enum { MAX_CONNECTIONS = 16, IDLE_TIMEOUT = 5000 };
+
+    QTcpServer *server;
+    int connections;
+
+    // complete HTTP response (headers + body)
+    QByteArray response;
+    QByteArray notFound;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onIdleTimeout();
+    void onSocketDestroyed();
+
+public slots:
+    void setExposition(const QByteArray &exposition);
+
+signals:
+    void infoMessage(quint8 type, const QString &title, const QString &message);
+};
+
+#endif // METRICSSERVER_H
@@ -22,7 +22,7 @@ MyOutputDialog::MyOutputDialog(QWidget *parent, ReceiverCore *receiverCore)
 {
     ui.setupUi(this);
 
-    connect(receiverCore, SIGNAL(signalMulticast(quint32,quint32,quint32,quint8)), this, SLOT(receivedMulticast(quint32,quint32,quint32,quint8)), Qt::QueuedConnection);
+    connect(receiverCore, SIGNAL(signalMulticast(IpAddress,IpAddress,quint32,quint8)), this, SLOT(receivedMulticast(IpAddress,IpAddress,quint32,quint8)), Qt::QueuedConnection);
 
     connect(ui.treeWidgetMulticast, SIGNAL(itemSelectionChanged()), this, SLOT(onMulticastItemChanged()));
 
@@ -86,13 +86,12 @@ void MyOutputDialog::onMulticastItemChanged()
 
         for (int i = 0; i < ips.at(item).oIP.count(); ++i)
         {
-            addr.S_un.S_addr = ips.at(item).oIP.at(i);
-            ui.treeWidgetOther->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetOther, QStringList() << inet_ntoa(addr) << bytesToStr(ips.at(item).up.at(i)) << bytesToStr(ips.at(item).down.at(i))));
+            ui.treeWidgetOther->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetOther, QStringList() << ips.at(item).oIP.at(i).toString() << bytesToStr(ips.at(item).up.at(i)) << bytesToStr(ips.at(item).down.at(i))));
         }
     }
 }
 
-void MyOutputDialog::receivedMulticast(quint32 multicastIP, quint32 otherIP, quint32 length, quint8 direction)
+void MyOutputDialog::receivedMulticast(const IpAddress &multicastIP, const IpAddress &otherIP, quint32 length, quint8 direction)
 {
     if (!mIP.contains(multicastIP))
     {
@@ -101,8 +100,7 @@ void MyOutputDialog::receivedMulticast(quint32 multicastIP, quint32 otherIP, qui
         IPs s;
         ips.append(s);
 
-        addr.S_un.S_addr = multicastIP;
-        ui.treeWidgetMulticast->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetMulticast, QStringList() << inet_ntoa(addr)));
+        ui.treeWidgetMulticast->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetMulticast, QStringList() << multicastIP.toString()));
     }
 
     int index = mIP.indexOf(multicastIP, 0);
@@ -115,8 +113,7 @@ void MyOutputDialog::receivedMulticast(quint32 multicastIP, quint32 otherIP, qui
 
         if (ui.treeWidgetMulticast->indexOfTopLevelItem(ui.treeWidgetMulticast->currentItem()) == index)
         {
-            addr.S_un.S_addr = otherIP;
-            ui.treeWidgetOther->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetOther, QStringList() << inet_ntoa(addr) << bytesToStr(0) << bytesToStr(0)));
+            ui.treeWidgetOther->addTopLevelItem(new QTreeWidgetItem(ui.treeWidgetOther, QStringList() << otherIP.toString() << bytesToStr(0) << bytesToStr(0)));
         }
     }
 
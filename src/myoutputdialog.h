@@ -47,23 +47,21 @@ private:
     QPoint myPosition;
     QSize mySize;
 
-    QList<quint32> mIP;
+    QList<IpAddress> mIP;
 
     struct IPs
     {
-        QList<quint32> oIP;
+        QList<IpAddress> oIP;
         QList<quint64> up;
         QList<quint64> down;
     };
     QList<IPs> ips;
 
-    struct in_addr addr;
-
     QString bytesToStr(quint64 bytes);
 
 private slots:
     void onMulticastItemChanged();
-    void receivedMulticast(quint32 multicastIP, quint32 otherIP, quint32 length, quint8 direction);
+    void receivedMulticast(const IpAddress &multicastIP, const IpAddress &otherIP, quint32 length, quint8 direction);
 };
 
 #endif // MYOUTPUTDIALOG_H
@@ -0,0 +1,390 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "namedecoder.h"
+#include "capturethread.h"
+
+#include <QStringList>
+#include <QtEndian>
+
+#include <string.h>
+
+namespace
+{
+    inline quint16 get16(const quint8 *data) { return qFromBigEndian<quint16>(data); }
+    inline quint32 get32(const quint8 *data) { return qFromBigEndian<quint32>(data); }
+
+    inline IpAddress ipv4(const quint8 *data)
+    {
+        quint32 address;
+        memcpy(&address, data, 4);
+        return IpAddress(address);
+    }
+
+    void append(Packet &packet, const IpAddress &ip, const QString &name, quint32 ttl, quint8 source)
+    {
+        if (ip.isNull() || name.isEmpty())
+            return;
+
+        DiscoveredName discovered;
+        discovered.ip = ip;
+        discovered.name = name;
+        discovered.ttl = ttl;
+        discovered.source = source;
+
+        packet.names.append(discovered);
+    }
+
+    // DNS name at data in wire format (RFC 1035), compression pointers are
+    // followed; data is left past the name as stored at data
+    bool readName(const quint8 *message, const quint8 *end, const quint8 *&data, QString &name)
+    {
+        char buffer[256];
+        int length = 0;
+        int jumps = 0;
+        const quint8 *p = data;
+        const quint8 *next = 0;
+
+        for (;;)
+        {
+            if (p >= end)
+                return false;
+
+            quint8 label = *p;
+
+            if (label == 0)
+            {
+                ++p;
+                break;
+            }
+
+            if ((label & 0xc0) == 0xc0)
+            {
+                // pointer loops
+                if (!captured(p, end, 2) || ++jumps > 16)
+                    return false;
+
+                if (!next)
+                    next = p + 2;
+
+                p = message + ((label & 0x3f) << 8 | p[1]);
+                continue;
+            }
+
+            // extended label types are not used
+            if (label & 0xc0 || !captured(p + 1, end, label) || length + label + 1 > 255)
+                return false;
+
+            if (length)
+                buffer[length++] = '.';
+
+            memcpy(buffer + length, p + 1, label);
+            length+=label;
+            p+=1 + label;
+        }
+
+        data = next ? next : p;
+
+        // mDNS names are UTF-8
+        name = QString::fromUtf8(buffer, length);
+
+        return true;
+    }
+
+    // address of a PTR owner name, d.c.b.a.in-addr.arpa or 32 nibbles of ip6.arpa
+    IpAddress reverseAddress(const QString &name)
+    {
+        QString lower = name.toLower();
+
+        if (lower.endsWith(".in-addr.arpa"))
+        {
+            QStringList labels = lower.left(lower.length() - 13).split('.');
+            if (labels.count() != 4)
+                return IpAddress();
+
+            return IpAddress::fromString(labels.at(3) + '.' + labels.at(2) + '.' + labels.at(1) + '.' + labels.at(0));
+        }
+
+        if (lower.endsWith(".ip6.arpa"))
+        {
+            QStringList labels = lower.left(lower.length() - 9).split('.');
+            if (labels.count() != 32)
+                return IpAddress();
+
+            QString address;
+            for (int i = 31; i >= 0; --i)
+            {
+                address+=labels.at(i);
+                if (i % 4 == 0 && i != 0)
+                    address+=':';
+            }
+
+            return IpAddress::fromString(address);
+        }
+
+        return IpAddress();
+    }
+
+    // skips the question section; false if it was not captured
+    bool skipQuestions(const quint8 *message, const quint8 *end, const quint8 *&data, int count, QString &first)
+    {
+        QString name;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (!readName(message, end, data, i == 0 ? first : name) || !captured(data, end, 4))
+                return false;
+
+            data+=4;
+        }
+
+        return true;
+    }
+
+    // resource record header; rdata and its length are returned, data is left past the record
+    bool readRecord(const quint8 *message, const quint8 *end, const quint8 *&data, QString &owner,
+                    quint16 &type, quint16 &cls, quint32 &ttl, const quint8 *&rdata, quint16 &length)
+    {
+        if (!readName(message, end, data, owner) || !captured(data, end, 10))
+            return false;
+
+        type = get16(data);
+        cls = get16(data + 2) & 0x7fff;     // mDNS cache flush bit
+        ttl = get32(data + 4);
+        length = get16(data + 8);
+        data+=10;
+
+        if (!captured(data, end, length))
+            return false;
+
+        rdata = data;
+        data+=length;
+
+        return true;
+    }
+
+    void decodeDns(Packet &packet, const quint8 *data, const quint8 *end, quint8 source)
+    {
+        const quint8 *message = data;
+
+        if (!captured(data, end, 12))
+            return;
+
+        // responses without an error only
+        quint16 flags = get16(data + 2);
+        if (!(flags & 0x8000) || (flags & 0x000f))
+            return;
+
+        int questions = get16(data + 4);
+        int answers = get16(data + 6);
+        int records = answers + get16(data + 8) + get16(data + 10);
+        data+=12;
+
+        QString question, owner, name;
+        quint16 type, cls, length;
+        quint32 ttl;
+        const quint8 *rdata;
+
+        if (!skipQuestions(message, end, data, questions, question))
+            return;
+
+        for (int i = 0; i < records; ++i)
+        {
+            if (!readRecord(message, end, data, owner, type, cls, ttl, rdata, length))
+                return;
+
+            if (cls != 1)
+                continue;
+
+            // answers to a unicast query are named as asked, not by the CNAME chain of a CDN
+            const QString &host = source == NAME_DNS && i < answers && !question.isEmpty() ? question : owner;
+
+            if (type == 1 && length == 4)
+                append(packet, ipv4(rdata), host, ttl, source);
+            else if (type == 28 && length == 16)
+                append(packet, IpAddress(rdata), host, ttl, source);
+            else if (type == 12 && readName(message, end, rdata, name))
+                append(packet, reverseAddress(owner), name, ttl, source);
+        }
+    }
+
+    void decodeDhcp(Packet &packet, const quint8 *data, const quint8 *end)
+    {
+        // fixed BOOTP part and the magic cookie
+        if (!captured(data, end, 240) || get32(data + 236) != 0x63825363)
+            return;
+
+        IpAddress ciaddr = ipv4(data + 12), yiaddr = ipv4(data + 16), requested;
+        quint8 type = 0;
+        quint32 lease = 0;
+        QString hostName, fqdn;
+
+        const quint8 *p = data + 240;
+
+        while (p < end && *p != 255)
+        {
+            // pad
+            if (*p == 0)
+            {
+                ++p;
+                continue;
+            }
+
+            if (!captured(p, end, 2) || !captured(p + 2, end, p[1]))
+                return;
+
+            quint8 option = p[0], length = p[1];
+            const quint8 *value = p + 2;
+            p+=2 + length;
+
+            switch (option)
+            {
+                case 12:    // host name, some clients add a NUL
+                    hostName = QString::fromUtf8((const char *)value, qstrnlen((const char *)value, length)).trimmed();
+                    break;
+                case 50:    // requested IP address
+                    if (length == 4)
+                        requested = ipv4(value);
+                    break;
+                case 51:    // lease time
+                    if (length == 4)
+                        lease = get32(value);
+                    break;
+                case 53:    // message type
+                    if (length == 1)
+                        type = value[0];
+                    break;
+                case 81:    // client FQDN: flags, two obsolete codes, the name in wire format if the E flag is set
+                    if (length > 3)
+                    {
+                        const quint8 *name = value + 3;
+
+                        if (!(value[0] & 0x04))
+                            fqdn = QString::fromUtf8((const char *)name, qstrnlen((const char *)name, length - 3)).trimmed();
+                        else if (!readName(name, value + length, name, fqdn))
+                            fqdn.clear();
+                    }
+                    break;
+            }
+        }
+
+        // request, ack and inform name an address the client has or is about to get
+        if (type != 3 && type != 5 && type != 8)
+            return;
+
+        IpAddress ip = ciaddr.toIPv4() ? ciaddr : yiaddr.toIPv4() ? yiaddr : requested;
+
+        append(packet, ip, fqdn.isEmpty() ? hostName : fqdn, lease, NAME_DHCP);
+    }
+
+    // first level encoding (RFC 1001): 16 bytes as 32 letters 'A' + nibble, a name of
+    // 15 characters padded with spaces and the suffix; only workstation and server names
+    QString netbiosName(const QString &encoded)
+    {
+        int dot = encoded.indexOf('.');
+        QString label = dot == -1 ? encoded : encoded.left(dot);
+
+        if (label.length() != 32)
+            return QString();
+
+        char name[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            int high = label.at(2 * i).toUpper().toLatin1() - 'A';
+            int low = label.at(2 * i + 1).toUpper().toLatin1() - 'A';
+
+            if (high < 0 || high > 15 || low < 0 || low > 15)
+                return QString();
+
+            name[i] = high << 4 | low;
+        }
+
+        if (name[15] != 0x00 && name[15] != 0x20)
+            return QString();
+
+        return QString::fromLatin1(name, 15).trimmed();
+    }
+
+    void decodeNetbios(Packet &packet, const quint8 *data, const quint8 *end)
+    {
+        const quint8 *message = data;
+
+        if (!captured(data, end, 12))
+            return;
+
+        // positive query responses, registrations and refreshes
+        quint16 flags = get16(data + 2);
+        quint8 opcode = flags >> 11 & 0x0f;
+
+        if ((flags & 0x8000) ? (opcode != 0 || (flags & 0x000f)) : (opcode != 5 && opcode != 8 && opcode != 9))
+            return;
+
+        int questions = get16(data + 4);
+        int records = get16(data + 6) + get16(data + 8) + get16(data + 10);
+        data+=12;
+
+        QString question, owner;
+        quint16 type, cls, length;
+        quint32 ttl;
+        const quint8 *rdata;
+
+        if (!skipQuestions(message, end, data, questions, question))
+            return;
+
+        for (int i = 0; i < records; ++i)
+        {
+            if (!readRecord(message, end, data, owner, type, cls, ttl, rdata, length))
+                return;
+
+            // NB records of class IN
+            if (type != 0x0020 || cls != 1)
+                continue;
+
+            QString name = netbiosName(owner);
+            if (name.isEmpty())
+                continue;
+
+            // flags and an address per entry, group names are shared by many hosts
+            for (int j = 0; j + 6 <= length; j+=6)
+                if (!(get16(rdata + j) & 0x8000))
+                    append(packet, ipv4(rdata + j + 2), name, ttl, NAME_NETBIOS);
+        }
+    }
+}
+
+void NameDecoder::decode(Packet &packet, const quint8 *data, const quint8 *end)
+{
+    // answers come from the service port
+    switch (packet.sPort)
+    {
+        case 53:
+            decodeDns(packet, data, end, NAME_DNS);
+            break;
+        case 5353:
+        case 5355:
+            decodeDns(packet, data, end, NAME_MDNS);
+            break;
+        case 67:
+        case 68:
+            if (packet.dPort == 67 || packet.dPort == 68)
+                decodeDhcp(packet, data, end);
+            break;
+        case 137:
+            decodeNetbios(packet, data, end);
+            break;
+    }
+}
@@ -0,0 +1,56 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NAMEDECODER_H
+#define NAMEDECODER_H
+
+#include <QList>
+#include <QString>
+
+#include "ipaddress.h"
+
+struct Packet;
+
+// where a name was seen
+enum
+{
+    NAME_DNS = 0,           // unicast DNS answers
+    NAME_MDNS,              // multicast DNS and LLMNR answers
+    NAME_DHCP,              // DHCP host name and client FQDN options
+    NAME_NETBIOS,           // NetBIOS name service registrations and answers
+    NAME_SOURCES
+};
+
+struct DiscoveredName
+{
+    IpAddress ip;
+    QString name;
+    quint32 ttl;            // seconds, 0 if not given
+    quint8 source;          // NAME_*
+};
+
+// passive name discovery: names of addresses are taken from the name service
+// messages already being captured, so they are known before, or instead of,
+// a reverse lookup; called by the UDP dissector when enabled
+class NameDecoder
+{
+public:
+    // appends the names found in the UDP payload at data to packet.names
+    static void decode(Packet &packet, const quint8 *data, const quint8 *end);
+};
+
+#endif // NAMEDECODER_H
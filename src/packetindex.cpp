@@ -0,0 +1,303 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "packetindex.h"
+#include "dissectors.h"
+
+#include <string.h>
+
+namespace
+{
+    inline int bitCount(quint64 x)
+    {
+        x = x - ((x >> 1) & Q_UINT64_C(0x5555555555555555));
+        x = (x & Q_UINT64_C(0x3333333333333333)) + ((x >> 2) & Q_UINT64_C(0x3333333333333333));
+        x = (x + (x >> 4)) & Q_UINT64_C(0x0f0f0f0f0f0f0f0f);
+        return (int)((x * Q_UINT64_C(0x0101010101010101)) >> 56);
+    }
+}
+
+PostingList::PostingList()
+{
+    total = 0;
+}
+
+void PostingList::append(quint32 row)
+{
+    quint16 key = row >> 16;
+    quint16 low = row & 0xffff;
+
+    if (containers.isEmpty() || containers.last().key != key)
+    {
+        Container c;
+        c.key = key;
+        c.count = 0;
+        containers.append(c);
+    }
+
+    Container &c = containers.last();
+
+    if (c.bitmap.isEmpty())
+    {
+        c.array.append(low);
+
+        if (c.array.count() > ARRAY_MAX)
+            toBitmap(c);
+    }
+    else
+    {
+        c.bitmap[low >> 6] |= Q_UINT64_C(1) << (low & 63);
+    }
+
+    ++c.count;
+    ++total;
+}
+
+void PostingList::clear()
+{
+    containers.clear();
+    total = 0;
+}
+
+void PostingList::rows(QVector<int> &rows) const
+{
+    rows.reserve(rows.count() + total);
+
+    for (int i = 0; i < containers.count(); ++i)
+    {
+        const Container &c = containers.at(i);
+        int base = c.key << 16;
+
+        if (c.bitmap.isEmpty())
+        {
+            for (int j = 0; j < c.array.count(); ++j)
+                rows.append(base | c.array.at(j));
+        }
+        else
+        {
+            for (int w = 0; w < BITMAP_WORDS; ++w)
+            {
+                quint64 word = c.bitmap.at(w);
+
+                for (int b = 0; word; ++b, word >>= 1)
+                {
+                    if (word & 1)
+                        rows.append(base | w << 6 | b);
+                }
+            }
+        }
+    }
+}
+
+void PostingList::toBitmap(Container &c)
+{
+    c.bitmap.fill(0, BITMAP_WORDS);
+
+    for (int i = 0; i < c.array.count(); ++i)
+        c.bitmap[c.array.at(i) >> 6] |= Q_UINT64_C(1) << (c.array.at(i) & 63);
+
+    c.array.clear();
+}
+
+void PostingList::toArray(Container &c)
+{
+    c.array.clear();
+    c.array.reserve(c.count);
+
+    for (int w = 0; w < BITMAP_WORDS; ++w)
+    {
+        quint64 word = c.bitmap.at(w);
+
+        for (int b = 0; word; ++b, word >>= 1)
+        {
+            if (word & 1)
+                c.array.append(w << 6 | b);
+        }
+    }
+
+    c.bitmap.clear();
+}
+
+void PostingList::intersect(const Container &a, const Container &b, Container &result)
+{
+    result.key = a.key;
+    result.count = 0;
+    result.array.clear();
+    result.bitmap.clear();
+
+    int i, j;
+
+    // bitmap and bitmap, word by word
+    if (!a.bitmap.isEmpty() && !b.bitmap.isEmpty())
+    {
+        result.bitmap.resize(BITMAP_WORDS);
+
+        for (i = 0; i < BITMAP_WORDS; ++i)
+        {
+            result.bitmap[i] = a.bitmap.at(i) & b.bitmap.at(i);
+            result.count += bitCount(result.bitmap.at(i));
+        }
+
+        if (result.count <= ARRAY_MAX)
+            toArray(result);
+
+        return;
+    }
+
+    // array and bitmap, a bit test per array value
+    if (!a.bitmap.isEmpty() || !b.bitmap.isEmpty())
+    {
+        const Container &array = a.bitmap.isEmpty() ? a : b;
+        const Container &bitmap = a.bitmap.isEmpty() ? b : a;
+
+        for (i = 0; i < array.array.count(); ++i)
+        {
+            quint16 v = array.array.at(i);
+
+            if (bitmap.bitmap.at(v >> 6) & Q_UINT64_C(1) << (v & 63))
+                result.array.append(v);
+        }
+
+        result.count = result.array.count();
+        return;
+    }
+
+    // array and array, merge
+    i = j = 0;
+    while (i < a.array.count() && j < b.array.count())
+    {
+        quint16 x = a.array.at(i), y = b.array.at(j);
+
+        if (x < y)
+            ++i;
+        else if (y < x)
+            ++j;
+        else
+        {
+            result.array.append(x);
+            ++i;
+            ++j;
+        }
+    }
+
+    result.count = result.array.count();
+}
+
+void PostingList::intersect(const PostingList &a, const PostingList &b, PostingList &result)
+{
+    result.clear();
+
+    int i = 0, j = 0;
+    Container c;
+
+    // containers are sorted by key, only the common keys are intersected
+    while (i < a.containers.count() && j < b.containers.count())
+    {
+        quint16 x = a.containers.at(i).key, y = b.containers.at(j).key;
+
+        if (x < y)
+            ++i;
+        else if (y < x)
+            ++j;
+        else
+        {
+            intersect(a.containers.at(i), b.containers.at(j), c);
+
+            if (c.count)
+            {
+                result.containers.append(c);
+                result.total += c.count;
+            }
+
+            ++i;
+            ++j;
+        }
+    }
+}
+
+void PostingList::intersect(QVector<const PostingList *> lists, PostingList &result)
+{
+    result.clear();
+
+    if (lists.isEmpty())
+        return;
+
+    // smallest first, the intermediate results only shrink
+    for (int i = 1; i < lists.count(); ++i)
+    {
+        for (int j = i; j > 0 && lists.at(j)->count() < lists.at(j - 1)->count(); --j)
+            qSwap(lists[j], lists[j - 1]);
+    }
+
+    result = *lists.at(0);
+
+    PostingList next;
+    for (int i = 1; i < lists.count() && !result.isEmpty(); ++i)
+    {
+        intersect(result, *lists.at(i), next);
+        result = next;
+    }
+}
+
+//=====================================================================================================================================================================================================
+
+PacketIndex::PacketIndex()
+{
+    protocols.resize(PROTO_COUNT);
+}
+
+void PacketIndex::add(quint32 row, const IpAddress &sIP, const IpAddress &dIP, quint32 sPort, quint32 dPort, quint8 protocol)
+{
+    // a row at most once per list, so the lists stay sorted
+    if (!sIP.isNull())
+        ips[sIP].append(row);
+    if (!dIP.isNull() && dIP != sIP)
+        ips[dIP].append(row);
+
+    if (sPort < 65536)
+        ports[sPort].append(row);
+    if (dPort < 65536 && dPort != sPort)
+        ports[dPort].append(row);
+
+    protocols[protocol].append(row);
+}
+
+void PacketIndex::clear()
+{
+    ips.clear();
+    ports.clear();
+
+    for (int i = 0; i < protocols.count(); ++i)
+        protocols[i].clear();
+}
+
+const PostingList *PacketIndex::ip(const IpAddress &address) const
+{
+    QHash<IpAddress, PostingList>::const_iterator it = ips.constFind(address);
+    return it != ips.constEnd() ? &it.value() : 0;
+}
+
+const PostingList *PacketIndex::port(quint16 port) const
+{
+    QHash<quint16, PostingList>::const_iterator it = ports.constFind(port);
+    return it != ports.constEnd() ? &it.value() : 0;
+}
+
+const PostingList *PacketIndex::protocol(quint8 protocol) const
+{
+    return protocol < protocols.count() && !protocols.at(protocol).isEmpty() ? &protocols.at(protocol) : 0;
+}
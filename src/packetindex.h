@@ -0,0 +1,88 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PACKETINDEX_H
+#define PACKETINDEX_H
+
+#include <QVector>
+#include <QHash>
+
+#include "ipaddress.h"
+
+// sorted packet rows, compressed as in roaring bitmaps: rows with the same upper
+// 16 bits share a container, a sorted array of the lower 16 bits while small and
+// a 65536 bit bitmap when dense; rows are appended in increasing order only
+class PostingList
+{
+public:
+    PostingList();
+
+    void append(quint32 row);
+    void clear();
+
+    int count() const { return total; }
+    bool isEmpty() const { return total == 0; }
+
+    // appends the rows in increasing order
+    void rows(QVector<int> &rows) const;
+
+    // rows in all the lists, the smallest lists first
+    static void intersect(QVector<const PostingList *> lists, PostingList &result);
+
+private:
+    struct Container
+    {
+        quint16 key;                // upper 16 bits
+        int count;
+        QVector<quint16> array;     // lower 16 bits, sorted, while count <= ARRAY_MAX
+        QVector<quint64> bitmap;    // BITMAP_WORDS words otherwise
+    };
+
+    // an array of more values would be larger than the bitmap
+    enum { ARRAY_MAX = 4096, BITMAP_WORDS = 1024 };
+
+    QVector<Container> containers;
+    int total;
+
+    static void toBitmap(Container &c);
+    static void toArray(Container &c);
+    static void intersect(const Container &a, const Container &b, Container &result);
+    static void intersect(const PostingList &a, const PostingList &b, PostingList &result);
+};
+
+// posting lists of the stored packets by address, port and protocol, so the packets
+// behind an aggregate (user, host, application) are an index lookup and an intersection
+class PacketIndex
+{
+public:
+    PacketIndex();
+
+    void add(quint32 row, const IpAddress &sIP, const IpAddress &dIP, quint32 sPort, quint32 dPort, quint8 protocol);
+    void clear();
+
+    // 0 if no packet
+    const PostingList *ip(const IpAddress &address) const;
+    const PostingList *port(quint16 port) const;
+    const PostingList *protocol(quint8 protocol) const;
+
+private:
+    QHash<IpAddress, PostingList> ips;          // source or destination
+    QHash<quint16, PostingList> ports;          // source or destination
+    QVector<PostingList> protocols;             // by ProtocolId
+};
+
+#endif // PACKETINDEX_H
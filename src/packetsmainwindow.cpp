@@ -18,12 +18,15 @@
 #include "packetsmainwindow.h"
 
 PacketsMainWindow::PacketsMainWindow(QWidget *parent, CaptureThread *thread)
-    : QMainWindow(parent), thread(thread)
+    : QMainWindow(parent), thread(thread), receiving(false)
 {
     ui.setupUi(this);
 
-    ui.treeWidget->resizeColumnToContents(0);
-    ui.treeWidget->resizeColumnToContents(2);
+    model = new PacketsModel(this, &store);
+    ui.treeView->setModel(model);
+
+    ui.treeView->resizeColumnToContents(0);
+    ui.treeView->resizeColumnToContents(2);
 
     createMenu();
     createToolbars();
@@ -54,6 +57,13 @@ void PacketsMainWindow::moveEvent(QMoveEvent *event)
     oldPosition = event->oldPos();
 }
 
+void PacketsMainWindow::showEvent(QShowEvent *event)
+{
+    appendPending();
+
+    QMainWindow::showEvent(event);
+}
+
 void PacketsMainWindow::createMenu()
 {
     // menu
@@ -138,6 +148,28 @@ void PacketsMainWindow::createToolbars()
     onAutoScrollTriggered(Settings::packetsMainWindow.autoScroll);
     connect(autoScrollAct, SIGNAL(triggered(bool)), this, SLOT(onAutoScrollTriggered(bool)));
 
+    ui.toolBarView->addSeparator();
+
+    // display filter, over the stored packets without restarting the capture
+    filterEdit = new QLineEdit(this);
+    filterEdit->setMinimumWidth(250);
+    filterEdit->setToolTip(tr("Display filter, for example: tcp and port 80 and not ip 192.168.1.10\n"
+                              "Fields: ip, src, dst, user (address[/prefix]), port, sport, dport, length, vlan (== != < <= > >=),\n"
+                              "proto (name or number), flags (syn,ack,...), protocol names (arp, ip, ip6, icmp, tcp, udp, ...);\n"
+                              "combined with and, or, not and parentheses"));
+    ui.toolBarView->addWidget(filterEdit);
+    connect(filterEdit, SIGNAL(returnPressed()), this, SLOT(onApplyFilter()));
+
+    applyFilterAct = new QAction(tr("Apply filter"), this);
+    ui.toolBarView->addAction(applyFilterAct);
+    applyFilterAct->setEnabled(true);
+    connect(applyFilterAct, SIGNAL(triggered()), this, SLOT(onApplyFilter()));
+
+    clearFilterAct = new QAction(tr("Clear filter"), this);
+    ui.toolBarView->addAction(clearFilterAct);
+    clearFilterAct->setEnabled(true);
+    connect(clearFilterAct, SIGNAL(triggered()), this, SLOT(onClearFilter()));
+
     // help
     helpAct = new QAction(tr("Help"), this);
     helpAct->setEnabled(true);
@@ -237,6 +269,8 @@ void PacketsMainWindow::setToolbarIcons(int size)
     stopAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_stop.png")));
     clearAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_clear.png")));
     autoScrollAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_bottom.png")));
+    applyFilterAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_filter.png")));
+    clearFilterAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_clear.png")));
 
     // help
     helpAct->setIcon(QIcon(QString(":/images/"+QString::number(size)+"_help.png")));
@@ -314,7 +348,8 @@ void PacketsMainWindow::onExportData()
 
 void PacketsMainWindow::onStart()
 {
-    connect(thread, SIGNAL(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)), this, SLOT(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)), Qt::QueuedConnection);
+    connect(thread, SIGNAL(receivedPacket(Packet)), this, SLOT(receivedPacket(Packet)), Qt::QueuedConnection);
+    receiving = true;
     startAct->setDisabled(true);
     ui.actionStart->setDisabled(true);
     stopAct->setEnabled(true);
@@ -323,7 +358,8 @@ void PacketsMainWindow::onStart()
 
 void PacketsMainWindow::onStop()
 {
-    disconnect(thread, SIGNAL(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)), this, SLOT(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)));
+    disconnect(thread, SIGNAL(receivedPacket(Packet)), this, SLOT(receivedPacket(Packet)));
+    receiving = false;
     startAct->setEnabled(true);
     ui.actionStart->setEnabled(true);
     stopAct->setDisabled(true);
@@ -343,7 +379,7 @@ void PacketsMainWindow::onAutoScrollTriggered(bool checked)
     autoScrollAct->setChecked(checked);
 
     if (checked)
-        ui.treeWidget->scrollToBottom();
+        ui.treeView->scrollToBottom();
 }
 
 void PacketsMainWindow::toggleAlwaysOnTop(bool checked)
@@ -352,49 +388,155 @@ void PacketsMainWindow::toggleAlwaysOnTop(bool checked)
     show();
 }
 
-void PacketsMainWindow::receivedPacket(const QString &time, quint32 length, const QString &sMac, const QString &dMac, quint16 type, quint32 sIP, quint32 dIP, quint32 sPort, quint32 dPort, const QString &info)
+void PacketsMainWindow::receivedPacket(const Packet &packet)
 {
-    if (type == 0x0806) { typeStr = "ARP"; goto end; }
-    if (type == 0x8035) { typeStr = "RARP"; goto end; }
-    if (type == 6) { typeStr = "IPv4 TCP"; goto end; }
-    if (type == 17) { typeStr = "IPv4 UDP"; goto end; }
-    if (type == 1) { typeStr = "IPv4 ICMP"; goto end; }
-    if (type == 2) { typeStr = "IPv4 IGMP"; goto end; }
-
-    if (type == 0x0842) { typeStr = "WOL"; goto end; }
-    if (type == 0x86DD) { typeStr = "IPv6"; goto end; }
-    if (type == 0x8137) { typeStr = "IPX"; goto end; }
-    if (type == 0x8863) { typeStr = "PPoE"; goto end; }
-    if (type == 0x8864) { typeStr = "PPoE"; goto end; }
-
-    typeStr = "protocol not supported";
-
-    end:
-    sAddrIP.S_un.S_addr = sIP;
-    dAddrIP.S_un.S_addr = dIP;
-    ui.treeWidget->addTopLevelItem( new QTreeWidgetItem(QStringList()
-                                                        << QString::number(++packetsNo)
-                                                        << time
-                                                        << QString::number(length)
-                                                        << sMac
-                                                        << dMac
-                                                        << typeStr
-                                                        << inet_ntoa(sAddrIP)
-                                                        << (sPort < 65536 ? QString::number(sPort) : "")
-                                                        << inet_ntoa(dAddrIP)
-                                                        << (dPort < 65536 ? QString::number(dPort) : "")
-                                                        << info) );
-    infoLabel->setText(tr("Packets: %1").arg(packetsNo));
+    store.append(packet);
+
+    // the view is not updated while hidden, only the store and its index
+    if (isVisible())
+        appendPending();
+}
+
+void PacketsMainWindow::appendPending()
+{
+    if (pendingRow >= store.count())
+        return;
+
+    if (displayFilter.isEmpty())
+    {
+        model->appendAll();
+    }
+    else
+    {
+        // a batch of the new rows, the same program as for the stored packets
+        matchedRows.clear();
+        displayFilter.filter(store, pendingRow, store.count(), matchedRows);
+        model->appendRows(matchedRows);
+    }
+
+    pendingRow = store.count();
+
+    showPacketsCount();
 
     if (autoScroll)
-        ui.treeWidget->scrollToBottom();
+        ui.treeView->scrollToBottom();
 }
 
 void PacketsMainWindow::clearTree()
 {
-    packetsNo = 0;
-    ui.treeWidget->clear();
-    infoLabel->setText(tr("Packets: 0"));
+    store.clear();
+    model->clear();
+    pendingRow = 0;
+    showPacketsCount();
+}
+
+void PacketsMainWindow::setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6)
+{
+    store.setData(netMask, pcIP, localIPv6);
+}
+
+// drill-down from the aggregate views, index lookups and an intersection instead of a scan;
+// the store has only the packets received since Start, if not started it starts now
+void PacketsMainWindow::showPackets(const IpAddress &ip, const IpAddress &other, quint32 port)
+{
+    QVector<const PostingList *> lists;
+    QStringList tests;
+    bool found = true;
+    bool history = receiving;
+
+    if (!receiving)
+        onStart();
+
+    tests << "ip " + ip.toString();
+    lists.append(store.index.ip(ip));
+
+    if (!other.isNull())
+    {
+        tests << "ip " + other.toString();
+        lists.append(store.index.ip(other));
+    }
+
+    if (port < 65536)
+    {
+        tests << "port " + QString::number(port);
+        lists.append(store.index.port(port));
+    }
+
+    for (int i = 0; i < lists.count(); ++i)
+        found &= lists.at(i) != 0;
+
+    QTime time;
+    time.start();
+
+    matchedRows.clear();
+    if (found)
+    {
+        PostingList rows;
+        PostingList::intersect(lists, rows);
+        rows.rows(matchedRows);
+    }
+
+    // the same as a display filter, so the new packets are shown too
+    filterEdit->setText(tests.join(" and "));
+    displayFilter.compile(filterEdit->text());
+    model->showRows(matchedRows);
+    pendingRow = store.count();
+
+    showPacketsCount();
+
+    if (history)
+        ui.statusbar->showMessage(tr("Display filter: %1 of %2 packets in %3 ms").arg(matchedRows.count()).arg(store.count()).arg(time.elapsed()), 5000);
+    else
+        ui.statusbar->showMessage(tr("No packets were stored before, the packets matching the display filter are shown from now on"));
+}
+
+void PacketsMainWindow::showPacketsCount()
+{
+    if (model->isFiltered())
+        infoLabel->setText(tr("Packets: %1, displayed: %2").arg(store.count()).arg(model->rowCount()));
+    else
+        infoLabel->setText(tr("Packets: %1").arg(store.count()));
+}
+
+void PacketsMainWindow::onApplyFilter()
+{
+    QString error;
+
+    if (!displayFilter.compile(filterEdit->text(), &error))
+    {
+        QMessageBox::warning(this, tr("Warning"), tr("Invalid display filter: %1").arg(error));
+        return;
+    }
+
+    if (displayFilter.isEmpty())
+    {
+        onClearFilter();
+        return;
+    }
+
+    QTime time;
+    time.start();
+
+    matchedRows.clear();
+    displayFilter.filter(store, 0, store.count(), matchedRows);
+    model->showRows(matchedRows);
+    pendingRow = store.count();
+
+    showPacketsCount();
+    ui.statusbar->showMessage(tr("Display filter: %1 of %2 packets in %3 ms").arg(matchedRows.count()).arg(store.count()).arg(time.elapsed()), 5000);
+
+    if (autoScroll)
+        ui.treeView->scrollToBottom();
+}
+
+void PacketsMainWindow::onClearFilter()
+{
+    displayFilter.clear();
+    filterEdit->clear();
+
+    model->showAll();
+    pendingRow = store.count();
+    showPacketsCount();
 }
 
 void PacketsMainWindow::showHelp()
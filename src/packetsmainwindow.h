@@ -22,14 +22,20 @@
 
 #include <QResizeEvent>
 #include <QMoveEvent>
+#include <QShowEvent>
 #include <QLabel>
 #include <QDesktopServices>
 #include <QMessageBox>
 #include <QUrl>
+#include <QLineEdit>
+#include <QTime>
 
 #include "aboutdialog.h"
 #include "capturethread.h"
 #include "settings.h"
+#include "packetstore.h"
+#include "packetsmodel.h"
+#include "displayfilter.h"
 
 class PacketsMainWindow : public QMainWindow
 {
@@ -43,9 +49,15 @@ public:
     void clearTree();
     void writeSettings();
 
+    void setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6);
+
+    // packets of an address, optionally with another address and a port (65536 any)
+    void showPackets(const IpAddress &ip, const IpAddress &other = IpAddress(), quint32 port = 65536);
+
 protected:
     virtual void resizeEvent(QResizeEvent *event);
     virtual void moveEvent(QMoveEvent *event);
+    virtual void showEvent(QShowEvent *event);
 
 private:
     Ui::PacketsMainWindowClass ui;
@@ -55,10 +67,13 @@ private:
 
     CaptureThread *thread;
 
-    quint64 packetsNo;
-    QString typeStr;
-
-    struct in_addr sAddrIP, dAddrIP;
+    // captured packets, the view shows all of them or the display filter matches
+    PacketStore store;
+    PacketsModel *model;
+    DisplayFilter displayFilter;
+    QVector<int> matchedRows;
+    int pendingRow;         // first row of the store not given to the model yet, packets are only stored while hidden
+    bool receiving;         // started, the store is filled only from then on
 
     bool autoScroll;
 
@@ -75,6 +90,9 @@ private:
     QAction *stopAct;
     QAction *clearAct;
     QAction *autoScrollAct;
+    QLineEdit *filterEdit;
+    QAction *applyFilterAct;
+    QAction *clearFilterAct;
 
     // help
     QMenu *helpActMenu;
@@ -89,18 +107,11 @@ private:
     void setToolbarIcons(int size);
     void createStatusBar();
     void restoreWindowState();
+    void showPacketsCount();
+    void appendPending();
 
 private slots:
-    void receivedPacket(const QString &time,
-                        quint32 length,
-                        const QString &sMac,
-                        const QString &dMac,
-                        quint16 type,
-                        quint32 sIP,
-                        quint32 dIP,
-                        quint32 sPort,
-                        quint32 dPort,
-                        const QString &info);
+    void receivedPacket(const Packet &packet);
 
     void onExportData();
 
@@ -108,6 +119,8 @@ private slots:
     void onStop();
     void onClear();
     void onAutoScrollTriggered(bool checked);
+    void onApplyFilter();
+    void onClearFilter();
 
     void onChangeMovable(bool movable);
     void onToolbarsStyleChanged(QAction *action);
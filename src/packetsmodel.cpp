@@ -0,0 +1,142 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "packetsmodel.h"
+
+PacketsModel::PacketsModel(QObject *parent, const PacketStore *store)
+    : QAbstractTableModel(parent), store(store)
+{
+    filtered = false;
+    shown = 0;
+}
+
+int PacketsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return filtered ? rows.count() : shown;
+}
+
+int PacketsModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return 11;
+}
+
+QVariant PacketsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole)
+        return QVariant();
+
+    int row = storeRow(index.row());
+
+    switch (index.column())
+    {
+        case 0: return QString::number(row + 1);
+        case 1: return store->time.at(row);
+        case 2: return QString::number(store->length.at(row));
+        case 3: return store->sMac.at(row);
+        case 4: return store->dMac.at(row);
+        case 5: return store->typeName(row);
+        case 6: return store->sIP.at(row).toString();
+        case 7: return store->sPort.at(row) < 65536 ? QString::number(store->sPort.at(row)) : QString();
+        case 8: return store->dIP.at(row).toString();
+        case 9: return store->dPort.at(row) < 65536 ? QString::number(store->dPort.at(row)) : QString();
+        case 10: return store->info.at(row);
+        default: return QVariant();
+    }
+}
+
+QVariant PacketsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal)
+        return QVariant();
+
+    // the view itself does not antialias
+    if (role == Qt::FontRole)
+    {
+        QFont font;
+        font.setStyleStrategy(QFont::PreferAntialias);
+        return font;
+    }
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section)
+    {
+        case 0: return tr("No.");
+        case 1: return tr("Time");
+        case 2: return tr("Length");
+        case 3: return tr("Source MAC");
+        case 4: return tr("Destination MAC");
+        case 5: return tr("Type");
+        case 6: return tr("Source IP");
+        case 7: return tr("Source port");
+        case 8: return tr("Destination IP");
+        case 9: return tr("Destination port");
+        case 10: return tr("Information");
+        default: return QVariant();
+    }
+}
+
+void PacketsModel::showAll()
+{
+    filtered = false;
+    rows.clear();
+    shown = store->count();
+    reset();
+}
+
+void PacketsModel::showRows(const QVector<int> &rows)
+{
+    filtered = true;
+    this->rows = rows;
+    shown = 0;
+    reset();
+}
+
+void PacketsModel::appendAll()
+{
+    if (filtered || shown >= store->count())
+        return;
+
+    beginInsertRows(QModelIndex(), shown, store->count() - 1);
+    shown = store->count();
+    endInsertRows();
+}
+
+void PacketsModel::appendRows(const QVector<int> &rows)
+{
+    if (!filtered || rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), this->rows.count(), this->rows.count() + rows.count() - 1);
+    for (int i = 0; i < rows.count(); ++i)
+        this->rows.append(rows.at(i));
+    endInsertRows();
+}
+
+void PacketsModel::clear()
+{
+    rows.clear();
+    shown = 0;
+    reset();
+}
@@ -0,0 +1,64 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PACKETSMODEL_H
+#define PACKETSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFont>
+#include <QVector>
+
+#include "packetstore.h"
+
+// table of the stored packets for PacketsMainWindow, all of them or the rows
+// matched by a display filter; cells are formatted only when shown
+class PacketsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PacketsModel)
+
+public:
+    explicit PacketsModel(QObject *parent = 0, const PacketStore *store = 0);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // all packets of the store
+    void showAll();
+    // only the given rows of the store, in order
+    void showRows(const QVector<int> &rows);
+
+    // packets appended to the store, all shown or only the matching rows
+    void appendAll();
+    void appendRows(const QVector<int> &rows);
+
+    void clear();
+
+    bool isFiltered() const { return filtered; }
+    int storeRow(int row) const { return filtered ? rows.at(row) : row; }
+
+private:
+    const PacketStore *store;
+
+    bool filtered;
+    QVector<int> rows;
+    int shown;              // rows of the store shown if not filtered
+};
+
+#endif // PACKETSMODEL_H
@@ -0,0 +1,131 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "packetstore.h"
+
+PacketStore::PacketStore()
+{
+    // no local network until setData()
+    netMask = 0xffffffff;
+    pcIP = 0;
+}
+
+void PacketStore::setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6)
+{
+    this->netMask = netMask;
+    this->pcIP = pcIP;
+    this->localIPv6 = localIPv6;
+}
+
+void PacketStore::append(const Packet &packet)
+{
+    index.add(count(), packet.sIP, packet.dIP, packet.sPort, packet.dPort, packet.protocol);
+
+    length.append(packet.length);
+    protocol.append(packet.protocol);
+    ipProto.append(packet.ipProto);
+    tcpFlags.append(packet.tcpFlags);
+    vlan.append(packet.vlan);
+    sPort.append(packet.sPort);
+    dPort.append(packet.dPort);
+    sIP.append(packet.sIP);
+    dIP.append(packet.dIP);
+
+    if (isLocal(packet.sIP))
+        user.append(packet.sIP);
+    else if (isLocal(packet.dIP))
+        user.append(packet.dIP);
+    else
+        user.append(IpAddress());
+
+    time.append(packet.time);
+    sMac.append(packet.sMac);
+    dMac.append(packet.dMac);
+    innerVlan.append(packet.innerVlan);
+    encapsulation.append(packet.encapsulation);
+    info.append(packet.info);
+}
+
+void PacketStore::clear()
+{
+    length.clear();
+    protocol.clear();
+    ipProto.clear();
+    tcpFlags.clear();
+    vlan.clear();
+    sPort.clear();
+    dPort.clear();
+    sIP.clear();
+    dIP.clear();
+    user.clear();
+
+    time.clear();
+    sMac.clear();
+    dMac.clear();
+    innerVlan.clear();
+    encapsulation.clear();
+    info.clear();
+
+    index.clear();
+}
+
+QString PacketStore::typeName(int row) const
+{
+    QString typeStr = Dissectors::name(protocol.at(row));
+    quint8 encap = encapsulation.at(row);
+
+    // encapsulation layers
+    if (encap)
+    {
+        typeStr.append(" (");
+
+        if (encap & ENCAP_QINQ)
+            typeStr.append(QString("VLAN %1/%2 ").arg(vlan.at(row)).arg(innerVlan.at(row)));
+        else if (encap & ENCAP_VLAN)
+            typeStr.append(QString("VLAN %1 ").arg(vlan.at(row)));
+
+        if (encap & ENCAP_MPLS)
+            typeStr.append("MPLS ");
+
+        if (encap & ENCAP_PPPOE)
+            typeStr.append("PPPoE ");
+
+        typeStr[typeStr.length() - 1] = ')';
+    }
+
+    return typeStr;
+}
+
+bool PacketStore::isLocal(const IpAddress &ip) const
+{
+    if (ip.isIPv4())
+        return ((ip.toIPv4() ^ pcIP) & netMask) == 0 && !ip.isMulticast();
+
+    if (ip.isIPv6())
+    {
+        if (ip.isLinkLocal())
+            return true;
+
+        for (int i = 0; i < localIPv6.count(); ++i)
+        {
+            if (ip.samePrefix(localIPv6.at(i), 64))
+                return true;
+        }
+    }
+
+    return false;
+}
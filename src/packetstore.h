@@ -0,0 +1,75 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PACKETSTORE_H
+#define PACKETSTORE_H
+
+#include <QVector>
+#include <QList>
+#include <QString>
+
+#include "capturethread.h"
+#include "packetindex.h"
+
+// captured packets for PacketsMainWindow, one array per field (columns), so display
+// filters run over contiguous values instead of per packet records
+class PacketStore
+{
+public:
+    PacketStore();
+
+    // local network, to know the user side of a packet (as ReceiverCore::checkIP)
+    void setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6);
+
+    void append(const Packet &packet);
+    void clear();
+
+    int count() const { return length.size(); }
+
+    QString typeName(int row) const;
+
+    // filtered columns
+    QVector<quint32> length;
+    QVector<quint8> protocol;       // ProtocolId
+    QVector<quint8> ipProto;
+    QVector<quint8> tcpFlags;
+    QVector<quint16> vlan;
+    QVector<quint32> sPort;         // 65536 if none
+    QVector<quint32> dPort;
+    QVector<IpAddress> sIP;
+    QVector<IpAddress> dIP;
+    QVector<IpAddress> user;        // local side of the packet, null if none
+
+    // rows by address, port and protocol
+    PacketIndex index;
+
+    // displayed only
+    QVector<QString> time;
+    QVector<QString> sMac;
+    QVector<QString> dMac;
+    QVector<quint16> innerVlan;
+    QVector<quint8> encapsulation;
+    QVector<QString> info;
+
+private:
+    quint32 netMask, pcIP;
+    QList<IpAddress> localIPv6;
+
+    bool isLocal(const IpAddress &ip) const;
+};
+
+#endif // PACKETSTORE_H
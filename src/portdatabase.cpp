@@ -0,0 +1,215 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "portdatabase.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <QtAlgorithms>
+
+PortTable::PortTable()
+{
+    fileSize = -1;
+    tableGeneration = 0;
+}
+
+bool PortTable::load(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        this->error = file.errorString();
+        if (error)
+            *error = this->error;
+        return false;
+    }
+
+    QFileInfo info(file);
+    fileModified = info.lastModified();
+    fileSize = info.size();
+
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+
+    QString line;
+    Entry entry;
+    bool ok;
+
+    while (!in.atEnd())
+    {
+        line = in.readLine();
+
+        // "tcp 80=description", other lines are skipped
+        int equals = line.indexOf('=', 4);
+        if (equals < 0)
+            continue;
+
+        uint port = line.mid(4, equals - 4).trimmed().toUInt(&ok);
+        if (!ok || port > 65535)
+            continue;
+
+        QString description = line.mid(equals + 1).simplified();
+
+        entry.offset = descriptions.length();
+        entry.length = (quint16)qMin(description.length(), 65535);
+        entry.port = port;
+        entry.protocol = line.left(3).compare("udp", Qt::CaseInsensitive) == 0 ? PROTOCOL_UDP : PROTOCOL_TCP;
+
+        descriptions.append(description.left(entry.length));
+        entries.append(entry);
+    }
+
+    file.close();
+
+    // stable, the first entry of a port is still the first one in the file
+    qStableSort(entries.begin(), entries.end(), portLessThan);
+
+    index.fill(0, 65537);
+    for (int i = 0; i < entries.count(); ++i)
+        ++index[entries.at(i).port + 1];
+    for (int port = 1; port <= 65536; ++port)
+        index[port] += index.at(port - 1);
+
+    entries.squeeze();
+    descriptions.squeeze();
+
+    return true;
+}
+
+QString PortTable::name(quint16 port) const
+{
+    if (index.isEmpty() || index.at(port) == index.at(port + 1))
+        return QString();
+
+    return description(index.at(port));
+}
+
+//=====================================================================================================================================================================================================
+
+PortDatabase::PortDatabase(QObject *parent, const QString &fileName)
+    : QObject(parent), file(fileName)
+{
+    if (file.isEmpty())
+        file = QCoreApplication::applicationDirPath() + "/ports.txt";
+
+    current = 0;
+
+    // an editor may write the file in parts or replace it, changes are reloaded once they settle
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(500);
+    connect(reloadTimer, SIGNAL(timeout()), this, SLOT(reload()));
+
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, SIGNAL(fileChanged(QString)), this, SLOT(fileChanged()));
+    connect(watcher, SIGNAL(directoryChanged(QString)), this, SLOT(fileChanged()));
+    watch();
+}
+
+// the directory too, the file is dropped from the watcher when it is replaced or is not there yet
+void PortDatabase::watch()
+{
+    QString directory = QFileInfo(file).absolutePath();
+
+    if (!watcher->directories().contains(directory))
+        watcher->addPath(directory);
+
+    if (!watcher->files().contains(file) && QFile::exists(file))
+        watcher->addPath(file);
+}
+
+QSharedPointer<const PortTable> PortDatabase::snapshot()
+{
+    QSharedPointer<const PortTable> loaded;
+    QString error;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (!table.isNull())
+            return table;
+
+        // an empty table if the file cannot be read, reload() tries again when it changes
+        PortTable *newTable = new PortTable();
+        newTable->load(file, &error);
+        newTable->tableGeneration = 1;
+
+        table = QSharedPointer<const PortTable>(newTable);
+        current = 1;
+        loaded = table;
+    }
+
+    if (!error.isEmpty())
+    {
+        // 2 - warning
+        emit infoMessage(2, tr("Port numbers"), tr("Unable to open port numbers file: %1. Application names not available.").arg(error));
+    }
+
+    return loaded;
+}
+
+void PortDatabase::fileChanged()
+{
+    watch();
+    reloadTimer->start();
+}
+
+void PortDatabase::reload()
+{
+    watch();
+
+    QSharedPointer<const PortTable> old;
+    {
+        QMutexLocker locker(&mutex);
+        old = table;
+    }
+
+    // not loaded yet, the first snapshot() reads the file
+    if (old.isNull())
+        return;
+
+    QFileInfo info(file);
+    if (!info.exists() || (info.lastModified() == old->modified() && info.size() == old->size()))
+        return;
+
+    PortTable *newTable = new PortTable();
+    QString error;
+
+    if (!newTable->load(file, &error))
+    {
+        // readers keep the table they have
+        delete newTable;
+
+        // 2 - warning
+        emit infoMessage(2, tr("Port numbers"), tr("Unable to reload port numbers file: %1").arg(error));
+        return;
+    }
+
+    newTable->tableGeneration = old->generation() + 1;
+
+    {
+        QMutexLocker locker(&mutex);
+        table = QSharedPointer<const PortTable>(newTable);
+        current = newTable->tableGeneration;
+    }
+
+    // 1 - information
+    emit logMessage(1, tr("Port numbers reloaded"), tr("%1 entries from %2").arg(newTable->count()).arg(file));
+}
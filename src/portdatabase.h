@@ -0,0 +1,133 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PORTDATABASE_H
+#define PORTDATABASE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// ports.txt parsed once, "tcp 80=description" lines ordered by port number and
+// in file order within a port; the descriptions are kept in one string and the
+// entries of a port are found through the index of the first entry of each port;
+// never changed after load(), so it is read from any thread without locking
+class PortTable
+{
+public:
+    enum Protocol { PROTOCOL_TCP = 0, PROTOCOL_UDP = 1 };
+
+    PortTable();
+
+    bool load(const QString &fileName, QString *error);
+
+    int count() const { return entries.count(); }
+
+    quint16 port(int i) const { return entries.at(i).port; }
+    quint8 protocol(int i) const { return entries.at(i).protocol; }
+    QString protocolName(int i) const { return entries.at(i).protocol == PROTOCOL_UDP ? "udp" : "tcp"; }
+    QString description(int i) const { return descriptions.mid(entries.at(i).offset, entries.at(i).length); }
+
+    // entries of the port are first(port) up to first(port + 1)
+    int first(int port) const { return index.isEmpty() ? 0 : index.at(port); }
+
+    // description of the first entry of the port, empty if the port is not listed
+    QString name(quint16 port) const;
+
+    // of the file the table was loaded from, empty if it could not be read
+    QString errorString() const { return error; }
+    QDateTime modified() const { return fileModified; }
+    qint64 size() const { return fileSize; }
+
+    int generation() const { return tableGeneration; }
+
+private:
+    struct Entry
+    {
+        quint32 offset;     // in descriptions
+        quint16 length;
+        quint16 port;
+        quint8 protocol;
+    };
+
+    QVector<Entry> entries;
+    QString descriptions;
+    QVector<qint32> index;  // 65537 entries, the last one is count()
+
+    QString error;
+    QDateTime fileModified;
+    qint64 fileSize;
+
+    int tableGeneration;
+
+    static bool portLessThan(const Entry &a, const Entry &b) { return a.port < b.port; }
+
+    friend class PortDatabase;
+};
+
+// the port table shared by ReceiverCore and PortNumbersDialog; readers keep a
+// snapshot and compare generation() with the one of their table, a new table is
+// swapped in when the file changes and the old one is freed with its last reader;
+// the file is read on the first snapshot(), the object lives in the GUI thread
+class PortDatabase : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PortDatabase)
+
+public:
+    explicit PortDatabase(QObject *parent = 0, const QString &fileName = QString());
+
+    QString fileName() const { return file; }
+
+    // the current table, loaded if it was not yet; safe from any thread
+    QSharedPointer<const PortTable> snapshot();
+
+    // 0 until the table is loaded
+    int generation() const { return current; }
+
+public slots:
+    // a new table if the file changed since the current one was loaded
+    void reload();
+
+private:
+    QString file;
+
+    QMutex mutex;
+    QSharedPointer<const PortTable> table;
+    QAtomicInt current;
+
+    QFileSystemWatcher *watcher;
+    QTimer *reloadTimer;
+
+    void watch();
+
+private slots:
+    void fileChanged();
+
+signals:
+    void infoMessage(quint8 type, const QString &title, const QString &message);
+    // only for the events viewer, without a message box
+    void logMessage(quint8 type, const QString &title, const QString &message);
+};
+
+#endif // PORTDATABASE_H
@@ -17,57 +17,35 @@
 
 #include "portnumbersdialog.h"
 
-class MyColumnTreeWidgetItem : public QTreeWidgetItem
-{
-public:
-    MyColumnTreeWidgetItem(QTreeWidget *parent) : QTreeWidgetItem(parent)
-    {
-    }
-
-    MyColumnTreeWidgetItem(QTreeWidget *parent, const QStringList &strings) : QTreeWidgetItem (parent, strings)
-    {
-    }
-
-private:
-    bool operator< (const QTreeWidgetItem &other) const
-    {
-        int sortCol = treeWidget()->sortColumn();
-        if (sortCol == 1)
-        {
-            int myNumber = text(sortCol).toInt();
-            int otherNumber = other.text(sortCol).toInt();
-            return myNumber < otherNumber;
-        }
-        else
-        {
-            return text(sortCol) < other.text(sortCol);
-        }
-    }
-};
-
-PortNumbersDialog::PortNumbersDialog(QWidget *parent)
-    : QDialog(parent)
+PortNumbersDialog::PortNumbersDialog(QWidget *parent, PortDatabase *portDatabase)
+    : QDialog(parent), portDatabase(portDatabase)
 {
     QDialog::setWindowFlags(Qt::Dialog | Qt::WindowMinimizeButtonHint | Qt::WindowMaximizeButtonHint);
 
     ui.setupUi(this);
 
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortByColumn(1, Qt::AscendingOrder);
-    ui.treeWidget->clear();
+    model = new PortNumbersModel(this);
+    ui.treeView->setModel(model);
 
     modified = false;
 
     readPorts();
 
+    ui.treeView->setSortingEnabled(true);
+    ui.treeView->sortByColumn(1, Qt::AscendingOrder);
+    showRow(0);
+
     createConnections();
 
     ui.lineEdit->setFocus();
+
+    // built while the user starts typing, not before the dialog is shown
+    QTimer::singleShot(100, model, SLOT(updateIndex()));
 }
 
 void PortNumbersDialog::keyPressEvent(QKeyEvent *event)
 {
-    if (ui.treeWidget->hasFocus())
+    if (ui.treeView->hasFocus())
     {
         if (event->key() == Qt::Key_Delete)
         {
@@ -105,88 +83,50 @@ void PortNumbersDialog::createConnections()
 
     connect(ui.pushButtonShortHelp, SIGNAL(clicked()), this, SLOT(onShowShortHelp()));
 
-    connect(ui.treeWidget, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)), this, SLOT(onCurrentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)));
-    connect(ui.treeWidget, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(onItemDoubleClicked(QTreeWidgetItem*,int)));
-    connect(ui.treeWidget, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(onItemDoubleClicked(QTreeWidgetItem*,int)));
-    connect(ui.treeWidget, SIGNAL(itemChanged(QTreeWidgetItem*,int)), this, SLOT(onItemChanged(QTreeWidgetItem*,int)));
+    connect(ui.treeView->selectionModel(), SIGNAL(currentChanged(QModelIndex,QModelIndex)), this, SLOT(onCurrentChanged(QModelIndex,QModelIndex)));
+    connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(onDataChanged()));
+    connect(model, SIGNAL(invalidValue(int)), this, SLOT(onInvalidValue(int)));
     connect(ui.lineEdit, SIGNAL(textChanged(QString)), this, SLOT(onTextChanged(QString)));
 }
 
+// the table already parsed for the receiver core, the file is read here only if nothing has read it yet
 void PortNumbersDialog::readPorts()
 {
-    QFile file(QCoreApplication::applicationDirPath() + "/ports.txt");
-
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        QMessageBox::critical(0, tr("Critical"), tr("Unable to open ports file:\n%1").arg(file.errorString()));
-        return;
-    }
-
-    QTextStream in(&file);
-    in.setCodec("UTF-8");
-
-    ui.treeWidget->setSortingEnabled(false);
+    QSharedPointer<const PortTable> ports = portDatabase->snapshot();
 
-    QString line;
-    int i = 0;
+    if (!ports->errorString().isEmpty())
+        QMessageBox::critical(0, tr("Critical"), tr("Unable to open ports file:\n%1").arg(ports->errorString()));
 
-    while (!in.atEnd())
-    {
-        line = in.readLine();
-
-        ui.treeWidget->addTopLevelItem(new MyColumnTreeWidgetItem(ui.treeWidget, QStringList() << line.left(3) << line.mid(4, line.indexOf("=", 0) - 4) << line.right(line.length() - line.indexOf("=", 3) -1).simplified()));
-        ui.treeWidget->topLevelItem(i)->setFlags(ui.treeWidget->topLevelItem(i)->flags() | Qt::ItemIsEditable);
-
-        ++i;
-    }
-
-    ui.treeWidget->setSortingEnabled(true);
-
-    ui.treeWidget->setCurrentItem(ui.treeWidget->topLevelItem(0));
-
-    file.close();
+    model->setTable(ports);
 }
 
+// the port database reloads the file when it sees the change
 void PortNumbersDialog::writePorts()
 {
-    QFile file(QCoreApplication::applicationDirPath() + "/ports.txt");
+    QString error;
 
-    if (!file.open(QIODevice::WriteOnly))
+    if (!model->save(portDatabase->fileName(), &error))
     {
-        QMessageBox::critical(this, tr("Critical"), tr("Unable to save ports file:\n%1").arg(file.errorString()));
+        QMessageBox::critical(this, tr("Critical"), tr("Unable to save ports file:\n%1").arg(error));
         return;
     }
 
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-
-    // save sorting settings
-    int sortColumn = ui.treeWidget->sortColumn();
-    Qt::SortOrder sortOrder = ui.treeWidget->header()->sortIndicatorOrder();
-
-    // sorting by port number and writing to file
-
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortByColumn(1, Qt::AscendingOrder);
-    ui.treeWidget->setSortingEnabled(false);
-
-    for (int i = 0; i < ui.treeWidget->topLevelItemCount(); ++i)
-    {
-        out << ui.treeWidget->topLevelItem(i)->text(0).toLower() << " " << ui.treeWidget->topLevelItem(i)->text(1) << "=" << ui.treeWidget->topLevelItem(i)->text(2).simplified() << "\r\n";
-    }
+    modified = true;
+}
 
-    // restore sorting settings
-    ui.treeWidget->setSortingEnabled(true);
-    ui.treeWidget->sortByColumn(sortColumn, sortOrder);
+void PortNumbersDialog::showRow(int row)
+{
+    if (row < 0 || row >= model->rowCount())
+        return;
 
-    file.close();
-    
-    modified = true;
+    QModelIndex index = model->index(row, 0);
+    ui.treeView->setCurrentIndex(index);
+    ui.treeView->scrollTo(index);
 }
 
-void PortNumbersDialog::onCurrentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous)
+void PortNumbersDialog::onCurrentChanged(const QModelIndex &current, const QModelIndex &previous)
 {
-    if (current != 0)
+    if (current.isValid())
         ui.pushButtonDelete->setEnabled(true);
     else
         ui.pushButtonDelete->setDisabled(true);
@@ -201,34 +141,26 @@ void PortNumbersDialog::onSave()
 
 void PortNumbersDialog::onAddNew()
 {
-    QTreeWidgetItem *currentItem = ui.treeWidget->currentItem();
+    showRow(model->addRow(ui.treeView->currentIndex().row()));
 
-    if (currentItem != 0)
-    {
-        MyColumnTreeWidgetItem *item = new MyColumnTreeWidgetItem(ui.treeWidget, QStringList() << currentItem->text(0) << currentItem->text(1) << currentItem->text(2));
-        ui.treeWidget->addTopLevelItem(item);
-        item->setFlags(item->flags() | Qt::ItemIsEditable);
-    }
-    else
-    {
-        MyColumnTreeWidgetItem *item = new MyColumnTreeWidgetItem(ui.treeWidget, QStringList() << "tcp" << "0" << "");
-        ui.treeWidget->addTopLevelItem(item);
-        item->setFlags(item->flags() | Qt::ItemIsEditable);
-    }
+    ui.pushButtonSave->setEnabled(true);
 }
 
 void PortNumbersDialog::onDelete()
 {
-    if (ui.treeWidget->takeTopLevelItem(ui.treeWidget->indexOfTopLevelItem(ui.treeWidget->currentItem())) != 0)
+    if (model->deleteRow(ui.treeView->currentIndex().row()))
         ui.pushButtonSave->setEnabled(true);
 }
 
+// search as you type, the current row is kept while it still matches
 void PortNumbersDialog::onTextChanged(const QString &text)
 {
     if (text != "")
     {
         ui.pushButtonSearch->setEnabled(true);
         ui.pushButtonSearch->setDefault(true);
+
+        showRow(model->find(text, ui.treeView->currentIndex().row()));
     }
     else
     {
@@ -237,85 +169,24 @@ void PortNumbersDialog::onTextChanged(const QString &text)
     }
 }
 
+// the next match
 void PortNumbersDialog::onSearch()
 {
-    QString str = ui.lineEdit->text();
-    bool ok;
-    int x, i;
-
-    x = str.toInt(&ok, 10);
-
-    if (!ok || x < 0 || x > 65535) // search description
-    {
-        for (i = ui.treeWidget->indexOfTopLevelItem(ui.treeWidget->currentItem()) + 1; i < ui.treeWidget->topLevelItemCount(); ++i)
-            if (ui.treeWidget->topLevelItem(i)->text(2).contains(str, Qt::CaseInsensitive))
-            {
-                ui.treeWidget->setCurrentItem(ui.treeWidget->topLevelItem(i));
-                return;
-            }
-
-        for (i = 0; i < ui.treeWidget->topLevelItemCount(); ++i)
-            if (ui.treeWidget->topLevelItem(i)->text(2).contains(str, Qt::CaseInsensitive))
-            {
-                ui.treeWidget->setCurrentItem(ui.treeWidget->topLevelItem(i));
-                return;
-            }
-    }
-    else //search port number
-    {
-        for (i = ui.treeWidget->indexOfTopLevelItem(ui.treeWidget->currentItem()) + 1; i < ui.treeWidget->topLevelItemCount(); ++i)
-            if (ui.treeWidget->topLevelItem(i)->text(1) == str)
-            {
-                ui.treeWidget->setCurrentItem(ui.treeWidget->topLevelItem(i));
-                return;
-            }
-
-        for (i = 0; i < ui.treeWidget->topLevelItemCount(); ++i)
-            if (ui.treeWidget->topLevelItem(i)->text(1) == str)
-            {
-                ui.treeWidget->setCurrentItem(ui.treeWidget->topLevelItem(i));
-                return;
-            }
-    }
+    showRow(model->find(ui.lineEdit->text(), ui.treeView->currentIndex().row() + 1));
 }
 
-void PortNumbersDialog::onItemDoubleClicked(QTreeWidgetItem *item, int column)
+void PortNumbersDialog::onDataChanged()
 {
-    oldValue = item->text(column);
+    ui.pushButtonSave->setEnabled(true);
 }
 
-void PortNumbersDialog::onItemChanged(QTreeWidgetItem *item, int column)
+void PortNumbersDialog::onInvalidValue(int column)
 {
     if (column == 0)
-    {
-        if (item->text(0).toLower() != "tcp" && item->text(0).toLower() != "udp")
-        {
-            QMessageBox::information(this, tr("Information"), tr("Not valid protocol type!"));
-
-            if (oldValue != "")
-                item->setText(0, oldValue);
-            else
-                item->setText(0, "tcp");
-        }
-    }
+        QMessageBox::information(this, tr("Information"), tr("Not valid protocol type!"));
 
     if (column == 1)
-    {
-        bool ok;
-        int x = item->text(1).toInt(&ok, 10);
-
-        if (!ok || x < 0 || x > 65535)
-        {
-            QMessageBox::information(this, tr("Information"), tr("Not valid port number!"));
-
-            if (oldValue != "")
-                item->setText(1, oldValue);
-            else
-                item->setText(1, "0");
-        }
-    }
-
-    ui.pushButtonSave->setEnabled(true);
+        QMessageBox::information(this, tr("Information"), tr("Not valid port number!"));
 }
 
 void PortNumbersDialog::onOK()
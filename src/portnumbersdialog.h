@@ -26,6 +26,10 @@
 #include <QMessageBox>
 #include <QKeyEvent>
 #include <QToolTip>
+#include <QTimer>
+
+#include "portdatabase.h"
+#include "portnumbersmodel.h"
 
 class PortNumbersDialog : public QDialog
 {
@@ -33,7 +37,7 @@ class PortNumbersDialog : public QDialog
     Q_DISABLE_COPY(PortNumbersDialog)
 
 public:
-    explicit PortNumbersDialog(QWidget *parent = 0);
+    explicit PortNumbersDialog(QWidget *parent = 0, PortDatabase *portDatabase = 0);
 
     bool isModified() const { return modified; }
 
@@ -43,7 +47,8 @@ protected:
 private:
     Ui::PortNumbersDialogClass ui;
 
-    QString oldValue;
+    PortDatabase *portDatabase;
+    PortNumbersModel *model;
 
     bool modified;
 
@@ -51,6 +56,7 @@ private:
 
     void readPorts();
     void writePorts();
+    void showRow(int row);
 
 private slots:
     void onShowShortHelp();
@@ -60,9 +66,9 @@ private slots:
     void onDelete();
     void onSearch();
 
-    void onCurrentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
-    void onItemDoubleClicked(QTreeWidgetItem *item, int column);
-    void onItemChanged(QTreeWidgetItem *item, int column);
+    void onCurrentChanged(const QModelIndex &current, const QModelIndex &previous);
+    void onDataChanged();
+    void onInvalidValue(int column);
     void onTextChanged(const QString &text);
 };
 
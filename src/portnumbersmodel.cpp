@@ -0,0 +1,425 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "portnumbersmodel.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QFont>
+#include <QtAlgorithms>
+
+// by a column, equal rows keep their order
+struct RowLessThan
+{
+    const PortNumbersModel *model;
+    int column;
+    bool descending;
+
+    bool operator()(int a, int b) const
+    {
+        if (descending)
+            qSwap(a, b);
+
+        const PortNumbersModel::Row &rowA = model->rows.at(a);
+        const PortNumbersModel::Row &rowB = model->rows.at(b);
+
+        switch (column)
+        {
+            case 0: return rowA.protocol < rowB.protocol;
+            case 1: return rowA.port < rowB.port;
+            default: return model->description(a) < model->description(b);
+        }
+    }
+};
+
+PortNumbersModel::PortNumbersModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    dirty = true;
+}
+
+int PortNumbersModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return order.count();
+}
+
+int PortNumbersModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return 3;
+}
+
+QVariant PortNumbersModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return QVariant();
+
+    int id = order.at(index.row());
+
+    switch (index.column())
+    {
+        case 0: return rows.at(id).protocol == PortTable::PROTOCOL_UDP ? QString("udp") : QString("tcp");
+        case 1: return QString::number(rows.at(id).port);
+        case 2: return description(id);
+        default: return QVariant();
+    }
+}
+
+QVariant PortNumbersModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section)
+    {
+        case 0: return tr("Protocol");
+        case 1: return tr("Port number");
+        case 2: return tr("Description");
+        default: return QVariant();
+    }
+}
+
+Qt::ItemFlags PortNumbersModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return 0;
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+bool PortNumbersModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole)
+        return false;
+
+    Row &row = rows[order.at(index.row())];
+    QString text = value.toString();
+
+    switch (index.column())
+    {
+        case 0:
+        {
+            if (text.compare("tcp", Qt::CaseInsensitive) != 0 && text.compare("udp", Qt::CaseInsensitive) != 0)
+            {
+                emit invalidValue(0);
+                return false;
+            }
+
+            row.protocol = text.compare("udp", Qt::CaseInsensitive) == 0 ? PortTable::PROTOCOL_UDP : PortTable::PROTOCOL_TCP;
+            break;
+        }
+        case 1:
+        {
+            bool ok;
+            int port = text.toInt(&ok, 10);
+
+            if (!ok || port < 0 || port > 65535)
+            {
+                emit invalidValue(1);
+                return false;
+            }
+
+            row.port = port;
+            break;
+        }
+        case 2:
+        {
+            texts.append(text.simplified());
+            row.text = -texts.count();
+            break;
+        }
+        default:
+            return false;
+    }
+
+    dirty = true;
+
+    emit dataChanged(index, index);
+    return true;
+}
+
+void PortNumbersModel::sort(int column, Qt::SortOrder order)
+{
+    emit layoutAboutToBeChanged();
+
+    QModelIndexList oldIndexes = persistentIndexList();
+    QVector<int> ids;
+    for (int i = 0; i < oldIndexes.count(); ++i)
+        ids.append(this->order.at(oldIndexes.at(i).row()));
+
+    RowLessThan lessThan;
+    lessThan.model = this;
+    lessThan.column = column;
+    lessThan.descending = order == Qt::DescendingOrder;
+    qStableSort(this->order.begin(), this->order.end(), lessThan);
+
+    updatePositions();
+
+    QModelIndexList newIndexes;
+    for (int i = 0; i < oldIndexes.count(); ++i)
+        newIndexes.append(index(position.at(ids.at(i)), oldIndexes.at(i).column()));
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged();
+}
+
+void PortNumbersModel::setTable(const QSharedPointer<const PortTable> &table)
+{
+    this->table = table;
+    texts.clear();
+
+    // the table is ordered by port number already
+    rows.resize(table->count());
+    order.resize(table->count());
+    for (int i = 0; i < table->count(); ++i)
+    {
+        rows[i].port = table->port(i);
+        rows[i].protocol = table->protocol(i);
+        rows[i].text = i;
+        order[i] = i;
+    }
+
+    updatePositions();
+    dirty = true;
+
+    reset();
+}
+
+int PortNumbersModel::addRow(int row)
+{
+    Row newRow;
+
+    if (row >= 0 && row < order.count())
+    {
+        newRow = rows.at(order.at(row));
+    }
+    else
+    {
+        newRow.port = 0;
+        newRow.protocol = PortTable::PROTOCOL_TCP;
+        texts.append(QString());
+        newRow.text = -texts.count();
+    }
+
+    beginInsertRows(QModelIndex(), order.count(), order.count());
+    rows.append(newRow);
+    order.append(rows.count() - 1);
+    position.append(order.count() - 1);
+    endInsertRows();
+
+    dirty = true;
+
+    return order.count() - 1;
+}
+
+bool PortNumbersModel::deleteRow(int row)
+{
+    if (row < 0 || row >= order.count())
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    order.remove(row);
+    updatePositions();
+    endRemoveRows();
+
+    dirty = true;
+
+    return true;
+}
+
+QString PortNumbersModel::description(int id) const
+{
+    qint32 text = rows.at(id).text;
+
+    return text >= 0 ? table->description(text) : texts.at(-1 - text);
+}
+
+void PortNumbersModel::updatePositions()
+{
+    position.fill(-1, rows.count());
+
+    for (int i = 0; i < order.count(); ++i)
+        position[order.at(i)] = i;
+}
+
+quint64 PortNumbersModel::trigram(const QString &text, int i)
+{
+    return ((quint64)text.at(i).unicode() << 32) | ((quint64)text.at(i + 1).unicode() << 16) | text.at(i + 2).unicode();
+}
+
+void PortNumbersModel::updateIndex()
+{
+    if (!dirty)
+        return;
+
+    trigrams.clear();
+    portFirst.fill(0, 65537);
+    portIds.resize(order.count());
+
+    QVector<quint64> keys;
+
+    // ids in increasing order, as the posting lists are appended
+    for (int id = 0; id < rows.count(); ++id)
+    {
+        if (position.at(id) < 0)
+            continue;
+
+        ++portFirst[rows.at(id).port + 1];
+
+        QString text = description(id).toLower();
+
+        keys.clear();
+        for (int i = 0; i + 3 <= text.length(); ++i)
+            keys.append(trigram(text, i));
+
+        // each id once in a list
+        qSort(keys);
+        for (int i = 0; i < keys.count(); ++i)
+            if (i == 0 || keys.at(i) != keys.at(i - 1))
+                trigrams[keys.at(i)].append(id);
+    }
+
+    for (int port = 1; port <= 65536; ++port)
+        portFirst[port] += portFirst.at(port - 1);
+
+    // a counting sort, the ids of a port in increasing order
+    QVector<qint32> next = portFirst;
+    for (int id = 0; id < rows.count(); ++id)
+        if (position.at(id) >= 0)
+            portIds[next[rows.at(id).port]++] = id;
+
+    dirty = false;
+}
+
+int PortNumbersModel::find(const QString &text, int from)
+{
+    int count = order.count();
+
+    if (text.isEmpty() || count == 0)
+        return -1;
+
+    if (from < 0 || from >= count)
+        from = 0;
+
+    updateIndex();
+
+    QVector<int> ids;
+    bool ok;
+    int port = text.toInt(&ok, 10);
+
+    if (ok && port >= 0 && port <= 65535)
+    {
+        for (int i = portFirst.at(port); i < portFirst.at(port + 1); ++i)
+            ids.append(portIds.at(i));
+    }
+    else if (text.length() < 3)
+    {
+        // too short for a trigram, but nearly every row matches so the next one is close
+        for (int i = 0; i < count; ++i)
+        {
+            int row = (from + i) % count;
+            if (description(order.at(row)).contains(text, Qt::CaseInsensitive))
+                return row;
+        }
+
+        return -1;
+    }
+    else
+    {
+        QString lower = text.toLower();
+        QVector<const PostingList *> lists;
+
+        for (int i = 0; i + 3 <= lower.length(); ++i)
+        {
+            QHash<quint64, PostingList>::const_iterator it = trigrams.constFind(trigram(lower, i));
+            if (it == trigrams.constEnd())
+                return -1;
+
+            lists.append(&it.value());
+        }
+
+        // rows with all the trigrams, not always in the right order
+        PostingList matches;
+        PostingList::intersect(lists, matches);
+
+        QVector<int> candidates;
+        matches.rows(candidates);
+
+        for (int i = 0; i < candidates.count(); ++i)
+            if (description(candidates.at(i)).contains(text, Qt::CaseInsensitive))
+                ids.append(candidates.at(i));
+    }
+
+    // the nearest row from the given one on
+    int row = -1, distance = count;
+
+    for (int i = 0; i < ids.count(); ++i)
+    {
+        int d = (position.at(ids.at(i)) - from + count) % count;
+        if (d < distance)
+        {
+            distance = d;
+            row = position.at(ids.at(i));
+        }
+    }
+
+    return row;
+}
+
+bool PortNumbersModel::save(const QString &fileName, QString *error) const
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+
+    // the ids are in file order, so rows of the same port keep it whatever the
+    // view is sorted by; PortTable takes the first one of a port
+    QVector<int> ids;
+    ids.reserve(order.count());
+    for (int id = 0; id < rows.count(); ++id)
+        if (position.at(id) != -1)
+            ids.append(id);
+
+    RowLessThan lessThan;
+    lessThan.model = this;
+    lessThan.column = 1;
+    lessThan.descending = false;
+    qStableSort(ids.begin(), ids.end(), lessThan);
+
+    for (int i = 0; i < ids.count(); ++i)
+    {
+        const Row &row = rows.at(ids.at(i));
+        out << (row.protocol == PortTable::PROTOCOL_UDP ? "udp" : "tcp") << " " << row.port << "=" << description(ids.at(i)) << "\r\n";
+    }
+
+    file.close();
+
+    return true;
+}
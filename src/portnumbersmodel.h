@@ -0,0 +1,100 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PORTNUMBERSMODEL_H
+#define PORTNUMBERSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QSharedPointer>
+
+#include "portdatabase.h"
+#include "packetindex.h"
+
+// port numbers for PortNumbersDialog over a snapshot of the port table; the
+// descriptions stay in the table until a row is edited, so showing the whole
+// registry costs one small vector; a trigram index of the descriptions and a
+// direct index of the port numbers are built by updateIndex() and again on the
+// first search after an edit
+class PortNumbersModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PortNumbersModel)
+
+public:
+    explicit PortNumbersModel(QObject *parent = 0);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    virtual Qt::ItemFlags flags(const QModelIndex &index) const;
+    virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    void setTable(const QSharedPointer<const PortTable> &table);
+
+    // a copy of the row, or a "tcp 0" row if it is -1, added at the end; its row
+    int addRow(int row);
+    bool deleteRow(int row);
+
+    // the first matching row from the given one on, wrapping around, -1 if none;
+    // a port number is looked up in the port column, other text in the descriptions
+    int find(const QString &text, int from);
+
+    // ordered by port number, as ports.txt is read by PortTable
+    bool save(const QString &fileName, QString *error) const;
+
+public slots:
+    void updateIndex();
+
+signals:
+    // an edit of the column was rejected, the old value is kept
+    void invalidValue(int column);
+
+private:
+    struct Row
+    {
+        quint16 port;
+        quint8 protocol;
+        qint32 text;        // entry of the table, or -1 - index in texts once edited
+    };
+
+    QSharedPointer<const PortTable> table;
+    QStringList texts;
+
+    QVector<Row> rows;          // by id, deleted rows stay
+    QVector<int> order;         // ids of the shown rows
+    QVector<int> position;      // row of each id, -1 if deleted
+
+    // rebuilt when dirty
+    bool dirty;
+    QHash<quint64, PostingList> trigrams;   // ids by three lower case characters of the description
+    QVector<qint32> portFirst;              // 65537 entries, ids of a port in portIds
+    QVector<qint32> portIds;
+
+    QString description(int id) const;
+    void updatePositions();
+
+    static quint64 trigram(const QString &text, int i);
+
+    friend struct RowLessThan;
+};
+
+#endif // PORTNUMBERSMODEL_H
@@ -29,6 +29,32 @@ struct eth_header
     quint16 type;   	// EtherType: IP, ARP, RARP...
 };
 
+// 802.1Q / 802.1ad tag, follows the MAC addresses in place of the EtherType
+struct vlan_header
+{
+    quint16 tci;        // priority (3 bits) + drop eligible (1 bit) + VLAN ID (12 bits)
+    quint16 type;       // EtherType of the encapsulated frame
+};
+
+// 802.1Q tag length
+const quint8 VLAN_LENGTH = 4;
+
+// MPLS label stack entry: label (20 bits) + traffic class (3 bits) + bottom of stack (1 bit) + TTL (8 bits)
+const quint8 MPLS_LENGTH = 4;
+
+// PPPoE header, RFC 2516
+struct pppoe_header
+{
+    quint8 ver_type;    // version (4 bits) + type (4 bits), both 1
+    quint8 code;        // 0 session data, discovery: PADI 0x09, PADO 0x07, PADR 0x19, PADS 0x65, PADT 0xa7
+    quint16 session;    // session ID
+    quint16 length;     // payload length
+    quint16 protocol;   // PPP protocol, session stage only: IPv4 0x0021, IPv6 0x0057
+};
+
+// PPPoE session header length, including the PPP protocol field
+const quint8 PPPOE_LENGTH = 8;
+
 // IPv4 address
 struct ip_address
 {
@@ -70,6 +96,27 @@ struct ip_header
     //quint32 op_pad;         	// option + padding
 };
 
+// IPv6 header
+struct ip6_header
+{
+    quint32 ver_tc_fl;          // version (4 bits) + traffic class (8 bits) + flow label (20 bits)
+    quint16 plen;               // payload length
+    quint8 next;                // next header
+    quint8 hlim;                // hop limit
+    quint8 saddr[16];           // IPv6 source address
+    quint8 daddr[16];           // IPv6 destination address
+};
+
+// IPv6 header length
+const quint8 IPV6_LENGTH = 40;
+
+// IPv6 extension header, common part
+struct ip6_ext_header
+{
+    quint8 next;        // next header
+    quint8 len;         // header length, units depend on the header type
+};
+
 // TCP header
 struct tcp_header
 {
@@ -103,13 +150,6 @@ struct icmp_header
     quint16 seqno;	// sequence
 };
 
-// ICMP message
-struct icmp_mesg
-{
-    quint8 type;	// type
-    QString mesg;       // message
-};
-
 // IGMPv2
 struct igmp_header
 {
@@ -119,11 +159,4 @@ struct igmp_header
     quint32 groupaddr;   // group address
 };
 
-// IGMP message
-struct igmp_mesg
-{
-    quint8 type;    // type
-    QString mesg;   // message
-};
-
 #endif // PROTOCOLS_H
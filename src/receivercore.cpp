@@ -16,17 +16,115 @@
 // along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "receivercore.h"
+#include "sessionfile.h"
+#include "checkpoint.h"
+
+// rough heap cost of a row: list nodes, strings, timestamps and the index entry
+static const int HOST_ROW_BYTES = 512;
+static const int APP_ROW_BYTES = 160;
+
+// remote hosts kept before the first sweep of the ones out of the Top-N counters
+static const int HOSTS_SWEEP = 4096;
+
+// eviction candidate
+struct EvictRow
+{
+    quint64 seen;
+    int user;
+    int row;
+    bool host;
+};
+
+static bool olderRow(const EvictRow &a, const EvictRow &b)
+{
+    return a.seen < b.seen;
+}
 
 ReceiverCore::ReceiverCore(QObject *parent, CaptureThread *thread)
     : QObject(parent)
 {
-    connect(thread, SIGNAL(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)), this, SLOT(receivedPacket(QString,quint32,QString,QString,quint16,quint32,quint32,quint32,quint32,QString)), Qt::QueuedConnection);
+    connect(thread, SIGNAL(receivedPacket(Packet)), this, SLOT(receivedPacket(Packet)), Qt::QueuedConnection);
 
     connect(thread, SIGNAL(threadStarted()), this, SLOT(start()));
     connect(thread, SIGNAL(threadStopped()), this, SLOT(stop()));
 
+    portDatabase = 0;
+
+    // per protocol counters, indexed by CounterId
+    netCounters[COUNTER_ARP] = &netArp;
+    netCounters[COUNTER_RARP] = &netRarp;
+    netCounters[COUNTER_ICMP] = &netIcmp;
+    netCounters[COUNTER_IGMP] = &netIgmp;
+    netCounters[COUNTER_TCP] = &netTcp;
+    netCounters[COUNTER_UDP] = &netUdp;
+    netCounters[COUNTER_OTHER] = &netOther;
+
+    allLists[COUNTER_ARP] = &usersArp;
+    allLists[COUNTER_RARP] = &usersRarp;
+    allLists[COUNTER_ICMP] = &usersIcmp;
+    allLists[COUNTER_IGMP] = &usersIgmp;
+    allLists[COUNTER_TCP] = &usersTcp;
+    allLists[COUNTER_UDP] = &usersUdp;
+    allLists[COUNTER_OTHER] = &usersOther;
+
+    inLists[COUNTER_ARP] = &usersArpIn;
+    inLists[COUNTER_RARP] = &usersRarpIn;
+    inLists[COUNTER_ICMP] = &usersIcmpIn;
+    inLists[COUNTER_IGMP] = &usersIgmpIn;
+    inLists[COUNTER_TCP] = &usersTcpIn;
+    inLists[COUNTER_UDP] = &usersUdpIn;
+    inLists[COUNTER_OTHER] = &usersOtherIn;
+
+    outLists[COUNTER_ARP] = &usersArpOut;
+    outLists[COUNTER_RARP] = &usersRarpOut;
+    outLists[COUNTER_ICMP] = &usersIcmpOut;
+    outLists[COUNTER_IGMP] = &usersIgmpOut;
+    outLists[COUNTER_TCP] = &usersTcpOut;
+    outLists[COUNTER_UDP] = &usersUdpOut;
+    outLists[COUNTER_OTHER] = &usersOtherOut;
+
     clearVariables();
 
+    metricsEnabled = false;
+    metricsMaxUsers = 0;
+    metricsMaxHosts = 0;
+    metricsSize = 0;
+
+    samplingMode = SAMPLING_OFF;
+    samplingRate = 1;
+
+    memoryBudget = 0;
+    now = 0;
+    started = 0;
+
+    hostsLowMemory = false;
+    hostsMax = 0;
+    hostsPrecision = 12;
+
+    topKind = TOP_USERS;
+    topDirection = TOP_UP;
+    topInWindow = false;
+    topSize = 0;
+
+    flowsCapacity = 0;
+    expiredFlows.resize(1024);
+
+    flowExportEnabled = false;
+    flowExportActive = false;
+    flowExporter = new FlowExporter(this);
+    connect(flowExporter, SIGNAL(infoMessage(quint8,QString,QString)), this, SIGNAL(infoMessage(quint8,QString,QString)));
+
+    resolver = new HostResolver(this);
+    connect(resolver, SIGNAL(resolved(IpAddress,QString)), this, SLOT(nameResolved(IpAddress,QString)));
+
+    checkpointEnabled = false;
+    checkpointInterval = 60;
+    checkpointRows = 0;
+    checkpointCompact = 0;
+    nextCheckpoint = 0;
+    journal = new CheckpointJournal(this);
+    connect(journal, SIGNAL(infoMessage(quint8,QString,QString)), this, SIGNAL(infoMessage(quint8,QString,QString)));
+
     refreshTimer = new QTimer(this);
     connect(refreshTimer, SIGNAL(timeout()), this, SLOT(updateRefreshTimer()));
 }
@@ -37,8 +135,57 @@ ReceiverCore::~ReceiverCore()
 
 void ReceiverCore::start()
 {
+    now = QDateTime::currentDateTime().toTime_t();
+    started = now;
+
     clearVariables();
-    loadPorts();
+
+    // rows of the previous capture are gone, cached names are kept
+    resolver->abort();
+
+    // a journal left behind was not closed by stop(), the capture goes on from it
+    if (checkpointEnabled)
+    {
+        qint64 validSize = 0;
+
+        if (QFile::exists(checkpointFile) || QFile::exists(checkpointFile + ".tmp"))
+        {
+            CheckpointData data;
+            int records;
+            QString error;
+
+            if (!CheckpointJournal::recover(checkpointFile, data, &validSize, &records, &error))
+            {
+                // 2 - warning
+                emit infoMessage(2, tr("Receiver core/thread"), tr("Unable to recover checkpoint: %1").arg(error));
+                validSize = 0;
+            }
+            else if (records > 0)
+            {
+                restore(data);
+
+                // 1 - information
+                emit infoMessage(1, tr("Capture resumed"), tr("%1 users recovered from %2, checkpoint of %3").arg(usersList.count()).arg(checkpointFile)
+                                 .arg(QDateTime::fromTime_t((uint)data.session.saved).toString("yyyy-MM-dd hh:mm:ss")));
+            }
+            else
+                validSize = 0;
+        }
+
+        journal->open(checkpointFile, validSize, checkpointCompact);
+        nextCheckpoint = now + checkpointInterval;
+    }
+
+    // preallocated once, reallocated only if the capacity changes
+    flows.allocate(flowsCapacity);
+
+    // the collector is resolved again for every capture, a failure stops only this one
+    flowExportActive = false;
+    if (flowExportEnabled)
+    {
+        flowExportActive = flowExporter->setCollector(flowExportVersion, flowExportCollector, flowExportPort, flowExportDomain, flowExportTemplateRefresh);
+        flowExporter->start((quint64)QDateTime::currentDateTime().toTime_t() * 1000);
+    }
 
     refreshTimer->start(1000);
 }
@@ -46,18 +193,178 @@ void ReceiverCore::start()
 void ReceiverCore::stop()
 {
     refreshTimer->stop();
+
+    // end of capture, report all remaining flows
+    expireFlows(true);
+
+    // nothing to recover after a clean stop
+    journal->close(true);
 }
 
-void ReceiverCore::setData(quint32 netMask, quint32 pcIP)
+void ReceiverCore::setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6)
 {
     this->netMask = netMask;
     this->pcIP = pcIP;
+    this->localIPv6 = localIPv6;
+}
+
+void ReceiverCore::setMetrics(bool enabled, int maxUsers, int maxHosts)
+{
+    metricsEnabled = enabled;
+    metricsMaxUsers = maxUsers;
+    metricsMaxHosts = maxHosts;
+}
+
+void ReceiverCore::setFlows(quint32 capacity, quint32 idleTimeout, quint32 activeTimeout)
+{
+    flowsCapacity = capacity;
+    flows.setTimeouts(idleTimeout, activeTimeout);
+}
+
+void ReceiverCore::setSampling(quint8 mode, quint32 rate)
+{
+    samplingMode = rate < 2 ? (quint8)SAMPLING_OFF : mode;
+    samplingRate = samplingMode == SAMPLING_OFF ? 1 : rate;
+}
+
+void ReceiverCore::setTopCapacity(int capacity)
+{
+    for (int i = 0; i < TOP_COUNT; ++i)
+        for (int j = 0; j < 2; ++j)
+        {
+            topTotal[i][j].setCapacity(capacity);
+            topWindow[i][j].setCapacity(capacity);
+        }
+}
+
+void ReceiverCore::setMemoryBudget(quint64 budget)
+{
+    memoryBudget = budget;
+}
+
+void ReceiverCore::setResolver(bool lookups, int maxRunning, int cacheSize, quint32 ttl, quint32 negativeTtl, const QString &hostsFile)
+{
+    resolver->setLimits(lookups, maxRunning, cacheSize, ttl, negativeTtl);
+
+    if (hostsFile.isEmpty())
+        return;
+
+    QString error;
+    if (!resolver->loadHostsFile(hostsFile, &error))
+    {
+        // 2 - warning
+        emit infoMessage(2, tr("Receiver core/thread"), tr("Unable to open hosts file %1: %2").arg(hostsFile).arg(error));
+    }
+}
+
+void ReceiverCore::setHosts(bool lowMemory, int maxHosts, int precision)
+{
+    // the precision applies to new users and ports
+    hostsLowMemory = lowMemory;
+    hostsMax = maxHosts;
+    hostsPrecision = precision;
+}
+
+// Top-N wanted by the open dialog, sent now and on every refresh; size 0 stops it
+void ReceiverCore::setTopActive(quint8 kind, quint8 direction, bool window, int size)
+{
+    topKind = kind;
+    topDirection = direction;
+    topInWindow = window;
+    topSize = size;
+
+    if (topSize > 0)
+        emitTopActive();
+}
+
+// the whole session in a SessionFile, packets wait in the queue meanwhile
+void ReceiverCore::saveSession(const QString &fileName)
+{
+    SessionData data;
+
+    data.started = started;
+    data.saved = QDateTime::currentDateTime().toTime_t();
+
+    for (int i = 0; i < usersList.count(); ++i)
+        data.usersList.append(usersList.at(i).toString());
+
+    data.usersName = usersName;
+    data.usersTimeOn = usersTimeOn;
+    data.usersUp = usersUp;
+    data.usersDown = usersDown;
+    data.usersPeers = usersPeersCount;
+
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+    {
+        data.usersPackets[EXPORT_IN][i] = *inLists[i];
+        data.usersPackets[EXPORT_OUT][i] = *outLists[i];
+        data.usersPackets[EXPORT_ALL][i] = *allLists[i];
+    }
+
+    data.usersPackets[EXPORT_IN][COUNTER_COUNT] = usersTotalIn;
+    data.usersPackets[EXPORT_OUT][COUNTER_COUNT] = usersTotalOut;
+    data.usersPackets[EXPORT_ALL][COUNTER_COUNT] = usersTotal;
+
+    data.usersHosts = usersHosts;
+    data.usersApps = usersApps;
+
+    const quint64 net[8] = { netTotal, netArp, netRarp, netIcmp, netIgmp, netUdp, netTcp, netOther };
+    for (int i = 0; i < 8; ++i)
+        data.netPackets[i] = net[i];
+
+    data.netUp = netUpTotal;
+    data.netDown = netDownTotal;
+
+    QString error;
+
+    if (!SessionFile::save(fileName, data, &error))
+    {
+        // 3 - critical
+        emit infoMessage(3, tr("Receiver core/thread"), tr("Unable to save session %1: %2").arg(fileName).arg(error));
+        return;
+    }
+
+    // 1 - information
+    emit infoMessage(1, tr("Session saved"), tr("%1 users written to %2").arg(usersList.count()).arg(fileName));
+}
+
+void ReceiverCore::setCheckpoint(bool enabled, quint32 interval, int maxRows, qint64 compactSize, const QString &fileName)
+{
+    // applied in start()
+    checkpointEnabled = enabled && !fileName.isEmpty();
+    checkpointInterval = qMax((quint32)1, interval);
+    checkpointRows = qMax(1, maxRows);
+    checkpointCompact = compactSize;
+    checkpointFile = fileName;
+}
+
+void ReceiverCore::setPortDatabase(PortDatabase *database)
+{
+    portDatabase = database;
+    ports.clear();
+}
+
+void ReceiverCore::setFlowExport(bool enabled, quint8 version, const QString &collector, quint16 port, quint32 domain, quint32 templateRefresh)
+{
+    // applied in start()
+    flowExportEnabled = enabled;
+    flowExportVersion = version;
+    flowExportCollector = collector;
+    flowExportPort = port;
+    flowExportDomain = domain;
+    flowExportTemplateRefresh = templateRefresh;
 }
 
 void ReceiverCore::updateRefreshTimer()
 {
+    now = QDateTime::currentDateTime().toTime_t();
+
+    // before the lists are sent, the views are rebuilt if rows were evicted
+    evictRows();
+
     // NetPacketsGraphDialog
-    emit signalNetPacketsSpeed(netTotal - netTotalPrev);
+    netPacketsSpeed = netTotal - netTotalPrev;
+    emit signalNetPacketsSpeed(netPacketsSpeed);
     netTotalPrev = netTotal;
 
     // NetPacketsDialog
@@ -67,13 +374,34 @@ void ReceiverCore::updateRefreshTimer()
     emit signalNetTransfer(netUpTotal, netDownTotal);
 
     // NetTransferGraphDialog & NetTransferDialog
-    emit signalNetSpeed(((netUpTotal - netUpTotalPrev) / 1024.0), ((netDownTotal - netDownTotalPrev) / 1024.0));
+    netUpSpeed = netUpTotal - netUpTotalPrev;
+    netDownSpeed = netDownTotal - netDownTotalPrev;
+    emit signalNetSpeed((netUpSpeed / 1024.0), (netDownSpeed / 1024.0));
     netUpTotalPrev = netUpTotal;
     netDownTotalPrev = netDownTotal;
 
     // MainWindow
     emit signalUsersTransfer(usersUp, usersDown);
 
+    // estimates only for the users with new hosts
+    for (int i = 0; i < usersPeersChanged.count(); ++i)
+        if (usersPeersChanged.at(i))
+        {
+            usersPeersCount[i] = usersPeers.at(i).count();
+            usersPeersChanged[i] = false;
+        }
+    emit signalUsersPeers(usersPeersCount);
+
+    // StatusBar
+    quint64 estimatorsMemory = 0;
+    for (int i = 0; i < usersPeers.count(); ++i)
+        estimatorsMemory+=usersPeers.at(i).memory();
+    QHash<quint32, HyperLogLog>::const_iterator it = portsPeers.constBegin();
+    for (; it != portsPeers.constEnd(); ++it)
+        estimatorsMemory+=it.value().memory();
+
+    emit signalMemory(hostsMemory, appsMemory, estimatorsMemory, memoryBudget);
+
     for (int i = 0; i < usersDownSpeed.count(); ++i)
     {
         usersUpSpeed[i] = (usersUp.at(i) - usersUpPrev.at(i)) / 1024.0;
@@ -90,12 +418,75 @@ void ReceiverCore::updateRefreshTimer()
     emit netInPackets(usersArpIn, usersRarpIn, usersIcmpIn, usersIgmpIn, usersTcpIn, usersUdpIn, usersOtherIn, usersTotalIn);
     emit netOutPackets(usersArpOut, usersRarpOut, usersIcmpOut, usersIgmpOut, usersTcpOut, usersUdpOut, usersOtherOut, usersTotalOut);
 
+    // TopActiveDialog, then the windows move on to the next second
+    if (topSize > 0)
+        emitTopActive();
+
+    for (int i = 0; i < TOP_COUNT; ++i)
+    {
+        topWindow[i][TOP_UP].advance();
+        topWindow[i][TOP_DOWN].advance();
+    }
+
+    sweepHosts();
+
+    expireFlows(false);
+
+    // skipped while the journal still writes the last one
+    if (checkpointEnabled && now >= nextCheckpoint && !journal->isBusy())
+    {
+        checkpoint();
+        nextCheckpoint = now + checkpointInterval;
+    }
+
+    // MetricsServer
+    if (metricsEnabled)
+        emit signalMetrics(renderMetrics());
+
     refreshTimer->start(1000);
 }
 
-void ReceiverCore::receivedPacket(const QString &time, quint32 length, const QString &sMac, const QString &dMac, quint16 type, quint32 sIP, quint32 dIP, quint32 sPort, quint32 dPort, const QString &info)
+void ReceiverCore::receivedPacket(const Packet &packet)
 {
-    incrementNetCounters(type);
+    // sampled packets stand for packet.weight packets, so all counters are estimates
+    quint32 weight = packet.weight;
+    quint64 length = (quint64)packet.length * weight;
+    quint64 seconds = packet.timestamp / 1000;
+    quint8 counter = Dissectors::counter(packet.protocol);
+    const IpAddress &sIP = packet.sIP, &dIP = packet.dIP;
+    quint32 sPort = packet.sPort, dPort = packet.dPort;
+
+    lastPacket = seconds;
+
+    incrementNetCounters(counter, weight);
+
+    // decoding problems
+    if (packet.malformed)
+    {
+        for (int i = 0; i < 4; ++i)
+            if (packet.malformed & 1<<i)
+                malformedPackets[i]+=weight;
+    }
+
+    if (packet.truncated)
+        truncatedPackets+=weight;
+
+    fragmentPackets[packet.fragment]+=weight;
+
+    // names seen in the traffic, before the rows of this packet get theirs
+    if (!packet.names.isEmpty())
+        addNames(packet.names);
+
+    // VLAN
+    quint16 vlan = packet.vlan;
+    if (!vlanPackets.at(vlan))
+        vlanList.append(vlan);
+    vlanPackets[vlan]+=weight;
+    vlanBytes[vlan]+=length;
+
+    // flows, ports above 65535 mean "no port", sampled flows keep their real sizes
+    if (packet.ipVersion)
+        flows.update(sIP, dIP, sPort < 65536 ? sPort : 0, dPort < 65536 ? dPort : 0, packet.ipProto, packet.tcpFlags, packet.length, packet.timestamp);
 
     // IP from our network?
     if (checkIP(sIP))
@@ -110,80 +501,38 @@ void ReceiverCore::receivedPacket(const QString &time, quint32 length, const QSt
             if (multicastIP(dIP))
             {
                 // 0 download
-                emit signalMulticast(dIP, sIP, length, 0);
+                emit signalMulticast(dIP, sIP, (quint32)length, 0);
                 return;
             }
 
-            if (!usersList.contains(sIP))
-            {
-                usersList.append(sIP);
-
-                Hosts host;
-                usersHosts.append(host);
-
-                Apps app;
-                usersApps.append(app);
-
-                usersUpSpeed.append(0.0);
-                usersDownSpeed.append(0.0);
-
-                usersUp.append(0);
-                usersUpPrev.append(0);
-                usersDown.append(0);
-                usersDownPrev.append(0);
-
-                listsAppend();
-
-                addr.S_un.S_addr = sIP;
-                QString user = inet_ntoa(addr);
-
-                emit signalNewUser(user, QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
-
-                QHostInfo::lookupHost(user, this, SLOT(userLookedUp(QHostInfo)));
-            }
-
-            int user = usersList.indexOf(sIP, 0);
+            int user = userIndex(sIP);
             usersUp[user]+=length;
+            usersDirty[user] = true;
 
             netUpTotal+=length;
+            vlanUp[vlan]+=length;
 
-            if (!usersHosts.at(user).hostIp.contains(dIP))
-            {
-                usersHosts[user].hostIp.append(dIP);
-                usersHosts[user].hostName.append("");
-
-                addr.S_un.S_addr = dIP;
-                QHostInfo::lookupHost(inet_ntoa(addr), this, SLOT(hostLookedUp(QHostInfo)));
+            addTop(TOP_USERS, TOP_UP, user, length);
+            addTop(TOP_HOSTS, TOP_UP, remoteIndex(dIP), length);
+            addPeer(user, dIP, dPort);
 
-                usersHosts[user].dPort.append(QString::number(dPort));
-                usersHosts[user].dApp.append(portToName(dPort));
-                usersHosts[user].downBytes.append(0);
-                usersHosts[user].upBytes.append(0);
-                usersHosts[user].firstVisit.append(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
-                usersHosts[user].lastVisit.append(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
-
-                emit signalNewUserHost(user, usersHosts.at(user));
+            int index = hostIndex(user, dIP, dPort, seconds);
+            if (index != -1)
+            {
+                usersHosts[user].upBytes[index]+=length;
+                usersHosts[user].lastVisit[index] = seconds;
             }
 
-            int index = usersHosts.at(user).hostIp.indexOf(dIP, 0);
-            usersHosts[user].upBytes[index]+=length;
-            usersHosts[user].lastVisit[index] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-
             if (dPort != 0)
             {
-                if (!usersApps.at(user).hostPort.contains(QString::number(dPort)))
-                {
-                    usersApps[user].hostPort.append(QString::number(dPort));
-                    usersApps[user].hostPortName.append(portToName(dPort));
-                    usersApps[user].upBytes.append(0);
-                    usersApps[user].downBytes.append(0);
-
-                    emit signalNewUserApp(user, usersApps.at(user));
-                }
-                usersApps[user].upBytes[usersApps.at(user).hostPort.indexOf(QString::number(dPort), 0)]+=length;
+                index = appIndex(user, dPort);
+                usersApps[user].upBytes[index]+=length;
+                usersAppsSeen[user][index] = seconds;
+
+                addTop(TOP_APPS, TOP_UP, dPort, length);
             }
 
-            incrementOutLists(type, user);
+            incrementOutLists(counter, user, weight);
         }
     }
     // from Internet
@@ -192,14 +541,14 @@ void ReceiverCore::receivedPacket(const QString &time, quint32 length, const QSt
         if (multicastIP(sIP))
         {
             // 1 upload
-            emit signalMulticast(sIP, dIP, length, 1);
+            emit signalMulticast(sIP, dIP, (quint32)length, 1);
             return;
         }
 
         if (multicastIP(dIP))
         {
             // 0 download
-            emit signalMulticast(dIP, sIP, length, 0);
+            emit signalMulticast(dIP, sIP, (quint32)length, 0);
             return;
         }
 
@@ -207,87 +556,510 @@ void ReceiverCore::receivedPacket(const QString &time, quint32 length, const QSt
         if (checkIP(dIP))
         {
             // user
-            if (!usersList.contains(dIP))
+            int user = userIndex(dIP);
+            usersDown[user]+=length;
+            usersDirty[user] = true;
+
+            netDownTotal+=length;
+            vlanDown[vlan]+=length;
+
+            addTop(TOP_USERS, TOP_DOWN, user, length);
+            addTop(TOP_HOSTS, TOP_DOWN, remoteIndex(sIP), length);
+            addPeer(user, sIP, sPort);
+
+            int index = hostIndex(user, sIP, sPort, seconds);
+            if (index != -1)
             {
-                usersList.append(dIP);
+                usersHosts[user].downBytes[index]+=length;
+                usersHosts[user].lastVisit[index] = seconds;
+            }
 
-                Hosts host;
-                usersHosts.append(host);
+            if (sPort != 0)
+            {
+                index = appIndex(user, sPort);
+                usersApps[user].downBytes[index]+=length;
+                usersAppsSeen[user][index] = seconds;
 
-                Apps app;
-                usersApps.append(app);
+                addTop(TOP_APPS, TOP_DOWN, sPort, length);
+            }
 
-                usersUpSpeed.append(0.0);
-                usersDownSpeed.append(0.0);
+            incrementInLists(counter, user, weight);
+        }
+    }
+}
 
-                usersUp.append(0);
-                usersUpPrev.append(0);
-                usersDown.append(0);
-                usersDownPrev.append(0);
+// index of the user, a new user is added if not on the list
+int ReceiverCore::userIndex(const IpAddress &ip)
+{
+    QHash<IpAddress, int>::const_iterator it = usersIndex.constFind(ip);
 
-                listsAppend();
+    if (it != usersIndex.constEnd())
+        return it.value();
 
-                addr.S_un.S_addr = dIP;
-                QString user = inet_ntoa(addr);
+    return addUser(ip, QDateTime::currentDateTime().toTime_t());
+}
 
-                emit signalNewUser(user, QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+int ReceiverCore::addUser(const IpAddress &ip, quint64 timeOn)
+{
+    usersList.append(ip);
+    usersIndex.insert(ip, usersList.count() - 1);
 
-                QHostInfo::lookupHost(user, this, SLOT(userLookedUp(QHostInfo)));
-            }
+    Hosts host;
+    usersHosts.append(host);
+    usersHostsIndex.append(QHash<IpAddress, int>());
 
-            int user = usersList.indexOf(dIP, 0);
-            usersDown[user]+=length;
+    Apps app;
+    usersApps.append(app);
 
-            netDownTotal+=length;
+    usersUpSpeed.append(0.0);
+    usersDownSpeed.append(0.0);
 
-            if (!usersHosts.at(user).hostIp.contains(sIP))
-            {
-                usersHosts[user].hostIp.append(sIP);
-                usersHosts[user].hostName.append("");
+    usersAppsSeen.append(QVector<quint64>());
 
-                addr.S_un.S_addr = sIP;
-                QHostInfo::lookupHost(inet_ntoa(addr), this, SLOT(hostLookedUp(QHostInfo)));
+    usersPeers.append(HyperLogLog(hostsPrecision));
+    usersPeersCount.append(0);
+    usersPeersChanged.append(false);
 
-                usersHosts[user].dPort.append(QString::number(sPort));
-                usersHosts[user].dApp.append(portToName(sPort));
-                usersHosts[user].downBytes.append(0);
-                usersHosts[user].upBytes.append(0);
-                usersHosts[user].firstVisit.append(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
-                usersHosts[user].lastVisit.append(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    usersUp.append(0);
+    usersUpPrev.append(0);
+    usersDown.append(0);
+    usersDownPrev.append(0);
 
-                emit signalNewUserHost(user, usersHosts.at(user));
-            }
+    usersDirty.append(true);
+    usersMark.append(0);
+    usersNextMark.append(0);
+    usersCheckpointRow.append(0);
 
-            int index = usersHosts.at(user).hostIp.indexOf(sIP, 0);
-            usersHosts[user].downBytes[index]+=length;
-            usersHosts[user].lastVisit[index] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    listsAppend();
 
-            if (sPort != 0)
+    QString user = ip.toString();
+
+    usersTimeOn.append(timeOn);
+    emit signalNewUser(user, QDateTime::fromTime_t((uint)timeOn).toString("yyyy-MM-dd hh:mm:ss"));
+
+    QString name = resolver->name(ip);
+    usersName.append(name);
+
+    if (!name.isEmpty())
+        emit signalNewUserName(user, name);
+    else
+        resolver->lookup(ip);
+
+    return usersList.count() - 1;
+}
+
+// index of the user's host, a new host is added if not on the list;
+// -1 in low memory mode if the user has hostsMax hosts already
+int ReceiverCore::hostIndex(int user, const IpAddress &ip, quint32 port, quint64 time)
+{
+    QHash<IpAddress, int>::const_iterator it = usersHostsIndex.at(user).constFind(ip);
+
+    if (it != usersHostsIndex.at(user).constEnd())
+        return it.value();
+
+    if (hostsLowMemory && usersHosts.at(user).hostIp.count() >= hostsMax)
+    {
+        ++packetsNotDetailed;
+        return -1;
+    }
+
+    Hosts &host = usersHosts[user];
+
+    host.hostIp.append(ip);
+    host.hostName.append(resolver->name(ip));
+    host.dPort.append(QString::number(port));
+    host.dApp.append(portToName(port));
+    host.downBytes.append(0);
+    host.upBytes.append(0);
+    host.firstVisit.append(time);
+    host.lastVisit.append(time);
+
+    usersHostsIndex[user].insert(ip, host.hostIp.count() - 1);
+    hostsUsers.insert(ip, user);
+    hostsMemory+=HOST_ROW_BYTES;
+
+    if (host.hostName.last().isEmpty())
+        resolver->lookup(ip);
+
+    emit signalNewUserHost(user, usersHosts.at(user));
+
+    return host.hostIp.count() - 1;
+}
+
+// index of the user's application, a new one is added if not on the list
+int ReceiverCore::appIndex(int user, quint32 port)
+{
+    Apps &app = usersApps[user];
+    QString number = QString::number(port);
+
+    int index = app.hostPort.indexOf(number);
+    if (index != -1)
+        return index;
+
+    app.hostPort.append(number);
+    app.hostPortName.append(portToName(port));
+    app.upBytes.append(0);
+    app.downBytes.append(0);
+
+    usersAppsSeen[user].append(now);
+    appsMemory+=APP_ROW_BYTES;
+
+    emit signalNewUserApp(user, app);
+
+    return app.hostPort.count() - 1;
+}
+
+void ReceiverCore::addPeer(int user, const IpAddress &ip, quint32 port)
+{
+    quint64 hash = HyperLogLog::hash(ip);
+
+    if (usersPeers[user].add(hash))
+        usersPeersChanged[user] = true;
+
+    if (port != 0 && port < 65536)
+    {
+        QHash<quint32, HyperLogLog>::iterator it = portsPeers.find(port);
+
+        if (it == portsPeers.end())
+            it = portsPeers.insert(port, HyperLogLog(hostsPrecision));
+
+        it.value().add(hash);
+    }
+}
+
+// over the budget the least recently seen host and app rows are folded into the
+// user's "other" row, so the totals stay exact, until 90% of the budget is used
+void ReceiverCore::evictRows()
+{
+    if (memoryBudget == 0 || hostsMemory + appsMemory <= memoryBudget)
+        return;
+
+    QVector<EvictRow> rows;
+    EvictRow row;
+
+    for (int i = 0; i < usersHosts.count(); ++i)
+    {
+        row.user = i;
+
+        row.host = true;
+        for (int j = 0; j < usersHosts.at(i).hostIp.count(); ++j)
+            if (!usersHosts.at(i).hostIp.at(j).isNull())
             {
-                if (!usersApps.at(user).hostPort.contains(QString::number(sPort)))
-                {
-                    usersApps[user].hostPort.append(QString::number(sPort));
-                    usersApps[user].hostPortName.append(portToName(sPort));
-                    usersApps[user].upBytes.append(0);
-                    usersApps[user].downBytes.append(0);
-
-                    emit signalNewUserApp(user, usersApps.at(user));
-                }
-                usersApps[user].downBytes[usersApps.at(user).hostPort.indexOf(QString::number(sPort), 0)]+=length;
+                row.row = j;
+                row.seen = usersHosts.at(i).lastVisit.at(j);
+                rows.append(row);
             }
 
-            incrementInLists(type, user);
+        row.host = false;
+        for (int j = 0; j < usersApps.at(i).hostPort.count(); ++j)
+            if (!usersApps.at(i).hostPort.at(j).isEmpty())
+            {
+                row.row = j;
+                row.seen = usersAppsSeen.at(i).at(j);
+                rows.append(row);
+            }
+    }
+
+    qSort(rows.begin(), rows.end(), olderRow);
+
+    quint64 target = memoryBudget / 10 * 9;
+    QVector< QVector<bool> > hostsEvicted(usersHosts.count()), appsEvicted(usersApps.count());
+
+    for (int i = 0; i < rows.count() && hostsMemory + appsMemory > target; ++i)
+    {
+        const EvictRow &r = rows.at(i);
+
+        if (r.host)
+        {
+            QVector<bool> &evicted = hostsEvicted[r.user];
+            if (evicted.isEmpty())
+                evicted.fill(false, usersHosts.at(r.user).hostIp.count());
+
+            evicted[r.row] = true;
+            hostsMemory-=HOST_ROW_BYTES;
+            ++rowsEvicted[0];
         }
+        else
+        {
+            QVector<bool> &evicted = appsEvicted[r.user];
+            if (evicted.isEmpty())
+                evicted.fill(false, usersApps.at(r.user).hostPort.count());
+
+            evicted[r.row] = true;
+            appsMemory-=APP_ROW_BYTES;
+            ++rowsEvicted[1];
+        }
+    }
+
+    for (int i = 0; i < usersHosts.count(); ++i)
+    {
+        if (!hostsEvicted.at(i).isEmpty())
+            foldHosts(i, hostsEvicted.at(i));
+
+        if (!appsEvicted.at(i).isEmpty())
+            foldApps(i, appsEvicted.at(i));
     }
 }
 
+// the other row has a null address, so hostIndex() never finds it
+void ReceiverCore::foldHosts(int user, const QVector<bool> &evicted)
+{
+    const Hosts &host = usersHosts.at(user);
+    Hosts kept;
+    quint64 up = 0, down = 0;
+    int other = -1;
+
+    for (int i = 0; i < host.hostIp.count(); ++i)
+    {
+        if (evicted.at(i))
+        {
+            hostsUsers.remove(host.hostIp.at(i), user);
+
+            up+=host.upBytes.at(i);
+            down+=host.downBytes.at(i);
+            continue;
+        }
+
+        if (host.hostIp.at(i).isNull())
+            other = kept.hostIp.count();
+
+        kept.hostIp.append(host.hostIp.at(i));
+        kept.hostName.append(host.hostName.at(i));
+        kept.dPort.append(host.dPort.at(i));
+        kept.dApp.append(host.dApp.at(i));
+        kept.upBytes.append(host.upBytes.at(i));
+        kept.downBytes.append(host.downBytes.at(i));
+        kept.firstVisit.append(host.firstVisit.at(i));
+        kept.lastVisit.append(host.lastVisit.at(i));
+    }
+
+    if (other == -1)
+    {
+        kept.hostIp.append(IpAddress());
+        kept.hostName.append(tr("Other hosts"));
+        kept.dPort.append("");
+        kept.dApp.append("");
+        kept.upBytes.append(0);
+        kept.downBytes.append(0);
+        kept.firstVisit.append(now);
+        kept.lastVisit.append(now);
+
+        hostsMemory+=HOST_ROW_BYTES;
+        other = kept.hostIp.count() - 1;
+    }
+
+    kept.upBytes[other]+=up;
+    kept.downBytes[other]+=down;
+    kept.lastVisit[other] = now;
+    kept.folds = host.folds + 1;
+
+    usersHosts[user] = kept;
+
+    // rows moved, the next checkpoint writes them all
+    usersMark[user] = 0;
+    usersCheckpointRow[user] = 0;
+    usersDirty[user] = true;
+
+    // rows moved
+    QHash<IpAddress, int> &index = usersHostsIndex[user];
+    index.clear();
+    for (int i = 0; i < kept.hostIp.count(); ++i)
+        if (i != other)
+            index.insert(kept.hostIp.at(i), i);
+}
+
+// the other row has no port, so appIndex() never finds it
+void ReceiverCore::foldApps(int user, const QVector<bool> &evicted)
+{
+    const Apps &app = usersApps.at(user);
+    const QVector<quint64> &appSeen = usersAppsSeen.at(user);
+
+    Apps kept;
+    QVector<quint64> seen;
+    quint64 up = 0, down = 0;
+    int other = -1;
+
+    for (int i = 0; i < app.hostPort.count(); ++i)
+    {
+        if (evicted.at(i))
+        {
+            up+=app.upBytes.at(i);
+            down+=app.downBytes.at(i);
+            continue;
+        }
+
+        if (app.hostPort.at(i).isEmpty())
+            other = kept.hostPort.count();
+
+        kept.hostPort.append(app.hostPort.at(i));
+        kept.hostPortName.append(app.hostPortName.at(i));
+        kept.upBytes.append(app.upBytes.at(i));
+        kept.downBytes.append(app.downBytes.at(i));
+        seen.append(appSeen.at(i));
+    }
+
+    if (other == -1)
+    {
+        kept.hostPort.append("");
+        kept.hostPortName.append(tr("Other applications"));
+        kept.upBytes.append(0);
+        kept.downBytes.append(0);
+        seen.append(now);
+
+        appsMemory+=APP_ROW_BYTES;
+        other = kept.hostPort.count() - 1;
+    }
+
+    kept.upBytes[other]+=up;
+    kept.downBytes[other]+=down;
+    kept.folds = app.folds + 1;
+
+    usersApps[user] = kept;
+    usersAppsSeen[user] = seen;
+
+    usersMark[user] = 0;
+    usersCheckpointRow[user] = 0;
+    usersDirty[user] = true;
+}
+
+// index of the remote host among all users' hosts
+int ReceiverCore::remoteIndex(const IpAddress &ip)
+{
+    QHash<IpAddress, int>::const_iterator it = hostsIndex.constFind(ip);
+
+    if (it != hostsIndex.constEnd())
+        return it.value();
+
+    int k;
+
+    if (hostsFree.isEmpty())
+    {
+        hostsList.append(ip);
+        hostsName.append(resolver->name(ip));
+        k = hostsList.count() - 1;
+    }
+    else
+    {
+        k = hostsFree.takeLast();
+        hostsList[k] = ip;
+        hostsName[k] = resolver->name(ip);
+    }
+
+    hostsIndex.insert(ip, k);
+
+    return k;
+}
+
+// drops the remote hosts held by none of the TOP_HOSTS counters, once the hosts
+// doubled since the last sweep, so the list follows the counters and not the capture
+void ReceiverCore::sweepHosts()
+{
+    if (hostsIndex.count() < hostsSweep)
+        return;
+
+    QHash<quint64, TopItem> held;
+    for (int i = 0; i < 2; ++i)
+    {
+        topTotal[TOP_HOSTS][i].merge(held);
+        topWindow[TOP_HOSTS][i].merge(held);
+    }
+
+    for (int k = 0; k < hostsList.count(); ++k)
+    {
+        if (hostsIndex.value(hostsList.at(k), -1) != k || held.contains(k))
+            continue;
+
+        hostsIndex.remove(hostsList.at(k));
+        hostsList[k] = IpAddress();
+        hostsName[k].clear();
+        hostsFree.append(k);
+    }
+
+    hostsSweep = qMax(HOSTS_SWEEP, hostsIndex.count() * 2);
+}
+
+void ReceiverCore::addTop(quint8 kind, quint8 direction, quint64 key, quint64 bytes)
+{
+    topTotal[kind][direction].add(key, bytes);
+    topWindow[kind][direction].add(key, bytes);
+}
+
+void ReceiverCore::emitTopActive()
+{
+    QList<TopItem> items;
+    quint64 total;
+
+    if (topInWindow)
+    {
+        items = topWindow[topKind][topDirection].top(topSize);
+        total = topWindow[topKind][topDirection].total();
+    }
+    else
+    {
+        items = topTotal[topKind][topDirection].top(topSize);
+        total = topTotal[topKind][topDirection].total();
+    }
+
+    QList<TopEntry> top;
+
+    for (int i = 0; i < items.count(); ++i)
+    {
+        TopEntry entry;
+        entry.key = items.at(i).key;
+        entry.bytes = items.at(i).count;
+        entry.error = items.at(i).error;
+
+        switch (topKind)
+        {
+        case TOP_USERS:
+            entry.name = usersList.at(entry.key).toString();
+            break;
+        case TOP_HOSTS:
+            if (hostsName.at(entry.key).isEmpty())
+                entry.name = hostsList.at(entry.key).toString();
+            else
+                entry.name = hostsName.at(entry.key) + " [" + hostsList.at(entry.key).toString() + "]";
+            break;
+        case TOP_APPS:
+            entry.name = portToName(entry.key) + " [" + QString::number(entry.key) + "]";
+            break;
+        }
+
+        top.append(entry);
+    }
+
+    emit signalTopActive(topKind, topDirection, topInWindow, total, top);
+}
+
 void ReceiverCore::clearVariables()
 {
     usersList.clear();
+    usersIndex.clear();
+    usersName.clear();
+    usersTimeOn.clear();
+
+    usersDirty.clear();
+    usersMark.clear();
+    usersNextMark.clear();
+    usersCheckpointRow.clear();
+    checkpointCursor = 0;
+    lastPacket = 0;
 
     usersHosts.clear();
+    usersHostsIndex.clear();
     usersApps.clear();
 
+    usersAppsSeen.clear();
+    hostsMemory = 0;
+    appsMemory = 0;
+    rowsEvicted[0] = rowsEvicted[1] = 0;
+
+    usersPeers.clear();
+    usersPeersCount.clear();
+    usersPeersChanged.clear();
+    portsPeers.clear();
+    packetsNotDetailed = 0;
+
     usersUp.clear();
     usersDown.clear();
     usersUpPrev.clear();
@@ -337,57 +1109,93 @@ void ReceiverCore::clearVariables()
     netUdp = 0;
     netTcp = 0;
     netOther = 0;
-}
 
-void ReceiverCore::incrementNetCounters(quint16 type)
-{
-    ++netTotal;
+    for (int i = 0; i < 4; ++i)
+        malformedPackets[i] = 0;
+    truncatedPackets = 0;
+
+    for (int i = 0; i < 4; ++i)
+        fragmentPackets[i] = 0;
+
+    vlanPackets.fill(0, 4096);
+    vlanBytes.fill(0, 4096);
+    vlanUp.fill(0, 4096);
+    vlanDown.fill(0, 4096);
+    vlanList.clear();
+
+    netPacketsSpeed = 0;
+    netUpSpeed = 0;
+    netDownSpeed = 0;
+
+    for (int i = 0; i < TOP_COUNT; ++i)
+        for (int j = 0; j < 2; ++j)
+        {
+            topTotal[i][j].clear();
+            topWindow[i][j].clear();
+        }
+
+    hostsList.clear();
+    hostsIndex.clear();
+    hostsName.clear();
+    hostsFree.clear();
+    hostsSweep = HOSTS_SWEEP;
+    hostsUsers.clear();
 
-    if (type == 0x0806) { ++netArp; return; }
-    if (type == 0x8035) { ++netRarp; return; }
-    if (type == 1) { ++netIcmp; return; }
-    if (type == 2) { ++netIgmp; return; }
-    if (type == 6) { ++netTcp; return; }
-    if (type == 17) { ++netUdp; return; }
+    for (int i = 0; i < NAME_SOURCES; ++i)
+        namesDiscovered[i] = 0;
+}
 
-    ++netOther;
+void ReceiverCore::incrementNetCounters(quint8 counter, quint32 weight)
+{
+    netTotal+=weight;
+    *netCounters[counter]+=weight;
 }
 
 // IP from our network?
-bool ReceiverCore::checkIP(quint32 ip)
+bool ReceiverCore::checkIP(const IpAddress &ip)
 {
-    for (int i = 0; i < 32; ++i)
+    if (ip.isIPv4())
     {
-        if (netMask & 1<<i)
+        quint32 ipv4 = ip.toIPv4();
+
+        for (int i = 0; i < 32; ++i)
         {
-            if ((ip & 1<<i) ^ (pcIP & 1<<i))
-                return false;
+            if (netMask & 1<<i)
+            {
+                if ((ipv4 & 1<<i) ^ (pcIP & 1<<i))
+                    return false;
+            }
+            else
+            {
+                return true;
+            }
         }
-        else
-        {
+
+        return true;
+    }
+
+    if (ip.isIPv6())
+    {
+        // link-local addresses never leave the network
+        if (ip.isLinkLocal())
             return true;
+
+        // /64 prefixes of the device addresses
+        for (int i = 0; i < localIPv6.count(); ++i)
+        {
+            if (ip.samePrefix(localIPv6.at(i), 64))
+                return true;
         }
     }
 
-    return true;
+    return false;
 }
 
 // is multicast IP?
-bool ReceiverCore::multicastIP(quint32 ip)
+bool ReceiverCore::multicastIP(const IpAddress &ip)
 {
-    // 224.0.0.0 ... 239.255.255.255, RFC3171
-
-    // reset (set 0) bits 8 to 32
-    //for (int i = 8; i < 32; ++i)
-    //    ip = ip & ~(1 << i);
-    ip = ip & 0xff;
-    
-    if (ip >= 224 && ip <= 239)
-        return true;
-    else
-        return false;
-
-    return false;
+    // 224.0.0.0 ... 239.255.255.255, RFC3171, ff00::/8
+    return ip.isMulticast();
 }
 
 void ReceiverCore::listsAppend()
@@ -420,123 +1228,451 @@ void ReceiverCore::listsAppend()
     usersTotalOut.append(0);
 }
 
-void ReceiverCore::incrementInLists(quint16 type, qint32 i)
+void ReceiverCore::incrementInLists(quint8 counter, qint32 i, quint32 weight)
 {
-    ++usersTotalIn[i];
-    ++usersTotal[i];
+    usersTotalIn[i]+=weight;
+    usersTotal[i]+=weight;
 
-    if (type == 0x0806) { ++usersArpIn[i]; ++usersArp[i]; return; }
-    if (type == 0x8035) { ++usersRarpIn[i]; ++usersRarp[i]; return; }
-    if (type == 1) { ++usersIcmpIn[i]; ++usersIcmp[i]; return; }
-    if (type == 2) { ++usersIgmpIn[i]; ++usersIgmp[i]; return; }
-    if (type == 6) { ++usersTcpIn[i]; ++usersTcp[i]; return; }
-    if (type == 17) { ++usersUdpIn[i]; ++usersUdp[i]; return; }
+    (*inLists[counter])[i]+=weight;
+    (*allLists[counter])[i]+=weight;
+}
 
-    ++usersOtherIn[i];
-    ++usersOther[i];
+void ReceiverCore::incrementOutLists(quint8 counter, qint32 i, quint32 weight)
+{
+    usersTotalOut[i]+=weight;
+    usersTotal[i]+=weight;
+
+    (*outLists[counter])[i]+=weight;
+    (*allLists[counter])[i]+=weight;
 }
 
-void ReceiverCore::incrementOutLists(quint16 type, qint32 i)
+QString ReceiverCore::portToName(quint16 port)
 {
-    ++usersTotalOut[i];
-    ++usersTotal[i];
+    if (!portDatabase)
+        return "";
 
-    if (type == 0x0806) { ++usersArpOut[i]; ++usersArp[i]; return; }
-    if (type == 0x8035) { ++usersRarpOut[i]; ++usersRarp[i]; return; }
-    if (type == 1) { ++usersIcmpOut[i]; ++usersIcmp[i]; return; }
-    if (type == 2) { ++usersIgmpOut[i]; ++usersIgmp[i]; return; }
-    if (type == 6) { ++usersTcpOut[i]; ++usersTcp[i]; return; }
-    if (type == 17) { ++usersUdpOut[i]; ++usersUdp[i]; return; }
+    // an atomic read per lookup, the mutex only when the table was swapped
+    if (ports.isNull() || ports->generation() != portDatabase->generation())
+        ports = portDatabase->snapshot();
 
-    ++usersOtherOut[i];
-    ++usersOther[i];
+    return ports->name(port);
 }
 
-void ReceiverCore::loadPorts()
+void ReceiverCore::addNames(const QList<DiscoveredName> &names)
 {
-    protocolList.clear();
-    portList.clear();
-    descList.clear();
+    for (int i = 0; i < names.count(); ++i)
+    {
+        const DiscoveredName &name = names.at(i);
+
+        ++namesDiscovered[name.source];
 
-    QFile file(QCoreApplication::applicationDirPath() + "/ports.txt");
+        if (resolver->insertName(name.ip, name.name, name.ttl))
+            nameResolved(name.ip, name.name);
+    }
+}
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+// a name of a user or remote host, only the rows of the address are updated
+void ReceiverCore::nameResolved(const IpAddress &ip, const QString &name)
+{
+    int user = usersIndex.value(ip, -1);
+    if (user != -1)
     {
-        // 2 - warning
-        emit infoMessage(2, tr("Receiver core/thread"), tr("Unable to open port numbers file: %1. Users application names not available.").arg(file.errorString()));
-        return;
+        usersName[user] = name;
+        usersDirty[user] = true;
+        emit signalNewUserName(ip.toString(), name);
     }
 
-    QTextStream in(&file);
-    in.setCodec("UTF-8");
+    int k = hostsIndex.value(ip, -1);
+    if (k != -1)
+        hostsName[k] = name;
 
-    QString line;
+    bool found = false;
 
-    while (!in.atEnd())
+    QMultiHash<IpAddress, int>::const_iterator it = hostsUsers.constFind(ip);
+    for (; it != hostsUsers.constEnd() && it.key() == ip; ++it)
     {
-        line = in.readLine();
+        int row = usersHostsIndex.at(it.value()).value(ip, -1);
 
-        //protocolList.append(line.left(3));
-        portList.append(line.mid(4, line.indexOf("=", 0) - 4));
-        descList.append(line.right(line.length() - line.indexOf("=", 3) -1).simplified());
+        if (row != -1)
+        {
+            usersHosts[it.value()].hostName[row] = name;
+            found = true;
+        }
     }
 
-    file.close();
+    if (found)
+        emit signalNewHostName(ip.toString(), name);
 }
 
-QString ReceiverCore::portToName(quint16 port)
+void ReceiverCore::expireFlows(bool all)
 {
-    int index = portList.indexOf(QString::number(port), 0);
+    quint64 now = (quint64)QDateTime::currentDateTime().toTime_t() * 1000;
+    int count;
 
-    if (index == -1) // port number isn't on list
-        return "";
-    else
-        return descList.at(index);
+    // sweep 1/16 of the table per refresh, the whole table is visited every 16 seconds
+    do
+    {
+        if (all)
+            count = flows.flush(expiredFlows.data(), expiredFlows.size());
+        else
+            count = flows.expire(now, flows.capacity() / 16, expiredFlows.data(), expiredFlows.size());
+
+        if (flowExportActive)
+            flowExporter->exportFlows(expiredFlows.constData(), count, now);
+    }
+    while (count == expiredFlows.size());
+
+    // send the last, partially filled export packet
+    if (flowExportActive)
+        flowExporter->flush(now);
 }
 
-void ReceiverCore::hostLookedUp(const QHostInfo &host)
+// a delta record of the dirty users, from where the last checkpoint stopped
+void ReceiverCore::checkpoint()
 {
-    if (host.error() != QHostInfo::NoError)
+    const quint64 net[8] = { netTotal, netArp, netRarp, netIcmp, netIgmp, netUdp, netTcp, netOther };
+    CheckpointRecord record(CheckpointRecord::DELTA, started, now, net, netUpTotal, netDownTotal);
+
+    int count = usersList.count();
+    int rows = 0;
+    int n = 0;
+
+    for (; n < count && rows < checkpointRows; ++n)
     {
-        // "Lookup failed:" << host.errorString();
-        return;
+        int user = (checkpointCursor + n) % count;
+        int from = usersCheckpointRow.at(user);
+
+        if (!usersDirty.at(user) && from == 0)
+            continue;
+
+        // rows touched from now on are written by the next pass over the user
+        if (from == 0)
+        {
+            usersDirty[user] = false;
+            usersNextMark[user] = lastPacket;
+        }
+
+        quint32 packets[24];
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            packets[EXPORT_IN * 8 + i] = inLists[i]->at(user);
+            packets[EXPORT_OUT * 8 + i] = outLists[i]->at(user);
+            packets[EXPORT_ALL * 8 + i] = allLists[i]->at(user);
+        }
+        packets[EXPORT_IN * 8 + COUNTER_COUNT] = usersTotalIn.at(user);
+        packets[EXPORT_OUT * 8 + COUNTER_COUNT] = usersTotalOut.at(user);
+        packets[EXPORT_ALL * 8 + COUNTER_COUNT] = usersTotal.at(user);
+
+        int next;
+        rows+=record.addUser(user, usersList.at(user).toString(), usersName.at(user), usersTimeOn.at(user), usersUp.at(user), usersDown.at(user),
+                             usersPeersCount.at(user), packets, usersPeers.at(user).toBytes(), usersHosts.at(user), usersApps.at(user),
+                             usersAppsSeen.at(user), usersMark.at(user), from, checkpointRows - rows, &next);
+
+        // not written in full, the next checkpoint goes on from this user
+        usersCheckpointRow[user] = next;
+        if (next != 0)
+            break;
+
+        // rows touched later in the same second are written again
+        usersMark[user] = usersNextMark.at(user);
     }
 
-    for (int i = 0; i < usersHosts.count(); ++i)
-        for (int j = 0; j < usersHosts.at(i).hostIp.count(); ++j)
-            foreach (QHostAddress address, host.addresses())
-            {
-                hostAddr.S_un.S_addr = usersHosts.at(i).hostIp.at(j);
+    if (count > 0)
+        checkpointCursor = (checkpointCursor + n) % count;
 
-                if (inet_ntoa(hostAddr) == address.toString())
-                {
-                    usersHosts[i].hostName[j] = host.hostName();
+    journal->append(record.finish());
+}
 
-                    emit signalNewHostName(address.toString(), host.hostName());
-                }
-            }
+// the recovered users, rows and counters; the Top-N, flows, VLANs and the
+// per port estimates start again empty
+void ReceiverCore::restore(const CheckpointData &data)
+{
+    const SessionData &session = data.session;
+
+    started = session.started;
+
+    for (int i = 0; i < session.usersList.count(); ++i)
+    {
+        int user = addUser(IpAddress::fromString(session.usersList.at(i)), session.usersTimeOn.at(i));
+
+        if (usersName.at(user).isEmpty() && !session.usersName.at(i).isEmpty())
+        {
+            usersName[user] = session.usersName.at(i);
+            emit signalNewUserName(session.usersList.at(i), session.usersName.at(i));
+        }
+
+        usersUp[user] = usersUpPrev[user] = session.usersUp.at(i);
+        usersDown[user] = usersDownPrev[user] = session.usersDown.at(i);
+
+        for (int j = 0; j < COUNTER_COUNT; ++j)
+        {
+            (*inLists[j])[user] = session.usersPackets[EXPORT_IN][j].at(i);
+            (*outLists[j])[user] = session.usersPackets[EXPORT_OUT][j].at(i);
+            (*allLists[j])[user] = session.usersPackets[EXPORT_ALL][j].at(i);
+        }
+        usersTotalIn[user] = session.usersPackets[EXPORT_IN][COUNTER_COUNT].at(i);
+        usersTotalOut[user] = session.usersPackets[EXPORT_OUT][COUNTER_COUNT].at(i);
+        usersTotal[user] = session.usersPackets[EXPORT_ALL][COUNTER_COUNT].at(i);
+
+        // an estimate of another precision starts again
+        usersPeers[user].fromBytes(data.usersPeers.at(i));
+        usersPeersCount[user] = session.usersPeers.at(i);
+
+        const Hosts &host = session.usersHosts.at(i);
+        usersHosts[user] = host;
+        for (int j = 0; j < host.hostIp.count(); ++j)
+        {
+            const IpAddress &ip = host.hostIp.at(j);
+
+            // the "other hosts" row
+            if (ip.isNull())
+                continue;
+
+            usersHostsIndex[user].insert(ip, j);
+            hostsUsers.insert(ip, user);
+
+            if (host.hostName.at(j).isEmpty())
+                resolver->lookup(ip);
+        }
+        hostsMemory+=(quint64)host.hostIp.count() * HOST_ROW_BYTES;
+
+        usersApps[user] = session.usersApps.at(i);
+        usersAppsSeen[user] = data.usersAppsSeen.at(i);
+        appsMemory+=(quint64)session.usersApps.at(i).hostPort.count() * APP_ROW_BYTES;
+
+        // already in the journal
+        usersDirty[user] = false;
+        usersMark[user] = now;
+    }
+
+    netTotal = netTotalPrev = session.netPackets[0];
+    netArp = session.netPackets[1];
+    netRarp = session.netPackets[2];
+    netIcmp = session.netPackets[3];
+    netIgmp = session.netPackets[4];
+    netUdp = session.netPackets[5];
+    netTcp = session.netPackets[6];
+    netOther = session.netPackets[7];
+
+    netUpTotal = netUpTotalPrev = session.netUp;
+    netDownTotal = netDownTotalPrev = session.netDown;
 }
 
-void ReceiverCore::userLookedUp(const QHostInfo &host)
+// Prometheus/OpenMetrics text exposition helpers
+static void appendFamily(QByteArray &out, const char *name, const char *type, const char *help)
 {
-    if (host.error() != QHostInfo::NoError)
+    out.append("# HELP ");
+    out.append(name);
+    out.append(' ');
+    out.append(help);
+    out.append("\n# TYPE ");
+    out.append(name);
+    out.append(' ');
+    out.append(type);
+    out.append('\n');
+}
+
+static void appendSample(QByteArray &out, const char *name, const QByteArray &labels, const QByteArray &value)
+{
+    out.append(name);
+    if (!labels.isEmpty())
     {
-        // "Lookup failed:" << host.errorString();
-        return;
+        out.append('{');
+        out.append(labels);
+        out.append('}');
     }
+    out.append(' ');
+    out.append(value);
+    out.append('\n');
+}
 
-    for (int i = 0; i < usersList.count(); ++i)
+QByteArray ReceiverCore::renderMetrics()
+{
+    // indexed by CounterId
+    static const char *protocols[COUNTER_COUNT] = { "arp", "rarp", "icmp", "igmp", "tcp", "udp", "other" };
+
+    QByteArray out;
+    out.reserve(metricsSize + 1024);
+
+    // network
+    appendFamily(out, "lananalyzer_packets_total", "counter", "Captured packets by protocol.");
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+        appendSample(out, "lananalyzer_packets_total", QByteArray("protocol=\"") + protocols[i] + '"', QByteArray::number(*netCounters[i]));
+
+    appendFamily(out, "lananalyzer_sampling_rate", "gauge", "Packets or flows each sampled one stands for, 1 if not sampling; counters are estimates above 1.");
+    appendSample(out, "lananalyzer_sampling_rate", QByteArray("mode=\"") + (samplingMode == SAMPLING_FLOW ? "flow" : samplingMode == SAMPLING_COUNT ? "count" : "off") + '"', QByteArray::number(samplingRate));
+
+    appendFamily(out, "lananalyzer_packets_per_second", "gauge", "Captured packets during the last refresh interval.");
+    appendSample(out, "lananalyzer_packets_per_second", QByteArray(), QByteArray::number(netPacketsSpeed));
+
+    static const char *layers[4] = { "link", "encapsulation", "network", "transport" };
+
+    appendFamily(out, "lananalyzer_malformed_packets_total", "counter", "Packets with an invalid or not captured header, by layer.");
+    for (int i = 0; i < 4; ++i)
+        appendSample(out, "lananalyzer_malformed_packets_total", QByteArray("layer=\"") + layers[i] + '"', QByteArray::number(malformedPackets[i]));
+
+    appendFamily(out, "lananalyzer_truncated_packets_total", "counter", "Packets captured shorter than on the wire (snaplen).");
+    appendSample(out, "lananalyzer_truncated_packets_total", QByteArray(), QByteArray::number(truncatedPackets));
+
+    appendFamily(out, "lananalyzer_fragments_total", "counter", "IP fragments: first, later ones attributed to the first fragment's ports, and later ones without a first fragment.");
+    appendSample(out, "lananalyzer_fragments_total", "state=\"first\"", QByteArray::number(fragmentPackets[FRAGMENT_FIRST]));
+    appendSample(out, "lananalyzer_fragments_total", "state=\"attributed\"", QByteArray::number(fragmentPackets[FRAGMENT_LATER]));
+    appendSample(out, "lananalyzer_fragments_total", "state=\"unmatched\"", QByteArray::number(fragmentPackets[FRAGMENT_UNMATCHED]));
+
+    appendFamily(out, "lananalyzer_bytes_total", "counter", "Bytes transferred between the local network and the Internet.");
+    appendSample(out, "lananalyzer_bytes_total", "direction=\"up\"", QByteArray::number(netUpTotal));
+    appendSample(out, "lananalyzer_bytes_total", "direction=\"down\"", QByteArray::number(netDownTotal));
+
+    appendFamily(out, "lananalyzer_bytes_per_second", "gauge", "Transfer rate during the last refresh interval.");
+    appendSample(out, "lananalyzer_bytes_per_second", "direction=\"up\"", QByteArray::number(netUpSpeed));
+    appendSample(out, "lananalyzer_bytes_per_second", "direction=\"down\"", QByteArray::number(netDownSpeed));
+
+    // VLANs
+    appendFamily(out, "lananalyzer_vlan_packets_total", "counter", "Captured packets by outer VLAN ID, 0 for untagged frames.");
+    for (int i = 0; i < vlanList.count(); ++i)
+        appendSample(out, "lananalyzer_vlan_packets_total", "vlan=\"" + QByteArray::number(vlanList.at(i)) + '"', QByteArray::number(vlanPackets.at(vlanList.at(i))));
+
+    // the total is a family of its own, a sum over direction must not count it twice
+    appendFamily(out, "lananalyzer_vlan_captured_bytes_total", "counter", "Captured bytes by outer VLAN ID, 0 for untagged frames.");
+    for (int i = 0; i < vlanList.count(); ++i)
+        appendSample(out, "lananalyzer_vlan_captured_bytes_total", "vlan=\"" + QByteArray::number(vlanList.at(i)) + '"', QByteArray::number(vlanBytes.at(vlanList.at(i))));
+
+    appendFamily(out, "lananalyzer_vlan_bytes_total", "counter", "Bytes between the local network and the Internet by outer VLAN ID.");
+    for (int i = 0; i < vlanList.count(); ++i)
+    {
+        quint16 vlan = vlanList.at(i);
+        QByteArray labels = "vlan=\"" + QByteArray::number(vlan) + '"';
+
+        appendSample(out, "lananalyzer_vlan_bytes_total", labels + ",direction=\"up\"", QByteArray::number(vlanUp.at(vlan)));
+        appendSample(out, "lananalyzer_vlan_bytes_total", labels + ",direction=\"down\"", QByteArray::number(vlanDown.at(vlan)));
+    }
+
+    appendFamily(out, "lananalyzer_users", "gauge", "Active users in the local network.");
+    appendSample(out, "lananalyzer_users", QByteArray(), QByteArray::number(usersList.count()));
+
+    // users, capped to keep the series cardinality bounded
+    int users = qMin(usersList.count(), metricsMaxUsers);
+
+    QList<QByteArray> userLabels;
+    for (int i = 0; i < users; ++i)
+        userLabels.append(QByteArray("user=\"") + usersList.at(i).toString().toLatin1() + '"');
+
+    appendFamily(out, "lananalyzer_user_bytes_total", "counter", "Bytes transferred by a user.");
+    for (int i = 0; i < users; ++i)
     {
-        userAddr.S_un.S_addr = usersList.at(i);
-        QString user = inet_ntoa(userAddr);
+        appendSample(out, "lananalyzer_user_bytes_total", userLabels.at(i) + ",direction=\"up\"", QByteArray::number(usersUp.at(i)));
+        appendSample(out, "lananalyzer_user_bytes_total", userLabels.at(i) + ",direction=\"down\"", QByteArray::number(usersDown.at(i)));
+    }
 
-        foreach (QHostAddress address, host.addresses())
+    appendFamily(out, "lananalyzer_user_bytes_per_second", "gauge", "User transfer rate during the last refresh interval.");
+    for (int i = 0; i < users; ++i)
+    {
+        appendSample(out, "lananalyzer_user_bytes_per_second", userLabels.at(i) + ",direction=\"up\"", QByteArray::number(usersUpSpeed.at(i) * 1024.0, 'f', 0));
+        appendSample(out, "lananalyzer_user_bytes_per_second", userLabels.at(i) + ",direction=\"down\"", QByteArray::number(usersDownSpeed.at(i) * 1024.0, 'f', 0));
+    }
+
+    appendFamily(out, "lananalyzer_user_packets_total", "counter", "Packets sent (out) and received (in) by a user, by protocol.");
+    for (int i = 0; i < users; ++i)
+        for (int j = 0; j < COUNTER_COUNT; ++j)
         {
-            if (user == address.toString())
+            QByteArray labels = userLabels.at(i) + ",protocol=\"" + protocols[j] + '"';
+
+            appendSample(out, "lananalyzer_user_packets_total", labels + ",direction=\"in\"", QByteArray::number(inLists[j]->at(i)));
+            appendSample(out, "lananalyzer_user_packets_total", labels + ",direction=\"out\"", QByteArray::number(outLists[j]->at(i)));
+        }
+
+    // hosts, capped over all users
+    int hosts = 0, hostsDropped = 0;
+
+    appendFamily(out, "lananalyzer_host_bytes_total", "counter", "Bytes transferred between a user and a remote host.");
+    for (int i = 0; i < usersHosts.count(); ++i)
+    {
+        const Hosts &host = usersHosts.at(i);
+
+        for (int j = 0; j < host.hostIp.count(); ++j)
+        {
+            if (i >= users || hosts >= metricsMaxHosts)
             {
-                if (QString::compare(user, host.hostName(), Qt::CaseSensitive) !=0)
-                    emit signalNewUserName(user, host.hostName());
+                ++hostsDropped;
+                continue;
             }
+
+            QByteArray labels = userLabels.at(i) + ",host=\"" + host.hostIp.at(j).toString().toLatin1() + '"';
+
+            appendSample(out, "lananalyzer_host_bytes_total", labels + ",direction=\"up\"", QByteArray::number(host.upBytes.at(j)));
+            appendSample(out, "lananalyzer_host_bytes_total", labels + ",direction=\"down\"", QByteArray::number(host.downBytes.at(j)));
+
+            ++hosts;
         }
     }
+
+    appendFamily(out, "lananalyzer_user_peers", "gauge", "Estimated distinct remote hosts of a user (HyperLogLog).");
+    for (int i = 0; i < users; ++i)
+        appendSample(out, "lananalyzer_user_peers", userLabels.at(i), QByteArray::number(usersPeersCount.at(i)));
+
+    // ports, capped as the hosts
+    appendFamily(out, "lananalyzer_port_peers", "gauge", "Estimated distinct remote hosts on a port (HyperLogLog).");
+    int ports = 0;
+    QHash<quint32, HyperLogLog>::const_iterator it = portsPeers.constBegin();
+    for (; it != portsPeers.constEnd() && ports < metricsMaxHosts; ++it, ++ports)
+        appendSample(out, "lananalyzer_port_peers", "port=\"" + QByteArray::number(it.key()) + '"', QByteArray::number(it.value().count()));
+
+    appendFamily(out, "lananalyzer_packets_not_detailed_total", "counter", "Packets of remote hosts without a Hosts row, only counted in low memory mode.");
+    appendSample(out, "lananalyzer_packets_not_detailed_total", QByteArray(), QByteArray::number(packetsNotDetailed));
+
+    appendFamily(out, "lananalyzer_table_memory_bytes", "gauge", "Estimated memory of the per user host and application rows.");
+    appendSample(out, "lananalyzer_table_memory_bytes", "table=\"hosts\"", QByteArray::number(hostsMemory));
+    appendSample(out, "lananalyzer_table_memory_bytes", "table=\"apps\"", QByteArray::number(appsMemory));
+
+    appendFamily(out, "lananalyzer_table_rows_evicted_total", "counter", "Host and application rows folded into the users' other rows by the memory budget.");
+    appendSample(out, "lananalyzer_table_rows_evicted_total", "table=\"hosts\"", QByteArray::number(rowsEvicted[0]));
+    appendSample(out, "lananalyzer_table_rows_evicted_total", "table=\"apps\"", QByteArray::number(rowsEvicted[1]));
+
+    appendFamily(out, "lananalyzer_resolver_lookups_total", "counter", "Reverse DNS lookups started and failed, cache hits and lookups dropped by a full queue.");
+    appendSample(out, "lananalyzer_resolver_lookups_total", "result=\"started\"", QByteArray::number(resolver->lookups()));
+    appendSample(out, "lananalyzer_resolver_lookups_total", "result=\"failed\"", QByteArray::number(resolver->failures()));
+    appendSample(out, "lananalyzer_resolver_lookups_total", "result=\"cached\"", QByteArray::number(resolver->hits()));
+    appendSample(out, "lananalyzer_resolver_lookups_total", "result=\"dropped\"", QByteArray::number(resolver->dropped()));
+
+    appendFamily(out, "lananalyzer_names_discovered_total", "counter", "Address names seen in name service answers, by protocol.");
+    appendSample(out, "lananalyzer_names_discovered_total", "source=\"dns\"", QByteArray::number(namesDiscovered[NAME_DNS]));
+    appendSample(out, "lananalyzer_names_discovered_total", "source=\"mdns\"", QByteArray::number(namesDiscovered[NAME_MDNS]));
+    appendSample(out, "lananalyzer_names_discovered_total", "source=\"dhcp\"", QByteArray::number(namesDiscovered[NAME_DHCP]));
+    appendSample(out, "lananalyzer_names_discovered_total", "source=\"netbios\"", QByteArray::number(namesDiscovered[NAME_NETBIOS]));
+
+    appendFamily(out, "lananalyzer_resolver_pending", "gauge", "Reverse DNS lookups running and waiting in the queue.");
+    appendSample(out, "lananalyzer_resolver_pending", "state=\"running\"", QByteArray::number(resolver->running()));
+    appendSample(out, "lananalyzer_resolver_pending", "state=\"queued\"", QByteArray::number(resolver->queued()));
+
+    appendFamily(out, "lananalyzer_series_dropped", "gauge", "Users and hosts left out of the exposition by the cardinality caps.");
+    appendSample(out, "lananalyzer_series_dropped", "kind=\"user\"", QByteArray::number(usersList.count() - users));
+    appendSample(out, "lananalyzer_series_dropped", "kind=\"host\"", QByteArray::number(hostsDropped));
+
+    // flows
+    appendFamily(out, "lananalyzer_flows", "gauge", "Flows in the flow table.");
+    appendSample(out, "lananalyzer_flows", QByteArray(), QByteArray::number(flows.count()));
+
+    appendFamily(out, "lananalyzer_flows_capacity", "gauge", "Preallocated flow table slots.");
+    appendSample(out, "lananalyzer_flows_capacity", QByteArray(), QByteArray::number(flows.capacity()));
+
+    appendFamily(out, "lananalyzer_flows_expired_total", "counter", "Flows expired by the idle or active timeout.");
+    appendSample(out, "lananalyzer_flows_expired_total", QByteArray(), QByteArray::number(flows.expired()));
+
+    appendFamily(out, "lananalyzer_flows_dropped_total", "counter", "New flows not tracked because the flow table was full.");
+    appendSample(out, "lananalyzer_flows_dropped_total", QByteArray(), QByteArray::number(flows.dropped()));
+
+    appendFamily(out, "lananalyzer_flow_export_packets_total", "counter", "IPFIX/NetFlow export packets sent to the collector.");
+    appendSample(out, "lananalyzer_flow_export_packets_total", QByteArray(), QByteArray::number(flowExporter->exportedPackets()));
+
+    appendFamily(out, "lananalyzer_flow_export_records_total", "counter", "Flow records sent to the collector.");
+    appendSample(out, "lananalyzer_flow_export_records_total", QByteArray(), QByteArray::number(flowExporter->exportedRecords()));
+
+    appendFamily(out, "lananalyzer_flow_export_dropped_total", "counter", "Flow records lost because an export packet could not be sent.");
+    appendSample(out, "lananalyzer_flow_export_dropped_total", QByteArray(), QByteArray::number(flowExporter->droppedRecords()));
+
+    out.append("# EOF\n");
+
+    metricsSize = out.size();
+
+    return out;
 }
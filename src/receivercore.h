@@ -25,34 +25,67 @@
 #include <QDateTime>
 #include <QMetaType>
 #include <QFile>
+#include <QByteArray>
 
 #include "capturethread.h"
+#include "flowtable.h"
+#include "flowexporter.h"
+#include "topcounter.h"
+#include "hyperloglog.h"
+#include "hostresolver.h"
+#include "portdatabase.h"
+
+class CheckpointJournal;
+struct CheckpointData;
 
 struct Hosts
 {
-    QList<quint32> hostIp;
+    Hosts() : folds(0) {}
+
+    QList<IpAddress> hostIp;
     QList<QString> hostName;
     QList<QString> dPort;
     QList<QString> dApp;
     QList<quint64> upBytes;
     QList<quint64> downBytes;
-    QList<QString> firstVisit;
-    QList<QString> lastVisit;
+    QList<quint64> firstVisit;     // seconds since the epoch, formatted by the views
+    QList<quint64> lastVisit;
+    quint32 folds;                 // evictions so far, the rows moved if it changed
 };
 
 typedef QList<Hosts> hostsList;
 
 struct Apps
 {
+    Apps() : folds(0) {}
+
     QList<QString> hostPort;
     QList<QString> hostPortName;
     QList<quint64> upBytes;
     QList<quint64> downBytes;
+    quint32 folds;                 // evictions so far, the rows moved if it changed
 };
 
 
 typedef QList<Apps> appsList;
 
+// Top-N kinds and directions, see ReceiverCore::setTopActive()
+enum { TOP_USERS, TOP_HOSTS, TOP_APPS, TOP_COUNT };
+enum { TOP_UP, TOP_DOWN };
+
+// columns of the users' packet counters, see ExportJob and SessionData
+enum { EXPORT_IN, EXPORT_OUT, EXPORT_ALL };
+
+struct TopEntry
+{
+    quint64 key;        // user index, host index or port
+    QString name;
+    quint64 bytes;
+    quint64 error;      // bytes may be overestimated by at most error
+};
+
+typedef QList<TopEntry> topEntryList;
+
 typedef QList<quint32> quint32List;
 typedef QList<quint64> quint64List;
 typedef QList<qreal> qrealList;
@@ -66,20 +99,54 @@ public:
     explicit ReceiverCore(QObject *parent = 0, CaptureThread *thread = 0);
     ~ReceiverCore();
 
-    void setData(quint32 netMask, quint32 pcIP);
+    void setData(quint32 netMask, quint32 pcIP, const QList<IpAddress> &localIPv6);
+    void setMetrics(bool enabled, int maxUsers, int maxHosts);
+    void setFlows(quint32 capacity, quint32 idleTimeout, quint32 activeTimeout);
+    void setSampling(quint8 mode, quint32 rate);
+    void setTopCapacity(int capacity);
+    void setHosts(bool lowMemory, int maxHosts, int precision);
+    void setMemoryBudget(quint64 budget);
+    void setResolver(bool lookups, int maxRunning, int cacheSize, quint32 ttl, quint32 negativeTtl, const QString &hostsFile);
+    void setFlowExport(bool enabled, quint8 version, const QString &collector, quint16 port, quint32 domain, quint32 templateRefresh);
+    void setCheckpoint(bool enabled, quint32 interval, int maxRows, qint64 compactSize, const QString &fileName);
+    void setPortDatabase(PortDatabase *database);
 
 private:
     QTimer *refreshTimer;
 
     quint32 netMask, pcIP;
-    struct in_addr addr, userAddr, hostAddr;
+    QList<IpAddress> localIPv6;
 
     // users
-    QList<quint32> usersList;
+    QList<IpAddress> usersList;
+    QHash<IpAddress, int> usersIndex;
+    QList<QString> usersName;
+    QList<quint64> usersTimeOn;    // seconds since the epoch
 
     QList<Hosts> usersHosts;
+    QList< QHash<IpAddress, int> > usersHostsIndex;
     QList<Apps> usersApps;
 
+    // memory budget of the host and app rows, 0 unlimited; rows last seen
+    // longest ago are folded into an "other" row per user when it is exceeded
+    QList< QVector<quint64> > usersAppsSeen;
+    quint64 memoryBudget;
+    quint64 hostsMemory, appsMemory;
+    quint64 rowsEvicted[2];     // hosts, apps
+    quint64 now;                // seconds since the epoch, updated every refresh
+    quint64 started;
+
+    // distinct remote hosts of a user and on a port; in low memory mode only the
+    // first hostsMax hosts of a user get a Hosts row, the rest are only counted
+    QList<HyperLogLog> usersPeers;
+    QList<quint32> usersPeersCount;
+    QList<bool> usersPeersChanged;
+    QHash<quint32, HyperLogLog> portsPeers;
+    bool hostsLowMemory;
+    int hostsMax;
+    int hostsPrecision;
+    quint64 packetsNotDetailed;
+
     QList<quint64> usersUp, usersDown,
                    usersUpPrev, usersDownPrev;
     QList<qreal> usersUpSpeed, usersDownSpeed;
@@ -102,48 +169,147 @@ private:
             netOther;
     quint64 netTotalPrev;
 
-    // ports
-    QList<QString> protocolList, portList, descList;
+    // per protocol counters and lists, indexed by CounterId
+    quint64 *netCounters[COUNTER_COUNT];
+    QList<quint32> *allLists[COUNTER_COUNT], *inLists[COUNTER_COUNT], *outLists[COUNTER_COUNT];
+
+    // decoding problems, malformed by MALFORMED_* bit
+    quint64 malformedPackets[4];
+    quint64 truncatedPackets;
+
+    // IP fragments, indexed by FRAGMENT_* state
+    quint64 fragmentPackets[4];
+
+    // per VLAN, indexed by the VLAN ID (0 untagged)
+    QVector<quint64> vlanPackets, vlanBytes, vlanUp, vlanDown;
+    QList<quint16> vlanList;
+
+    // speeds from the last refresh
+    quint64 netPacketsSpeed, netUpSpeed, netDownSpeed;
+
+    // sampling, counters are scaled by the packet weight
+    quint8 samplingMode;
+    quint32 samplingRate;
+
+    // heavy hitters by TOP_* kind and direction, since the start and over the last minute
+    TopCounter topTotal[TOP_COUNT][2];
+    TopWindow topWindow[TOP_COUNT][2];
+
+    // remote hosts of all users, keys of the TOP_HOSTS counters; the ones the
+    // counters no longer hold are swept and their keys reused
+    QList<IpAddress> hostsList;
+    QHash<IpAddress, int> hostsIndex;
+    QList<QString> hostsName;
+    QList<int> hostsFree;
+    int hostsSweep;             // hosts in hostsIndex that start the next sweep
+
+    // names of users and remote hosts; users having a row of the remote host,
+    // so an answer touches only the rows of its address
+    HostResolver *resolver;
+    QMultiHash<IpAddress, int> hostsUsers;
+    quint64 namesDiscovered[NAME_SOURCES];
+
+    // requested Top-N, none if topSize is 0
+    quint8 topKind, topDirection;
+    bool topInWindow;
+    int topSize;
+
+    // metrics exposition
+    bool metricsEnabled;
+    int metricsMaxUsers, metricsMaxHosts;
+    int metricsSize;
+
+    // flows
+    FlowTable flows;
+    quint32 flowsCapacity;
+    QVector<Flow> expiredFlows;
+
+    // checkpoints every checkpointInterval seconds of the users with new counters, with
+    // their rows seen at or after the user's mark (packet time), at most checkpointRows
+    // rows in all; a user not written in full goes on from its next row in the next one
+    // and the users not reached wait for it
+    CheckpointJournal *journal;
+    bool checkpointEnabled;
+    quint32 checkpointInterval;
+    int checkpointRows;
+    qint64 checkpointCompact;
+    QString checkpointFile;
+    quint64 nextCheckpoint;
+    int checkpointCursor;
+    quint64 lastPacket;         // seconds since the epoch
+    QList<bool> usersDirty;
+    QList<quint64> usersMark;
+    QList<quint64> usersNextMark;   // the mark once the user is written in full
+    QList<int> usersCheckpointRow;  // the row to go on from, 0 at the start of the user
+
+    // flow export
+    FlowExporter *flowExporter;
+    bool flowExportEnabled;     // as configured
+    bool flowExportActive;      // in this capture, the collector was resolved
+    quint8 flowExportVersion;
+    QString flowExportCollector;
+    quint16 flowExportPort;
+    quint32 flowExportDomain;
+    quint32 flowExportTemplateRefresh;
+
+    // ports, a snapshot of the shared table taken again when a new one is swapped in
+    PortDatabase *portDatabase;
+    QSharedPointer<const PortTable> ports;
 
     void clearVariables();
 
-    void incrementNetCounters(quint16 type);
-    void incrementInLists(quint16 type, qint32 i);
-    void incrementOutLists(quint16 type, qint32 i);
+    void incrementNetCounters(quint8 counter, quint32 weight);
+    void incrementInLists(quint8 counter, qint32 i, quint32 weight);
+    void incrementOutLists(quint8 counter, qint32 i, quint32 weight);
 
-    bool checkIP(quint32 ip);
-    bool multicastIP(quint32 ip);
+    bool checkIP(const IpAddress &ip);
+    bool multicastIP(const IpAddress &ip);
 
-    void listsAppend();
+    int userIndex(const IpAddress &ip);
+    int addUser(const IpAddress &ip, quint64 timeOn);
+    int hostIndex(int user, const IpAddress &ip, quint32 port, quint64 time);
+    int appIndex(int user, quint32 port);
+    int remoteIndex(const IpAddress &ip);
+    void sweepHosts();
+
+    void evictRows();
+    void foldHosts(int user, const QVector<bool> &evicted);
+    void foldApps(int user, const QVector<bool> &evicted);
+    void addPeer(int user, const IpAddress &ip, quint32 port);
+    void addNames(const QList<DiscoveredName> &names);
 
-    void loadPorts();
+    void addTop(quint8 kind, quint8 direction, quint64 key, quint64 bytes);
+    void emitTopActive();
+
+    void listsAppend();
 
     QString portToName(quint16 port);
 
+    QByteArray renderMetrics();
+
+    void expireFlows(bool all);
+
+    void checkpoint();
+    void restore(const CheckpointData &data);
+
 private slots:
-    void receivedPacket(const QString &time,
-                        quint32 length,
-                        const QString &sMac,
-                        const QString &dMac,
-                        quint16 type,
-                        quint32 sIP,
-                        quint32 dIP,
-                        quint32 sPort,
-                        quint32 dPort,
-                        const QString &info);
+    void receivedPacket(const Packet &packet);
 
     void updateRefreshTimer();
 
-    void hostLookedUp(const QHostInfo &host);
-    void userLookedUp(const QHostInfo &host);
+    void nameResolved(const IpAddress &ip, const QString &name);
 
     void start();
     void stop();
 
+public slots:
+    void setTopActive(quint8 kind, quint8 direction, bool window, int size);
+    void saveSession(const QString &fileName);
+
 signals:
     void infoMessage(quint8 type, const QString &title, const QString &message);
 
-    void signalMulticast(quint32 multicastIP, quint32 otherIP, quint32 length, quint8 direction);
+    void signalMulticast(const IpAddress &multicastIP, const IpAddress &otherIP, quint32 length, quint8 direction);
 
     void signalNetPackets(quint64 netTotal, quint64 netArp, quint64 netRarp, quint64 netIcmp, quint64 netIgmp, quint64 netUdp, quint64 netTcp, quint64 netOther);
     void signalNetPacketsSpeed(quint16 packetsSpeed);
@@ -154,6 +320,8 @@ signals:
     void signalNewUserName(const QString &user, const QString &name);
 
     void signalUsersTransfer(QList<quint64> usersUp, QList<quint64> usersDown);
+    void signalUsersPeers(QList<quint32> usersPeers);
+    void signalMemory(quint64 hosts, quint64 apps, quint64 estimators, quint64 budget);
     void signalUsersSpeed(QList<qreal> usersUpSpeed, QList<qreal> usersDownSpeed);
 
     void netAllPackets(QList<quint32> userArp, QList<quint32> userRarp, QList<quint32> userIcmp, QList<quint32> userIgmp, QList<quint32> userTcp, QList<quint32> userUdp, QList<quint32> userOther, QList<quint32> userTotal);
@@ -166,6 +334,10 @@ signals:
 
     void signalUsersApps(QList<Apps> usersApps);
     void signalUsersHosts(QList<Hosts> usersHosts);
+
+    void signalMetrics(const QByteArray &exposition);
+
+    void signalTopActive(quint8 kind, quint8 direction, bool window, quint64 total, QList<TopEntry> top);
 };
 
 #endif // RECEIVERCORE_H
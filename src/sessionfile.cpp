@@ -0,0 +1,557 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "sessionfile.h"
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QtEndian>
+
+#include <string.h>
+
+namespace
+{
+    const char MAGIC[8] = { 'L', 'A', 'N', 'A', 'S', 'E', 'S', 'S' };
+
+    const int HEADER_SIZE = 32;     // magic, version, columns, started, saved
+    const int ENTRY_SIZE = 24;      // id, width, rows, offset
+
+    // column IDs, part of the file format: never renumbered, new ones get new numbers
+    enum
+    {
+        COL_STRING_OFFSETS = 1,     // quint32, strings + 1 offsets into COL_STRING_DATA
+        COL_STRING_DATA,            // UTF-8
+        COL_NET,                    // quint64, netPackets, up and down
+
+        COL_USER_IP = 16,           // string
+        COL_USER_NAME,              // string
+        COL_USER_TIME_ON,           // quint64
+        COL_USER_UP,                // quint64
+        COL_USER_DOWN,              // quint64
+        COL_USER_PEERS,             // quint32
+
+        COL_USER_PACKETS = 32,      // quint32, 24 columns: EXPORT_* * 8 + protocol
+
+        COL_HOST_USER = 64,         // quint32, user row
+        COL_HOST_FAMILY,            // quint8, 0 for the other hosts row
+        COL_HOST_IP,                // 16 bytes, an IPv4 address in the first 4, little endian
+        COL_HOST_NAME,              // string
+        COL_HOST_PORT,              // string
+        COL_HOST_APP,               // string
+        COL_HOST_UP,                // quint64
+        COL_HOST_DOWN,              // quint64
+        COL_HOST_FIRST,             // quint64
+        COL_HOST_LAST,              // quint64
+
+        COL_APP_USER = 96,          // quint32, user row
+        COL_APP_PORT,               // string
+        COL_APP_NAME,               // string
+        COL_APP_UP,                 // quint64
+        COL_APP_DOWN                // quint64
+    };
+
+    inline quint64 align(quint64 offset)
+    {
+        return (offset + 7) & ~(quint64)7;
+    }
+
+    template <class T>
+    inline void put(QByteArray &column, T value)
+    {
+        uchar bytes[sizeof(T)];
+        qToLittleEndian<T>(value, bytes);
+        column.append((const char *)bytes, sizeof(T));
+    }
+
+    struct Column
+    {
+        quint32 id;
+        quint32 width;          // bytes per row
+        QByteArray data;
+    };
+
+    // strings stored once, referenced by index
+    class StringTable
+    {
+    public:
+        StringTable() : count(0) { put<quint32>(offsets, 0); }
+
+        quint32 id(const QString &value)
+        {
+            QHash<QString, quint32>::const_iterator it = ids.constFind(value);
+            if (it != ids.constEnd())
+                return it.value();
+
+            data.append(value.toUtf8());
+            put<quint32>(offsets, data.size());
+            ids.insert(value, count);
+
+            return count++;
+        }
+
+        QByteArray offsets, data;
+
+    private:
+        QHash<QString, quint32> ids;
+        quint32 count;
+    };
+
+    // a column of the mapped file, rows past the end and missing columns read as zeros
+    class ColumnView
+    {
+    public:
+        ColumnView() : data(0), width(0), rows(0) {}
+        ColumnView(const uchar *data, quint32 width, quint64 rows) : data(data), width(width), rows(rows) {}
+
+        quint64 count() const { return rows; }
+
+        quint8 u8(quint64 row) const { return row < rows && width == 1 ? data[row] : 0; }
+        quint32 u32(quint64 row) const { return row < rows && width == 4 ? qFromLittleEndian<quint32>(data + row * 4) : 0; }
+        quint64 u64(quint64 row) const { return row < rows && width == 8 ? qFromLittleEndian<quint64>(data + row * 8) : 0; }
+        const uchar *bytes(quint64 row, quint32 length) const { return row < rows && width == length ? data + row * length : 0; }
+
+    private:
+        const uchar *data;
+        quint32 width;
+        quint64 rows;
+    };
+
+    class Reader
+    {
+    public:
+        QHash<quint32, ColumnView> columns;
+
+        ColumnView column(quint32 id) const { return columns.value(id); }
+
+        // decoded once, equal strings share the data
+        bool readStrings()
+        {
+            offsets = column(COL_STRING_OFFSETS);
+            text = column(COL_STRING_DATA);
+
+            if (offsets.count() == 0)
+                return true;
+
+            quint64 count = offsets.count() - 1;
+            strings.resize(count);
+
+            const uchar *base = text.bytes(0, 1);
+            quint32 start = offsets.u32(0);
+
+            for (quint64 i = 0; i < count; ++i)
+            {
+                quint32 end = offsets.u32(i + 1);
+
+                if (end < start || end > text.count())
+                    return false;
+
+                strings[i] = QString::fromUtf8((const char *)base + start, end - start);
+                start = end;
+            }
+
+            return true;
+        }
+
+        QString string(const ColumnView &ids, quint64 row) const
+        {
+            return strings.value(ids.u32(row));
+        }
+
+    private:
+        ColumnView offsets, text;
+        QVector<QString> strings;
+    };
+}
+
+bool SessionFile::save(const QString &fileName, const SessionData &data, QString *error)
+{
+    StringTable strings;
+    QList<Column> columns;
+
+    int users = data.usersList.count();
+
+    // users
+    QByteArray userIp, userName, userTimeOn, userUp, userDown, userPeers, userPackets[24];
+
+    for (int i = 0; i < users; ++i)
+    {
+        put<quint32>(userIp, strings.id(data.usersList.at(i)));
+        put<quint32>(userName, strings.id(data.usersName.value(i)));
+        put<quint64>(userTimeOn, data.usersTimeOn.value(i));
+        put<quint64>(userUp, data.usersUp.value(i));
+        put<quint64>(userDown, data.usersDown.value(i));
+        put<quint32>(userPeers, data.usersPeers.value(i));
+
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 8; ++k)
+                put<quint32>(userPackets[j * 8 + k], data.usersPackets[j][k].value(i));
+    }
+
+    // hosts and applications, rows of all users one after another
+    QByteArray hostUser, hostFamily, hostIp, hostName, hostPort, hostApp, hostUp, hostDown, hostFirst, hostLast;
+
+    for (int i = 0; i < users && i < data.usersHosts.count(); ++i)
+    {
+        const Hosts &host = data.usersHosts.at(i);
+
+        for (int j = 0; j < host.hostIp.count(); ++j)
+        {
+            const IpAddress &ip = host.hostIp.at(j);
+            char address[16];
+
+            memset(address, 0, sizeof(address));
+            if (ip.isIPv4())
+                qToLittleEndian<quint32>(ip.toIPv4(), (uchar *)address);
+            else if (ip.isIPv6())
+                memcpy(address, ip.toIPv6(), 16);
+
+            put<quint32>(hostUser, i);
+            hostFamily.append((char)ip.version());
+            hostIp.append(address, 16);
+            put<quint32>(hostName, strings.id(host.hostName.at(j)));
+            put<quint32>(hostPort, strings.id(host.dPort.at(j)));
+            put<quint32>(hostApp, strings.id(host.dApp.at(j)));
+            put<quint64>(hostUp, host.upBytes.at(j));
+            put<quint64>(hostDown, host.downBytes.at(j));
+            put<quint64>(hostFirst, host.firstVisit.at(j));
+            put<quint64>(hostLast, host.lastVisit.at(j));
+        }
+    }
+
+    QByteArray appUser, appPort, appName, appUp, appDown;
+
+    for (int i = 0; i < users && i < data.usersApps.count(); ++i)
+    {
+        const Apps &app = data.usersApps.at(i);
+
+        for (int j = 0; j < app.hostPort.count(); ++j)
+        {
+            put<quint32>(appUser, i);
+            put<quint32>(appPort, strings.id(app.hostPort.at(j)));
+            put<quint32>(appName, strings.id(app.hostPortName.at(j)));
+            put<quint64>(appUp, app.upBytes.at(j));
+            put<quint64>(appDown, app.downBytes.at(j));
+        }
+    }
+
+    QByteArray net;
+    for (int i = 0; i < 8; ++i)
+        put<quint64>(net, data.netPackets[i]);
+    put<quint64>(net, data.netUp);
+    put<quint64>(net, data.netDown);
+
+    // directory order is the file order
+    const struct { quint32 id; quint32 width; const QByteArray *data; } layout[] =
+    {
+        { COL_STRING_OFFSETS, 4, &strings.offsets },
+        { COL_STRING_DATA, 1, &strings.data },
+        { COL_NET, 8, &net },
+        { COL_USER_IP, 4, &userIp },
+        { COL_USER_NAME, 4, &userName },
+        { COL_USER_TIME_ON, 8, &userTimeOn },
+        { COL_USER_UP, 8, &userUp },
+        { COL_USER_DOWN, 8, &userDown },
+        { COL_USER_PEERS, 4, &userPeers },
+        { COL_HOST_USER, 4, &hostUser },
+        { COL_HOST_FAMILY, 1, &hostFamily },
+        { COL_HOST_IP, 16, &hostIp },
+        { COL_HOST_NAME, 4, &hostName },
+        { COL_HOST_PORT, 4, &hostPort },
+        { COL_HOST_APP, 4, &hostApp },
+        { COL_HOST_UP, 8, &hostUp },
+        { COL_HOST_DOWN, 8, &hostDown },
+        { COL_HOST_FIRST, 8, &hostFirst },
+        { COL_HOST_LAST, 8, &hostLast },
+        { COL_APP_USER, 4, &appUser },
+        { COL_APP_PORT, 4, &appPort },
+        { COL_APP_NAME, 4, &appName },
+        { COL_APP_UP, 8, &appUp },
+        { COL_APP_DOWN, 8, &appDown }
+    };
+
+    const int fixed = sizeof(layout) / sizeof(layout[0]);
+
+    for (int i = 0; i < fixed; ++i)
+    {
+        Column column;
+        column.id = layout[i].id;
+        column.width = layout[i].width;
+        column.data = *layout[i].data;
+        columns.append(column);
+    }
+
+    for (int i = 0; i < 24; ++i)
+    {
+        Column column;
+        column.id = COL_USER_PACKETS + i;
+        column.width = 4;
+        column.data = userPackets[i];
+        columns.append(column);
+    }
+
+    // header and directory
+    QByteArray head;
+    head.append(MAGIC, 8);
+    put<quint32>(head, VERSION | (MINOR_VERSION << 16));
+    put<quint32>(head, columns.count());
+    put<quint64>(head, data.started);
+    put<quint64>(head, data.saved);
+
+    quint64 offset = align(HEADER_SIZE + ENTRY_SIZE * columns.count());
+
+    for (int i = 0; i < columns.count(); ++i)
+    {
+        const Column &column = columns.at(i);
+
+        put<quint32>(head, column.id);
+        put<quint32>(head, column.width);
+        put<quint64>(head, column.data.size() / column.width);
+        put<quint64>(head, offset);
+
+        offset = align(offset + column.data.size());
+    }
+
+    // written next to the old file, which is replaced only when complete
+    QString tempName = fileName + ".tmp";
+    QFile file(tempName);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    bool ok = file.write(head) == head.size() && file.write(padding, align(head.size()) - head.size()) >= 0;
+
+    for (int i = 0; i < columns.count() && ok; ++i)
+    {
+        const QByteArray &column = columns.at(i).data;
+
+        ok = file.write(column) == column.size() && file.write(padding, align(column.size()) - column.size()) >= 0;
+    }
+
+    if (!ok)
+    {
+        *error = file.errorString();
+        file.close();
+        file.remove();
+        return false;
+    }
+
+    file.close();
+
+    // the previous file is set aside until the new one is in place
+    QString old = fileName + ".old";
+    QFile::remove(old);
+
+    if (QFile::exists(fileName) && !QFile::rename(fileName, old))
+    {
+        *error = tr("Unable to replace %1").arg(fileName);
+        QFile::remove(tempName);
+        return false;
+    }
+
+    if (!QFile::rename(tempName, fileName))
+    {
+        QFile::rename(old, fileName);
+        QFile::remove(tempName);
+
+        *error = tr("Unable to rename %1").arg(tempName);
+        return false;
+    }
+
+    QFile::remove(old);
+
+    return true;
+}
+
+bool SessionFile::load(const QString &fileName, SessionData &data, QString *error)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    quint64 size = file.size();
+
+    if (size < HEADER_SIZE)
+    {
+        *error = tr("Not a session file");
+        return false;
+    }
+
+    // unmapped when the file is closed
+    const uchar *map = file.map(0, size);
+
+    if (!map)
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    if (memcmp(map, MAGIC, 8) != 0)
+    {
+        *error = tr("Not a session file");
+        return false;
+    }
+
+    quint32 version = qFromLittleEndian<quint32>(map + 8) & 0xffff;
+    quint32 count = qFromLittleEndian<quint32>(map + 12);
+
+    // a newer minor version only adds columns, they are skipped
+    if (version > VERSION)
+    {
+        *error = tr("Session file version %1 is newer than supported (%2)").arg(version).arg(VERSION);
+        return false;
+    }
+
+    if (count > (size - HEADER_SIZE) / ENTRY_SIZE)
+    {
+        *error = tr("Damaged session file");
+        return false;
+    }
+
+    data.started = qFromLittleEndian<quint64>(map + 16);
+    data.saved = qFromLittleEndian<quint64>(map + 24);
+
+    Reader reader;
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        const uchar *entry = map + HEADER_SIZE + i * ENTRY_SIZE;
+
+        quint32 id = qFromLittleEndian<quint32>(entry);
+        quint32 width = qFromLittleEndian<quint32>(entry + 4);
+        quint64 rows = qFromLittleEndian<quint64>(entry + 8);
+        quint64 offset = qFromLittleEndian<quint64>(entry + 16);
+
+        if (width == 0 || offset > size || rows > (size - offset) / width)
+        {
+            *error = tr("Damaged session file");
+            return false;
+        }
+
+        reader.columns.insert(id, ColumnView(map + offset, width, rows));
+    }
+
+    if (!reader.readStrings())
+    {
+        *error = tr("Damaged session file");
+        return false;
+    }
+
+    // users
+    ColumnView userIp = reader.column(COL_USER_IP), userName = reader.column(COL_USER_NAME),
+               userTimeOn = reader.column(COL_USER_TIME_ON), userUp = reader.column(COL_USER_UP),
+               userDown = reader.column(COL_USER_DOWN), userPeers = reader.column(COL_USER_PEERS);
+
+    ColumnView userPackets[24];
+    for (int i = 0; i < 24; ++i)
+        userPackets[i] = reader.column(COL_USER_PACKETS + i);
+
+    quint64 users = userIp.count();
+
+    for (quint64 i = 0; i < users; ++i)
+    {
+        data.usersList.append(reader.string(userIp, i));
+        data.usersName.append(reader.string(userName, i));
+        data.usersTimeOn.append(userTimeOn.u64(i));
+        data.usersUp.append(userUp.u64(i));
+        data.usersDown.append(userDown.u64(i));
+        data.usersPeers.append(userPeers.u32(i));
+
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 8; ++k)
+                data.usersPackets[j][k].append(userPackets[j * 8 + k].u32(i));
+
+        data.usersHosts.append(Hosts());
+        data.usersApps.append(Apps());
+    }
+
+    // hosts
+    ColumnView hostUser = reader.column(COL_HOST_USER), hostFamily = reader.column(COL_HOST_FAMILY),
+               hostIp = reader.column(COL_HOST_IP), hostName = reader.column(COL_HOST_NAME),
+               hostPort = reader.column(COL_HOST_PORT), hostApp = reader.column(COL_HOST_APP),
+               hostUp = reader.column(COL_HOST_UP), hostDown = reader.column(COL_HOST_DOWN),
+               hostFirst = reader.column(COL_HOST_FIRST), hostLast = reader.column(COL_HOST_LAST);
+
+    for (quint64 i = 0; i < hostUser.count(); ++i)
+    {
+        quint32 user = hostUser.u32(i);
+        const uchar *address = hostIp.bytes(i, 16);
+
+        if (user >= users)
+        {
+            *error = tr("Damaged session file");
+            return false;
+        }
+
+        IpAddress ip;
+        if (address && hostFamily.u8(i) == 4)
+            ip = IpAddress(qFromLittleEndian<quint32>(address));
+        else if (address && hostFamily.u8(i) == 6)
+            ip = IpAddress(address);
+
+        Hosts &host = data.usersHosts[user];
+        host.hostIp.append(ip);
+        host.hostName.append(reader.string(hostName, i));
+        host.dPort.append(reader.string(hostPort, i));
+        host.dApp.append(reader.string(hostApp, i));
+        host.upBytes.append(hostUp.u64(i));
+        host.downBytes.append(hostDown.u64(i));
+        host.firstVisit.append(hostFirst.u64(i));
+        host.lastVisit.append(hostLast.u64(i));
+    }
+
+    // applications
+    ColumnView appUser = reader.column(COL_APP_USER), appPort = reader.column(COL_APP_PORT),
+               appName = reader.column(COL_APP_NAME), appUp = reader.column(COL_APP_UP),
+               appDown = reader.column(COL_APP_DOWN);
+
+    for (quint64 i = 0; i < appUser.count(); ++i)
+    {
+        quint32 user = appUser.u32(i);
+
+        if (user >= users)
+        {
+            *error = tr("Damaged session file");
+            return false;
+        }
+
+        Apps &app = data.usersApps[user];
+        app.hostPort.append(reader.string(appPort, i));
+        app.hostPortName.append(reader.string(appName, i));
+        app.upBytes.append(appUp.u64(i));
+        app.downBytes.append(appDown.u64(i));
+    }
+
+    ColumnView net = reader.column(COL_NET);
+    for (int i = 0; i < 8; ++i)
+        data.netPackets[i] = net.u64(i);
+    data.netUp = net.u64(8);
+    data.netDown = net.u64(9);
+
+    file.close();
+
+    return true;
+}
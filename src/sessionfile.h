@@ -0,0 +1,63 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <QString>
+#include <QList>
+#include <QCoreApplication>
+
+#include "receivercore.h"
+
+// a whole analysis session, as saved by ReceiverCore and browsed by MainWindow
+struct SessionData
+{
+    quint64 started, saved;             // seconds since the epoch
+
+    QList<QString> usersList, usersName;
+    QList<quint64> usersTimeOn;         // seconds since the epoch
+    QList<quint64> usersUp, usersDown;
+    QList<quint32> usersPeers;
+    QList<quint32> usersPackets[3][8];  // EXPORT_* by ARP, RARP, ICMP, IGMP, TCP, UDP, other, total
+
+    QList<Hosts> usersHosts;
+    QList<Apps> usersApps;
+
+    quint64 netPackets[8];              // total, ARP, RARP, ICMP, IGMP, UDP, TCP, other
+    quint64 netUp, netDown;
+};
+
+// versioned columnar session file: a header, a directory of columns and the columns,
+// each a little endian array aligned to 8 bytes; strings are kept once in a string
+// table and referenced by index, so the file is mapped and read column by column
+// without parsing; unknown columns are skipped and missing ones read as zeros, so
+// new columns only bump MINOR_VERSION and files of any minor version are read;
+// VERSION (the major one) changes only with an incompatible layout
+class SessionFile
+{
+    Q_DECLARE_TR_FUNCTIONS(SessionFile)
+
+public:
+    // stored as VERSION in the low and MINOR_VERSION in the high 16 bits
+    enum { VERSION = 1, MINOR_VERSION = 0 };
+
+    static bool save(const QString &fileName, const SessionData &data, QString *error);
+    static bool load(const QString &fileName, SessionData &data, QString *error);
+};
+
+#endif // SESSIONFILE_H
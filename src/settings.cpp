@@ -16,6 +16,7 @@
 // along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "settings.h"
+#include "flowtable.h"
 
 MainWindowSettings Settings::mainWindow;
 CaptureThreadSettings Settings::captureThread;
@@ -28,6 +29,15 @@ NetPacketsGraphDialogSettings Settings::netPacketsGraphDialog;
 NetTransferGraphDialogSettings Settings::netTransferGraphDialog;
 UserTransfersGraphDialogSettings Settings::userTransfersGraphDialog;
 NetTransferDialogSettings Settings::netTransferDialog;
+MetricsSettings Settings::metrics;
+FlowsSettings Settings::flows;
+FlowExportSettings Settings::flowExport;
+SamplingSettings Settings::sampling;
+TopActiveSettings Settings::topActive;
+HostsSettings Settings::hosts;
+MemorySettings Settings::memory;
+ResolverSettings Settings::resolver;
+CheckpointSettings Settings::checkpoint;
 
 Settings::Settings(QObject *parent)
     : QObject(parent)
@@ -75,6 +85,8 @@ void Settings::create()
     s.setValue("mode", 1);
     s.setValue("bytes", 65535);
     s.setValue("timeout", 1000);
+    s.setValue("fragmentsCapacity", 4096);
+    s.setValue("fragmentsTimeout", 30);
     s.endGroup();
 
     s.beginGroup("DevicesDialog");
@@ -113,6 +125,10 @@ void Settings::create()
     s.setValue("critical", true);
     s.setValue("createFile", true);
     s.setValue("folder", QDir::toNativeSeparators(QCoreApplication::applicationDirPath()));
+    s.setValue("maxEvents", 10000);
+    s.setValue("maxRate", 20);
+    s.setValue("logSize", 1024);
+    s.setValue("logFiles", 5);
     s.endGroup();
 
     s.beginGroup("PacketsMainWindow");
@@ -180,6 +196,66 @@ void Settings::create()
     s.setValue("up", 0);
     s.setValue("down", 0);
     s.endGroup();
+
+    s.beginGroup("Metrics");
+    s.setValue("enabled", false);
+    s.setValue("address", "127.0.0.1");
+    s.setValue("port", 9101);
+    s.setValue("maxUsers", 256);
+    s.setValue("maxHosts", 1000);
+    s.endGroup();
+
+    s.beginGroup("Flows");
+    s.setValue("capacity", 524288);
+    s.setValue("idleTimeout", 15);
+    s.setValue("activeTimeout", 1800);
+    s.endGroup();
+
+    s.beginGroup("FlowExport");
+    s.setValue("enabled", false);
+    s.setValue("version", 10);
+    s.setValue("collector", "127.0.0.1");
+    s.setValue("port", 4739);
+    s.setValue("domain", 0);
+    s.setValue("templateRefresh", 60);
+    s.endGroup();
+
+    s.beginGroup("Sampling");
+    s.setValue("mode", 0);
+    s.setValue("rate", 10);
+    s.endGroup();
+
+    s.beginGroup("TopActive");
+    s.setValue("capacity", 1024);
+    s.endGroup();
+
+    s.beginGroup("Hosts");
+    s.setValue("lowMemory", false);
+    s.setValue("maxHosts", 256);
+    s.setValue("precision", 12);
+    s.endGroup();
+
+    s.beginGroup("Memory");
+    s.setValue("budget", 256);
+    s.endGroup();
+
+    s.beginGroup("Resolver");
+    s.setValue("lookups", true);
+    s.setValue("passive", true);
+    s.setValue("maxRunning", 8);
+    s.setValue("cacheSize", 10000);
+    s.setValue("ttl", 3600);
+    s.setValue("negativeTtl", 300);
+    s.setValue("hostsFile", "");
+    s.endGroup();
+
+    s.beginGroup("Checkpoint");
+    s.setValue("enabled", false);
+    s.setValue("interval", 60);
+    s.setValue("maxRows", 50000);
+    s.setValue("compactSize", 16);
+    s.setValue("fileName", QDir::toNativeSeparators(QDir::homePath() + "/LANAnalyzer.journal"));
+    s.endGroup();
 }
 
 void Settings::read()
@@ -231,6 +307,8 @@ void Settings::read()
     captureThread.mode = s.value("mode", 1).toInt();
     captureThread.bytes = s.value("bytes", 65535).toInt();
     captureThread.timeout = s.value("timeout", 1000).toInt();  // milliseconds
+    captureThread.fragmentsCapacity = s.value("fragmentsCapacity", 4096).toInt();
+    captureThread.fragmentsTimeout = s.value("fragmentsTimeout", 30).toInt();  // seconds
     s.endGroup();
 
     s.beginGroup("DevicesDialog");
@@ -269,6 +347,10 @@ void Settings::read()
     eventsViewerMainWindow.critical = s.value("critical", true).toBool();
     eventsViewerMainWindow.createFile = s.value("createFile", true).toBool();
     eventsViewerMainWindow.folder = s.value("folder", QDir::toNativeSeparators(QCoreApplication::applicationDirPath())).toString();
+    eventsViewerMainWindow.maxEvents = s.value("maxEvents", 10000).toInt();
+    eventsViewerMainWindow.maxRate = s.value("maxRate", 20).toInt();
+    eventsViewerMainWindow.logSize = s.value("logSize", 1024).toInt();
+    eventsViewerMainWindow.logFiles = s.value("logFiles", 5).toInt();
     s.endGroup();
 
     s.beginGroup("PacketsMainWindow");
@@ -337,6 +419,66 @@ void Settings::read()
     netTransferDialog.down = s.value("down", 0).toInt();
     s.endGroup();
 
+    s.beginGroup("Metrics");
+    metrics.enabled = s.value("enabled", false).toBool();
+    metrics.address = s.value("address", "127.0.0.1").toString();
+    metrics.port = s.value("port", 9101).toInt();
+    metrics.maxUsers = s.value("maxUsers", 256).toInt();
+    metrics.maxHosts = s.value("maxHosts", 1000).toInt();
+    s.endGroup();
+
+    s.beginGroup("Flows");
+    flows.capacity = qBound(1024, s.value("capacity", 524288).toInt(), (int)FlowTable::MAX_CAPACITY);
+    flows.idleTimeout = s.value("idleTimeout", 15).toInt();
+    flows.activeTimeout = s.value("activeTimeout", 1800).toInt();
+    s.endGroup();
+
+    s.beginGroup("FlowExport");
+    flowExport.enabled = s.value("enabled", false).toBool();
+    flowExport.version = s.value("version", 10).toInt();
+    flowExport.collector = s.value("collector", "127.0.0.1").toString();
+    flowExport.port = s.value("port", 4739).toInt();
+    flowExport.domain = s.value("domain", 0).toInt();
+    flowExport.templateRefresh = s.value("templateRefresh", 60).toInt();
+    s.endGroup();
+
+    s.beginGroup("Sampling");
+    sampling.mode = s.value("mode", 0).toInt();
+    sampling.rate = s.value("rate", 10).toInt();
+    s.endGroup();
+
+    s.beginGroup("TopActive");
+    topActive.capacity = s.value("capacity", 1024).toInt();
+    s.endGroup();
+
+    s.beginGroup("Hosts");
+    hosts.lowMemory = s.value("lowMemory", false).toBool();
+    hosts.maxHosts = s.value("maxHosts", 256).toInt();
+    hosts.precision = s.value("precision", 12).toInt();
+    s.endGroup();
+
+    s.beginGroup("Memory");
+    memory.budget = s.value("budget", 256).toInt();
+    s.endGroup();
+
+    s.beginGroup("Resolver");
+    resolver.lookups = s.value("lookups", true).toBool();
+    resolver.passive = s.value("passive", true).toBool();
+    resolver.maxRunning = s.value("maxRunning", 8).toInt();
+    resolver.cacheSize = s.value("cacheSize", 10000).toInt();
+    resolver.ttl = s.value("ttl", 3600).toInt();
+    resolver.negativeTtl = s.value("negativeTtl", 300).toInt();
+    resolver.hostsFile = s.value("hostsFile", "").toString();
+    s.endGroup();
+
+    s.beginGroup("Checkpoint");
+    checkpoint.enabled = s.value("enabled", false).toBool();
+    checkpoint.interval = s.value("interval", 60).toInt();
+    checkpoint.maxRows = s.value("maxRows", 50000).toInt();
+    checkpoint.compactSize = s.value("compactSize", 16).toInt();
+    checkpoint.fileName = s.value("fileName", QDir::toNativeSeparators(QDir::homePath() + "/LANAnalyzer.journal")).toString();
+    s.endGroup();
+
     s.sync();
     switch (s.status())
     {
@@ -390,6 +532,8 @@ void Settings::write()
     s.setValue("mode", captureThread.mode);
     s.setValue("bytes", captureThread.bytes);
     s.setValue("timeout", captureThread.timeout);
+    s.setValue("fragmentsCapacity", captureThread.fragmentsCapacity);
+    s.setValue("fragmentsTimeout", captureThread.fragmentsTimeout);
     s.endGroup();
 
     s.beginGroup("DevicesDialog");
@@ -428,6 +572,10 @@ void Settings::write()
     s.setValue("critical", eventsViewerMainWindow.critical);
     s.setValue("createFile", eventsViewerMainWindow.createFile);
     s.setValue("folder", eventsViewerMainWindow.folder);
+    s.setValue("maxEvents", eventsViewerMainWindow.maxEvents);
+    s.setValue("maxRate", eventsViewerMainWindow.maxRate);
+    s.setValue("logSize", eventsViewerMainWindow.logSize);
+    s.setValue("logFiles", eventsViewerMainWindow.logFiles);
     s.endGroup();
 
     s.beginGroup("PacketsMainWindow");
@@ -496,6 +644,66 @@ void Settings::write()
     s.setValue("down", netTransferDialog.down);
     s.endGroup();
 
+    s.beginGroup("Metrics");
+    s.setValue("enabled", metrics.enabled);
+    s.setValue("address", metrics.address);
+    s.setValue("port", metrics.port);
+    s.setValue("maxUsers", metrics.maxUsers);
+    s.setValue("maxHosts", metrics.maxHosts);
+    s.endGroup();
+
+    s.beginGroup("Flows");
+    s.setValue("capacity", flows.capacity);
+    s.setValue("idleTimeout", flows.idleTimeout);
+    s.setValue("activeTimeout", flows.activeTimeout);
+    s.endGroup();
+
+    s.beginGroup("FlowExport");
+    s.setValue("enabled", flowExport.enabled);
+    s.setValue("version", flowExport.version);
+    s.setValue("collector", flowExport.collector);
+    s.setValue("port", flowExport.port);
+    s.setValue("domain", flowExport.domain);
+    s.setValue("templateRefresh", flowExport.templateRefresh);
+    s.endGroup();
+
+    s.beginGroup("Sampling");
+    s.setValue("mode", sampling.mode);
+    s.setValue("rate", sampling.rate);
+    s.endGroup();
+
+    s.beginGroup("TopActive");
+    s.setValue("capacity", topActive.capacity);
+    s.endGroup();
+
+    s.beginGroup("Hosts");
+    s.setValue("lowMemory", hosts.lowMemory);
+    s.setValue("maxHosts", hosts.maxHosts);
+    s.setValue("precision", hosts.precision);
+    s.endGroup();
+
+    s.beginGroup("Memory");
+    s.setValue("budget", memory.budget);
+    s.endGroup();
+
+    s.beginGroup("Resolver");
+    s.setValue("lookups", resolver.lookups);
+    s.setValue("passive", resolver.passive);
+    s.setValue("maxRunning", resolver.maxRunning);
+    s.setValue("cacheSize", resolver.cacheSize);
+    s.setValue("ttl", resolver.ttl);
+    s.setValue("negativeTtl", resolver.negativeTtl);
+    s.setValue("hostsFile", resolver.hostsFile);
+    s.endGroup();
+
+    s.beginGroup("Checkpoint");
+    s.setValue("enabled", checkpoint.enabled);
+    s.setValue("interval", checkpoint.interval);
+    s.setValue("maxRows", checkpoint.maxRows);
+    s.setValue("compactSize", checkpoint.compactSize);
+    s.setValue("fileName", checkpoint.fileName);
+    s.endGroup();
+
     s.sync();
     switch (s.status())
     {
@@ -61,6 +61,8 @@ struct CaptureThreadSettings
     int mode;
     int bytes;
     int timeout;
+    int fragmentsCapacity;
+    int fragmentsTimeout;
 };
 
 struct DevicesDialogSettings
@@ -102,6 +104,10 @@ struct EventsViewerMainWindowSettings
     bool critical;
     bool createFile;
     QString folder;
+    int maxEvents;
+    int maxRate;        // new events a second, the rest are counted only
+    int logSize;        // KB, then the log file is rotated
+    int logFiles;
 };
 
 struct PacketsMainWindowSettings
@@ -176,6 +182,75 @@ struct NetTransferDialogSettings
     int down;
 };
 
+struct MetricsSettings
+{
+    bool enabled;
+    QString address;
+    int port;
+    int maxUsers;
+    int maxHosts;
+};
+
+struct FlowsSettings
+{
+    int capacity;
+    int idleTimeout;
+    int activeTimeout;
+};
+
+struct FlowExportSettings
+{
+    bool enabled;
+    int version;
+    QString collector;
+    int port;
+    int domain;
+    int templateRefresh;
+};
+
+struct SamplingSettings
+{
+    int mode;
+    int rate;
+};
+
+struct TopActiveSettings
+{
+    int capacity;
+};
+
+struct HostsSettings
+{
+    bool lowMemory;
+    int maxHosts;
+    int precision;
+};
+
+struct MemorySettings
+{
+    int budget;
+};
+
+struct ResolverSettings
+{
+    bool lookups;
+    bool passive;
+    int maxRunning;
+    int cacheSize;
+    int ttl;
+    int negativeTtl;
+    QString hostsFile;
+};
+
+struct CheckpointSettings
+{
+    bool enabled;
+    int interval;
+    int maxRows;
+    int compactSize;
+    QString fileName;
+};
+
 class Settings : public QObject
 {
     Q_OBJECT
@@ -201,6 +276,15 @@ public:
     static NetTransferGraphDialogSettings netTransferGraphDialog;
     static UserTransfersGraphDialogSettings userTransfersGraphDialog;
     static NetTransferDialogSettings netTransferDialog;
+    static MetricsSettings metrics;
+    static FlowsSettings flows;
+    static FlowExportSettings flowExport;
+    static SamplingSettings sampling;
+    static TopActiveSettings topActive;
+    static HostsSettings hosts;
+    static MemorySettings memory;
+    static ResolverSettings resolver;
+    static CheckpointSettings checkpoint;
 
 private:
     int error;
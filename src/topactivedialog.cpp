@@ -23,6 +23,28 @@ TopActiveDialog::TopActiveDialog(QWidget *parent)
     ui.setupUi(this);
 
     connect(ui.pushButtonOK, SIGNAL(clicked()), this, SLOT(close()));
+
+    ui.labelCount->hide();
+    ui.spinBoxCount->hide();
+    ui.comboBoxPeriod->hide();
+}
+
+void TopActiveDialog::setLive(int count, int max, bool period)
+{
+    ui.spinBoxCount->setMaximum(max);
+    ui.spinBoxCount->setValue(count);
+
+    ui.labelCount->show();
+    ui.spinBoxCount->show();
+    ui.comboBoxPeriod->setVisible(period);
+
+    connect(ui.spinBoxCount, SIGNAL(valueChanged(int)), this, SLOT(onChanged()));
+    connect(ui.comboBoxPeriod, SIGNAL(currentIndexChanged(int)), this, SLOT(onChanged()));
+}
+
+void TopActiveDialog::onChanged()
+{
+    emit changed(ui.spinBoxCount->value(), ui.comboBoxPeriod->currentIndex() == 1);
 }
 
 void TopActiveDialog::setFirstItem(const QString &name, const QString &bytes)
@@ -36,10 +58,11 @@ void TopActiveDialog::insertItem(int i, const QString &name, const QString &strB
     QLabel *label = new QLabel(strBytes);
     label->setAlignment(Qt::AlignHCenter);
 
-    ui.gridLayout->addWidget(new QLabel(name), i+2, 0);
+    QLabel *labelName = new QLabel(name);
+    ui.gridLayout->addWidget(labelName, i+2, 0);
     ui.gridLayout->addWidget(label, i+2, 2);
 
-    qreal b = (itemBytes * 100.0) / totalBytes;
+    qreal b = totalBytes ? (itemBytes * 100.0) / totalBytes : 0.0;
 
     QProgressBar *bar = new QProgressBar();
     bar->setMinimumWidth(200);
@@ -53,4 +76,12 @@ void TopActiveDialog::insertItem(int i, const QString &name, const QString &strB
     QLabel *l = new QLabel(QString("%1%").arg(b, 0, 'f', 2));
     l->setAlignment(Qt::AlignRight);
     ui.gridLayout->addWidget(l, i+2, 6);
+
+    itemWidgets << labelName << label << bar << l;
+}
+
+void TopActiveDialog::clearItems()
+{
+    qDeleteAll(itemWidgets);
+    itemWidgets.clear();
 }
@@ -32,9 +32,21 @@ public:
 
     void setFirstItem(const QString &name, const QString &bytes);
     void insertItem(int i, const QString &name, const QString &strBytes, quint64 itemBytes, quint64 totalBytes);
+    void clearItems();
+
+    // shows the number of items and the period, changed() is emitted when they change
+    void setLive(int count, int max, bool period);
 
 private:
     Ui::TopActiveDialogClass ui;
+
+    QList<QWidget *> itemWidgets;
+
+private slots:
+    void onChanged();
+
+signals:
+    void changed(int count, bool window);
 };
 
 #endif // TOPACTIVEDIALOG_H
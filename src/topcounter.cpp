@@ -0,0 +1,216 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "topcounter.h"
+
+#include <QtAlgorithms>
+
+static bool greaterCount(const TopItem &a, const TopItem &b)
+{
+    return a.count > b.count;
+}
+
+TopCounter::TopCounter(int capacity)
+{
+    maxItems = qMax(1, capacity);
+    sum = 0;
+}
+
+void TopCounter::setCapacity(int capacity)
+{
+    maxItems = qMax(1, capacity);
+    clear();
+}
+
+void TopCounter::clear()
+{
+    items.clear();
+    index.clear();
+    sum = 0;
+}
+
+void TopCounter::add(quint64 key, quint64 value)
+{
+    sum+=value;
+
+    QHash<quint64, int>::iterator it = index.find(key);
+
+    if (it != index.end())
+    {
+        items[it.value()].count+=value;
+        siftDown(it.value());
+        return;
+    }
+
+    if (items.count() < maxItems)
+    {
+        TopItem item;
+        item.key = key;
+        item.count = value;
+        item.error = 0;
+
+        items.append(item);
+        index.insert(key, items.count() - 1);
+        siftUp(items.count() - 1);
+        return;
+    }
+
+    // replace the smallest
+    TopItem &min = items[0];
+    index.remove(min.key);
+    index.insert(key, 0);
+
+    min.key = key;
+    min.error = min.count;
+    min.count+=value;
+    siftDown(0);
+}
+
+QList<TopItem> TopCounter::top(int k) const
+{
+    return select(items, k);
+}
+
+void TopCounter::merge(QHash<quint64, TopItem> &counts) const
+{
+    for (int i = 0; i < items.count(); ++i)
+    {
+        const TopItem &item = items.at(i);
+        QHash<quint64, TopItem>::iterator it = counts.find(item.key);
+
+        if (it == counts.end())
+            counts.insert(item.key, item);
+        else
+        {
+            it.value().count+=item.count;
+            it.value().error+=item.error;
+        }
+    }
+}
+
+QList<TopItem> TopCounter::select(QVector<TopItem> items, int k)
+{
+    qSort(items.begin(), items.end(), greaterCount);
+
+    if (k < items.count())
+        items.resize(k);
+
+    return items.toList();
+}
+
+void TopCounter::siftUp(int i)
+{
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+
+        if (items.at(parent).count <= items.at(i).count)
+            break;
+
+        swap(i, parent);
+        i = parent;
+    }
+}
+
+void TopCounter::siftDown(int i)
+{
+    int n = items.count();
+
+    for (;;)
+    {
+        int child = 2 * i + 1;
+
+        if (child >= n)
+            break;
+
+        if (child + 1 < n && items.at(child + 1).count < items.at(child).count)
+            ++child;
+
+        if (items.at(i).count <= items.at(child).count)
+            break;
+
+        swap(i, child);
+        i = child;
+    }
+}
+
+void TopCounter::swap(int i, int j)
+{
+    qSwap(items[i], items[j]);
+
+    index[items.at(i).key] = i;
+    index[items.at(j).key] = j;
+}
+
+TopWindow::TopWindow(int slots, int capacity)
+    : counters(qMax(1, slots), TopCounter(capacity))
+{
+    current = 0;
+}
+
+void TopWindow::setCapacity(int capacity)
+{
+    for (int i = 0; i < counters.count(); ++i)
+        counters[i].setCapacity(capacity);
+
+    current = 0;
+}
+
+void TopWindow::clear()
+{
+    for (int i = 0; i < counters.count(); ++i)
+        counters[i].clear();
+
+    current = 0;
+}
+
+void TopWindow::advance()
+{
+    current = (current + 1) % counters.count();
+    counters[current].clear();
+}
+
+quint64 TopWindow::total() const
+{
+    quint64 sum = 0;
+
+    for (int i = 0; i < counters.count(); ++i)
+        sum+=counters.at(i).total();
+
+    return sum;
+}
+
+QList<TopItem> TopWindow::top(int k) const
+{
+    QHash<quint64, TopItem> counts;
+    merge(counts);
+
+    QVector<TopItem> items;
+    items.reserve(counts.count());
+
+    QHash<quint64, TopItem>::const_iterator it = counts.constBegin();
+    for (; it != counts.constEnd(); ++it)
+        items.append(it.value());
+
+    return TopCounter::select(items, k);
+}
+
+void TopWindow::merge(QHash<quint64, TopItem> &counts) const
+{
+    for (int i = 0; i < counters.count(); ++i)
+        counters.at(i).merge(counts);
+}
@@ -0,0 +1,95 @@
+// Copyright © 2009 Mariusz Helfajer
+//
+// This file is part of LANAnalyzer.
+//
+// LANAnalyzer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// LANAnalyzer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with LANAnalyzer.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TOPCOUNTER_H
+#define TOPCOUNTER_H
+
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+// counted key, the count may be overestimated by at most error
+struct TopItem
+{
+    quint64 key;
+    quint64 count;
+    quint64 error;
+};
+
+// heavy hitters with the Space-Saving algorithm: at most capacity keys are counted,
+// a new key takes the place of the smallest one and inherits its count as the error;
+// a key with more than total / capacity is never dropped, so the top is exact for it
+class TopCounter
+{
+public:
+    explicit TopCounter(int capacity = 1024);
+
+    void setCapacity(int capacity);
+    void clear();
+
+    void add(quint64 key, quint64 value);
+
+    int capacity() const { return maxItems; }
+    int count() const { return items.count(); }
+    quint64 total() const { return sum; }
+
+    // k largest counts, the largest first
+    QList<TopItem> top(int k) const;
+
+    // adds the counts and errors to counts
+    void merge(QHash<quint64, TopItem> &counts) const;
+
+    // k largest of items, the largest first
+    static QList<TopItem> select(QVector<TopItem> items, int k);
+
+private:
+    QVector<TopItem> items;     // min-heap on count
+    QHash<quint64, int> index;  // key -> position in items
+    int maxItems;
+    quint64 sum;
+
+    void siftUp(int i);
+    void siftDown(int i);
+    void swap(int i, int j);
+};
+
+// heavy hitters of the last slots intervals, a TopCounter per interval
+class TopWindow
+{
+public:
+    explicit TopWindow(int slots = 60, int capacity = 1024);
+
+    void setCapacity(int capacity);
+    void clear();
+
+    void add(quint64 key, quint64 value) { counters[current].add(key, value); }
+
+    // starts the next interval, the oldest one is dropped
+    void advance();
+
+    quint64 total() const;
+    QList<TopItem> top(int k) const;
+
+    // adds the counts and errors of all the intervals to counts
+    void merge(QHash<quint64, TopItem> &counts) const;
+
+private:
+    QVector<TopCounter> counters;
+    int current;
+};
+
+#endif // TOPCOUNTER_H
@@ -26,7 +26,6 @@ UserTransfersGraphDialog::UserTransfersGraphDialog(QWidget *parent, ReceiverCore
 
     qRegisterMetaType<qrealList>("QList<qreal>");
 
-    connect(receiverCore, SIGNAL(signalNewUser(QString,QString)), this, SLOT(newUser(QString,QString)));
     connect(receiverCore, SIGNAL(signalUsersSpeed(QList<qreal>,QList<qreal>)), this, SLOT(setValue(QList<qreal>,QList<qreal>)), Qt::QueuedConnection);
 
     ui.widget->setXLabel(tr("Time (seconds)"));
@@ -42,6 +42,11 @@ public:
     void startGraph();
     void stopGraph();
     void writeSettings();
+    void clearData();
+
+public slots:
+    // users are added by MainWindow, also the ones known before the dialog was created
+    void newUser(const QString &user, const QString &timeOn);
 
 protected:
     virtual void showEvent(QShowEvent *event);
@@ -63,10 +68,7 @@ private:
     QList<TransferTab> dataMinuteList;
     QList<TransferTab> dataHourList;
 
-    void clearData();
-
 private slots:
-    void newUser(const QString &user, const QString &timeOn);
     void setValue(QList<qreal> uesrsUpSpeed, QList<qreal> usersDownSpeed);
 
     void updateTimerHour();